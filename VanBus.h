@@ -40,7 +40,7 @@ class TVanBus
 
     // -----
     // Interfaces for both Tx and Rx
-    static void Setup(uint8_t rxPin, uint8_t txPin) { VanBusTx.Setup(rxPin, txPin); }
+    static bool Setup(uint8_t rxPin, uint8_t txPin) { return VanBusTx.Setup(rxPin, txPin); }
 
     static void DumpStats(Stream& s)
     {
@@ -48,6 +48,18 @@ class TVanBus
         VanBusRx.DumpStats(s);
     } // DumpStats
 
+    static void GetStats(TVanRxStats& rxStats, TVanTxStats& txStats)
+    {
+        VanBusRx.GetStats(rxStats);
+        VanBusTx.GetStats(txStats);
+    } // GetStats
+
+    static void ResetStats()
+    {
+        VanBusRx.ResetStats();
+        VanBusTx.ResetStats();
+    } // ResetStats
+
     // -----
     // Rx interfaces
     static bool Available() { return VanBusRx.Available(); }
@@ -57,6 +69,9 @@ class TVanBus
         return VanBusRx.Receive(pkt, isQueueOverrun);
     } // Receive
 
+    static TVanPacketRxDesc* Peek(bool* isQueueOverrun = NULL) { return VanBusRx.Peek(isQueueOverrun); }
+    static void Release() { VanBusRx.Release(); }
+
     static uint32_t GetRxCount() { return VanBusRx.GetCount(); }
 
     // -----
@@ -71,6 +86,16 @@ class TVanBus
         return VanBusTx.SendPacket(iden, cmdFlags, data, dataLen, timeOutMs);
     } // SendPacket
 
+    static bool SendPacketAsync(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, TVanTxTicket* ticket = NULL)
+    {
+        return VanBusTx.SendPacketAsync(iden, cmdFlags, data, dataLen, ticket);
+    } // SendPacketAsync
+
+    static VanPacketTxStatus_t GetTxStatus(TVanTxTicket ticket, TVanPacketTxResult* result = NULL)
+    {
+        return VanBusTx.GetTxStatus(ticket, result);
+    } // GetTxStatus
+
     static uint32_t GetTxCount() { return VanBusTx.GetCount(); }
 
 }; // class TVanBus
@@ -0,0 +1,124 @@
+/*
+ * VanBus packet capture writer
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+#include "VanBusCapture.h"
+
+void TVanCaptureWriter::Reset()
+{
+    lastTimestamp = 0;
+    nextSeqNo = 0;
+    isFirst = true;
+} // TVanCaptureWriter::Reset
+
+// Writes the stream header, and restarts the stream state. Returns false if the output did not accept the header.
+bool TVanCaptureWriter::Begin()
+{
+    Reset();
+
+    buffer[0] = 'V';
+    buffer[1] = 'A';
+    buffer[2] = 'N';
+    buffer[3] = 'C';
+    buffer[4] = VAN_CAPTURE_VERSION;
+    buffer[5] = VAN_RX_QUEUE_SIZE & 0xFF;  // 256 is written as 0
+
+    return Flush(VAN_CAPTURE_HEADER_SIZE) == VAN_CAPTURE_HEADER_SIZE;
+} // TVanCaptureWriter::Begin
+
+// Encodes one record as a frame, starting at 'at'. Returns the number of bytes used.
+int TVanCaptureWriter::Encode(const TVanPacketRecord& record, uint8_t* at)
+{
+    uint8_t* p = at;
+
+    int size = record.size;
+    if (size > VAN_MAX_PACKET_SIZE) size = VAN_MAX_PACKET_SIZE;
+
+    bool writeSeqNo = isFirst || record.seqNo != nextSeqNo;
+    bool writeSof = size >= 1 && record.bytes[0] != 0x0E;
+
+    *p++ = VAN_CAPTURE_SYNC;
+    *p++ =
+        (record.flags & (VAN_RECORD_RESULT_MASK | VAN_RECORD_ACK | VAN_RECORD_QUEUE_OVERRUN))
+        | (writeSeqNo ? VAN_CAPTURE_SEQNO : 0)
+        | (writeSof ? VAN_CAPTURE_SOF : 0);
+
+    // Arithmetic has safe roll-over
+    uint32_t delta = record.timestamp - lastTimestamp;
+    while (delta >= 0x80)
+    {
+        *p++ = (delta & 0x7F) | 0x80;
+        delta >>= 7;
+    } // while
+    *p++ = delta;
+
+    if (writeSeqNo)
+    {
+        *p++ = record.seqNo & 0xFF;
+        *p++ = record.seqNo >> 8;
+    } // if
+
+    *p++ = size;
+
+    int from = writeSof || size == 0 ? 0 : 1;
+    memcpy(p, record.bytes + from, size - from);
+    p += size - from;
+
+    lastTimestamp = record.timestamp;
+    nextSeqNo = record.seqNo + 1;
+    isFirst = false;
+
+    return p - at;
+} // TVanCaptureWriter::Encode
+
+// Passes the first 'len' bytes of the buffer to the output. Returns the number of bytes accepted.
+size_t TVanCaptureWriter::Flush(int len)
+{
+    if (len == 0) return 0;
+
+    size_t written = out.write(buffer, len);
+    if (written < (size_t)len) nShortWrites++;
+    nBytes += written;
+
+    return written;
+} // TVanCaptureWriter::Flush
+
+// Writes 'n' records. Frames are collected in the buffer, so that a batch of records usually takes only one write
+// to the output (and, for a TCP connection, one segment in stead of one per packet).
+size_t TVanCaptureWriter::Write(const TVanPacketRecord* records, int n)
+{
+    size_t written = 0;
+    int len = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (len + VAN_CAPTURE_MAX_FRAME_SIZE > VAN_CAPTURE_BUFFER_SIZE)
+        {
+            written += Flush(len);
+            len = 0;
+        } // if
+
+        len += Encode(records[i], buffer + len);
+        nFrames++;
+    } // for
+
+    written += Flush(len);
+
+    return written;
+} // TVanCaptureWriter::Write
+
+void TVanCaptureWriter::DumpStats(Stream& s) const
+{
+    s.printf_P(
+        PSTR("capture frames: %lu, bytes: %lu (%lu bytes/frame), short writes: %lu\n"),
+        nFrames,
+        nBytes,
+        nFrames == 0 ? 0 : nBytes / nFrames,
+        nShortWrites);
+} // TVanCaptureWriter::DumpStats
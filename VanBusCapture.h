@@ -0,0 +1,119 @@
+/*
+ * VanBus packet capture writer
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+/*
+ * USAGE
+ *
+ *   Add the following line to your sketch:
+ *     #include <VanBusCapture.h>
+ *
+ *   Declare a writer, e.g. on the serial port (or on a connected 'WiFiClient'):
+ *     TVanCaptureWriter capture(Serial);
+ *
+ *   In setup() :
+ *     Serial.begin(921600);
+ *     VanBusRx.Setup(RX_PIN);
+ *     capture.Begin();
+ *
+ *   In loop() :
+ *     TVanPacketRecord records[8];
+ *     int n = VanBusRx.DrainTo(records, 8);
+ *     if (n > 0) capture.Write(records, n);
+ *
+ *   On the host, convert the captured stream back into 'DumpRaw' text:
+ *     python3 extras/capture/van_capture_decode.py capture.bin
+ */
+
+#ifndef VanBusCapture_h
+#define VanBusCapture_h
+
+#include "VanBusRx.h"
+
+// Binary capture stream format
+//
+// The stream starts with a header:
+//   'V' 'A' 'N' 'C' : magic
+//   version : currently 1
+//   rxQueueSize : value of VAN_RX_QUEUE_SIZE, for the host-side decoder
+//
+// followed by one frame per packet:
+//   sync : always VAN_CAPTURE_SYNC
+//   flags : VAN_RECORD_... flags (result, ack, queue overrun), plus VAN_CAPTURE_... flags
+//   timestamp : 'millis()' delta since the previous frame, unsigned LEB128 (7 bits per byte, LSB first); usually
+//     one byte
+//   seqNo : only if flag VAN_CAPTURE_SEQNO is set: 16-bit sequence number, LSB first. Written for the first frame,
+//     and whenever the sequence number did not simply increment
+//   size : total number of bytes in the packet
+//   bytes : 'size' bytes, SOF up to and including CRC. The SOF byte (always 0x0E) is left out, unless flag
+//     VAN_CAPTURE_SOF is set. The IDEN and command flags are in the first two bytes after the SOF.
+//
+// A typical packet with 8 data bytes takes 16 bytes, in stead of the 80+ characters of its 'DumpRaw' text. The sync
+// byte lets the decoder regain frame boundaries after a partial write, or when it starts reading halfway a stream.
+
+#define VAN_CAPTURE_VERSION 1
+#define VAN_CAPTURE_SYNC 0xA5
+
+#define VAN_CAPTURE_SEQNO 0x10  // Frame contains an explicit sequence number
+#define VAN_CAPTURE_SOF 0x20  // Frame contains the SOF byte (it is not 0x0E)
+
+#define VAN_CAPTURE_HEADER_SIZE 6
+
+// Largest possible frame: sync, flags, 5-byte timestamp, seqNo, size, bytes
+#define VAN_CAPTURE_MAX_FRAME_SIZE (2 + 5 + 2 + 1 + VAN_MAX_PACKET_SIZE)
+
+// Frames are collected in a buffer of this size, which is then passed to the output in one write. Must be at least
+// VAN_CAPTURE_MAX_FRAME_SIZE.
+#ifndef VAN_CAPTURE_BUFFER_SIZE
+#define VAN_CAPTURE_BUFFER_SIZE 256
+#endif // VAN_CAPTURE_BUFFER_SIZE
+
+#if VAN_CAPTURE_BUFFER_SIZE < VAN_CAPTURE_MAX_FRAME_SIZE
+#error "VAN_CAPTURE_BUFFER_SIZE must be at least VAN_CAPTURE_MAX_FRAME_SIZE"
+#endif
+
+// Writes received packets in the binary capture format to a serial port, TCP connection, file, ...
+class TVanCaptureWriter
+{
+  public:
+
+    // Constructor
+    TVanCaptureWriter(Print& out) : out(out), nFrames(0), nBytes(0), nShortWrites(0) { Reset(); }
+
+    // Writes the stream header. Call at the start of each new stream, e.g. when a TCP client has connected.
+    bool Begin();
+
+    // Writes records as filled by 'VanBusRx.DrainTo(...)'. Returns the number of bytes accepted by the output.
+    size_t Write(const TVanPacketRecord* records, int n);
+    size_t Write(const TVanPacketRecord& record) { return Write(&record, 1); }
+
+    uint32_t GetCount() const { return nFrames; }
+    void DumpStats(Stream& s) const;
+
+  private:
+
+    Print& out;
+
+    uint32_t lastTimestamp;
+    uint16_t nextSeqNo;
+    bool isFirst;  // No frame written yet since 'Begin()'
+
+    uint8_t buffer[VAN_CAPTURE_BUFFER_SIZE];
+
+    // Statistics
+    uint32_t nFrames;
+    uint32_t nBytes;
+    uint32_t nShortWrites;  // Output accepted fewer bytes than offered; the decoder will resync on the next frame
+
+    void Reset();  // Restart timestamp delta and sequence number tracking
+    int Encode(const TVanPacketRecord& record, uint8_t* at);
+    size_t Flush(int len);
+}; // class TVanCaptureWriter
+
+#endif // VanBusCapture_h
@@ -0,0 +1,129 @@
+/*
+ * VanBus packet dispatcher
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+/*
+ * USAGE
+ *
+ *   Add the following line to your sketch:
+ *     #include <VanBusDispatcher.h>
+ *
+ *   Declare a dispatcher, e.g. for at most 40 different IDEN values:
+ *     TVanPacketDispatcher<40> dispatcher;
+ *
+ *   In setup() :
+ *     dispatcher.Register(0x8A4, 7, &ParseEnginePkt);  // IDEN, expected number of data bytes (-1 = any), handler
+ *
+ *   In loop() :
+ *     TVanPacketRxDesc pkt;
+ *     if (VanBusRx.Receive(pkt)) dispatcher.Dispatch(pkt);
+ */
+
+#ifndef VanBusDispatcher_h
+#define VanBusDispatcher_h
+
+#include "VanBusRx.h"
+
+// Packet handler. The meaning of the returned value is up to the application.
+typedef int (*TVanPacketHandler)(TVanPacketRxDesc& pkt, void* context);
+
+struct TVanPacketHandlerEntry
+{
+    uint16_t iden;
+    int dataLen;  // Expected number of data bytes, or -1 if varying/unknown
+    TVanPacketHandler handler;
+    void* context;  // Passed to the handler
+}; // struct TVanPacketHandlerEntry
+
+enum VanPacketDispatchResult_t
+{
+    VAN_DISPATCH_OK,  // Handler was called
+    VAN_DISPATCH_UNKNOWN_IDEN,  // No handler registered for this IDEN
+    VAN_DISPATCH_UNEXPECTED_LENGTH  // Handler found, but the packet does not have the expected number of data bytes
+}; // enum VanPacketDispatchResult_t
+
+// Routes received packets to the handler registered for their IDEN value. Handlers are kept sorted on IDEN value, so
+// that finding the handler for a packet takes a binary search; e.g. at most 6 comparisons for 40 handlers.
+template <int N>
+class TVanPacketDispatcher
+{
+  public:
+
+    // Constructor
+    TVanPacketDispatcher() : n(0) { }
+
+    // Registers a handler for packets with the specified IDEN value. When a handler was already registered for that
+    // IDEN value, it is replaced. Returns false if all N entries are in use.
+    bool Register(uint16_t iden, int dataLen, TVanPacketHandler handler, void* context = NULL)
+    {
+        iden &= 0xFFF;
+
+        // Find the insertion point, keeping the entries sorted
+        int at = LowerBound(iden);
+
+        if (at == n || entries[at].iden != iden)
+        {
+            if (n >= N) return false;
+            for (int i = n; i > at; i--) entries[i] = entries[i - 1];
+            n++;
+        } // if
+
+        entries[at].iden = iden;
+        entries[at].dataLen = dataLen;
+        entries[at].handler = handler;
+        entries[at].context = context;
+
+        return true;
+    } // Register
+
+    // Returns the entry registered for the specified IDEN value, or NULL if none
+    const TVanPacketHandlerEntry* Find(uint16_t iden) const
+    {
+        int at = LowerBound(iden);
+        return at < n && entries[at].iden == iden ? entries + at : NULL;
+    } // Find
+
+    // Calls the handler registered for the IDEN value of the packet. If a valid pointer is passed to 'handlerResult',
+    // will store the value returned by the handler into it.
+    VanPacketDispatchResult_t Dispatch(TVanPacketRxDesc& pkt, int* handlerResult = NULL) const
+    {
+        const TVanPacketHandlerEntry* entry = Find(pkt.Iden());
+        if (entry == NULL) return VAN_DISPATCH_UNKNOWN_IDEN;
+        if (entry->dataLen >= 0 && pkt.DataLen() != entry->dataLen) return VAN_DISPATCH_UNEXPECTED_LENGTH;
+
+        int result = entry->handler(pkt, entry->context);
+        if (handlerResult) *handlerResult = result;
+
+        return VAN_DISPATCH_OK;
+    } // Dispatch
+
+    // Iterating over the registered entries, in order of IDEN value
+    int Count() const { return n; }
+    const TVanPacketHandlerEntry& operator[](int i) const { return entries[i]; }
+
+  private:
+
+    TVanPacketHandlerEntry entries[N];  // Sorted on IDEN value
+    int n;  // Number of entries in use
+
+    // Returns the index of the first entry with IDEN value not less than 'iden'
+    int LowerBound(uint16_t iden) const
+    {
+        int lo = 0;
+        int hi = n;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (entries[mid].iden < iden) lo = mid + 1; else hi = mid;
+        } // while
+        return lo;
+    } // LowerBound
+}; // class TVanPacketDispatcher
+
+#endif // VanBusDispatcher_h
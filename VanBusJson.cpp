@@ -0,0 +1,211 @@
+/*
+ * VanBus JSON writer
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+#include "VanBusJson.h"
+
+void TVanJsonWriter::Clear()
+{
+    len = 0;
+    overflow = false;
+    needComma = false;
+    depth = 0;
+    Terminate();
+} // TVanJsonWriter::Clear
+
+void TVanJsonWriter::PutP(const char* str)
+{
+    if (str == NULL) return;
+
+    for (;;)
+    {
+        char c = pgm_read_byte(str++);
+        if (c == '\0') break;
+        Put(c);
+    } // for
+} // TVanJsonWriter::PutP
+
+// Writes the separator from the previous member (if any), and the key (if any), followed by 'open'
+void TVanJsonWriter::BeginMember(const char* key, const char* open)
+{
+    if (depth > 0) PutP(needComma ? PSTR(",\n") : PSTR("\n"));
+
+    if (key != NULL)
+    {
+        Put('"');
+        PutP(key);
+        Put('"');
+        Put(':');
+    } // if
+
+    PutP(open);
+} // TVanJsonWriter::BeginMember
+
+void TVanJsonWriter::EndContainer(char close)
+{
+    Put('\n');
+    Put(close);
+    needComma = true;
+
+    if (depth > 0) depth--;
+    if (depth == 0) Put('\n');
+
+    Terminate();
+} // TVanJsonWriter::EndContainer
+
+TVanJsonWriter& TVanJsonWriter::BeginObject()
+{
+    BeginMember(NULL, PSTR("{"));
+    needComma = false;
+    depth++;
+    Terminate();
+    return *this;
+} // TVanJsonWriter::BeginObject
+
+TVanJsonWriter& TVanJsonWriter::BeginObject(const char* key)
+{
+    BeginMember(key, PSTR("\n{"));
+    needComma = false;
+    depth++;
+    Terminate();
+    return *this;
+} // TVanJsonWriter::BeginObject
+
+TVanJsonWriter& TVanJsonWriter::EndObject()
+{
+    EndContainer('}');
+    return *this;
+} // TVanJsonWriter::EndObject
+
+TVanJsonWriter& TVanJsonWriter::BeginArray(const char* key)
+{
+    BeginMember(key, PSTR("\n["));
+    needComma = false;
+    depth++;
+    Terminate();
+    return *this;
+} // TVanJsonWriter::BeginArray
+
+TVanJsonWriter& TVanJsonWriter::EndArray()
+{
+    EndContainer(']');
+    return *this;
+} // TVanJsonWriter::EndArray
+
+TVanJsonWriter& TVanJsonWriter::BeginValue()
+{
+    BeginMember(NULL, PSTR("\""));
+    return *this;
+} // TVanJsonWriter::BeginValue
+
+TVanJsonWriter& TVanJsonWriter::BeginValue(const char* key)
+{
+    BeginMember(key, PSTR(" \""));
+    return *this;
+} // TVanJsonWriter::BeginValue
+
+TVanJsonWriter& TVanJsonWriter::EndValue()
+{
+    Put('"');
+    needComma = true;
+    Terminate();
+    return *this;
+} // TVanJsonWriter::EndValue
+
+TVanJsonWriter& TVanJsonWriter::Char(char c)
+{
+    Put(c);
+    Terminate();
+    return *this;
+} // TVanJsonWriter::Char
+
+TVanJsonWriter& TVanJsonWriter::Str(const char* str)
+{
+    for (; *str != '\0'; str++)
+    {
+        if (*str == '"' || *str == '\\') Put('\\');
+        Put(*str);
+    } // for
+
+    Terminate();
+    return *this;
+} // TVanJsonWriter::Str
+
+TVanJsonWriter& TVanJsonWriter::StrP(const char* str)
+{
+    PutP(str);
+    Terminate();
+    return *this;
+} // TVanJsonWriter::StrP
+
+TVanJsonWriter& TVanJsonWriter::Int(long value)
+{
+    if (value < 0)
+    {
+        Put('-');
+        return UInt(- (unsigned long)value);
+    } // if
+
+    return UInt(value);
+} // TVanJsonWriter::Int
+
+TVanJsonWriter& TVanJsonWriter::UInt(unsigned long value, int width)
+{
+    char digits[10];
+    int n = 0;
+    do
+    {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+
+    while (width-- > n) Put('0');
+    while (n > 0) Put(digits[--n]);
+
+    Terminate();
+    return *this;
+} // TVanJsonWriter::UInt
+
+TVanJsonWriter& TVanJsonWriter::Fixed(long value, int decimals)
+{
+    unsigned long divisor = 1;
+    for (int i = 0; i < decimals; i++) divisor *= 10;
+
+    if (value < 0) Put('-');
+    unsigned long absValue = value < 0 ? - (unsigned long)value : value;
+
+    UInt(absValue / divisor);
+    if (decimals > 0)
+    {
+        Put('.');
+        UInt(absValue % divisor, decimals);
+    } // if
+
+    return *this;
+} // TVanJsonWriter::Fixed
+
+TVanJsonWriter& TVanJsonWriter::Bcd(uint8_t bcd)
+{
+    Put('0' + (bcd >> 4 & 0x0F));
+    Put('0' + (bcd & 0x0F));
+    Terminate();
+    return *this;
+} // TVanJsonWriter::Bcd
+
+TVanJsonWriter& TVanJsonWriter::Hex(uint8_t value)
+{
+    static const char hexDigits[] PROGMEM = "0123456789ABCDEF";
+
+    Put('0');
+    Put('x');
+    Put(pgm_read_byte(hexDigits + (value >> 4)));
+    Put(pgm_read_byte(hexDigits + (value & 0x0F)));
+    Terminate();
+    return *this;
+} // TVanJsonWriter::Hex
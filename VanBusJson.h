@@ -0,0 +1,109 @@
+/*
+ * VanBus JSON writer
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+/*
+ * USAGE
+ *
+ *   Add the following line to your sketch:
+ *     #include <VanBusJson.h>
+ *
+ *   Write into a buffer:
+ *     char buf[512];
+ *     TVanJsonWriter json(buf, sizeof(buf));
+ *     json.BeginObject();
+ *     json.AddStrP(PSTR("event"), PSTR("display"));
+ *     json.BeginObject(PSTR("data"));
+ *     json.AddUInt(PSTR("fuel_level"), data[7]);
+ *     json.BeginValue(PSTR("uptime")).UInt(data[3]).Char('h').UInt(data[4]).Char('m').EndValue();
+ *     json.EndObject();
+ *     json.EndObject();
+ *     if (! json.IsOverflow()) webSocket.broadcastTXT(json.c_str(), json.Length());
+ */
+
+#ifndef VanBusJson_h
+#define VanBusJson_h
+
+#include <Arduino.h>
+
+// Writes a JSON text into a bounded, caller-supplied buffer, without printf-like formatting. The length is tracked
+// while writing; when the buffer is full, further output is dropped and 'IsOverflow()' returns true. The text is
+// always terminated with '\0'.
+//
+// All values are written as JSON strings (e.g. "speed": "88"), as expected by the 'LiveWebPage' example sketch. A
+// value is either written in one call (e.g. 'AddUInt(...)'), or composed in pieces between 'BeginValue(...)' and
+// 'EndValue()'. Keys are PROGMEM strings (use 'PSTR(...)').
+//
+// The layout (a new line for each member) is the same as that of the JSON texts in the 'LiveWebPage' example sketch.
+class TVanJsonWriter
+{
+  public:
+
+    // Constructor. 'size' includes the terminating '\0'.
+    TVanJsonWriter(char* buf, int size) : buf(buf), size(size) { Clear(); }
+
+    void Clear();
+
+    // Objects and arrays. The key is a PROGMEM string. Use no key for the outermost object, and for array elements.
+    TVanJsonWriter& BeginObject();
+    TVanJsonWriter& BeginObject(const char* key);
+    TVanJsonWriter& EndObject();
+    TVanJsonWriter& BeginArray(const char* key);
+    TVanJsonWriter& EndArray();
+
+    // String value, composed of pieces. Use no key for array elements.
+    TVanJsonWriter& BeginValue();
+    TVanJsonWriter& BeginValue(const char* key);
+    TVanJsonWriter& EndValue();
+
+    // Pieces of a value
+    TVanJsonWriter& Char(char c);
+    TVanJsonWriter& Str(const char* str);  // Characters '"' and '\' are escaped
+    TVanJsonWriter& StrP(const char* str);  // PROGMEM string; not escaped. NULL writes nothing.
+    TVanJsonWriter& Int(long value);
+    TVanJsonWriter& UInt(unsigned long value, int width = 1);  // At least 'width' digits, padded with '0'
+    TVanJsonWriter& Fixed(long value, int decimals);  // E.g. 'Fixed(-125, 1)' writes "-12.5"
+    TVanJsonWriter& Bcd(uint8_t bcd);  // Two decimal digits
+    TVanJsonWriter& Hex(uint8_t value);  // E.g. "0x0F"
+
+    // Complete key-value pairs
+    TVanJsonWriter& AddStr(const char* key, const char* value) { return BeginValue(key).Str(value).EndValue(); }
+    TVanJsonWriter& AddStrP(const char* key, const char* value) { return BeginValue(key).StrP(value).EndValue(); }
+    TVanJsonWriter& AddInt(const char* key, long value) { return BeginValue(key).Int(value).EndValue(); }
+    TVanJsonWriter& AddUInt(const char* key, unsigned long value) { return BeginValue(key).UInt(value).EndValue(); }
+    TVanJsonWriter& AddFixed(const char* key, long value, int decimals)
+    {
+        return BeginValue(key).Fixed(value, decimals).EndValue();
+    } // AddFixed
+
+    const char* c_str() const { return buf; }
+    int Length() const { return len; }
+    bool IsOverflow() const { return overflow; }
+
+  private:
+
+    char* buf;
+    int size;
+    int len;
+    bool overflow;
+    bool needComma;  // A member was already written in the current object or array
+    uint8_t depth;
+
+    void Put(char c)
+    {
+        if (len < size - 1) buf[len++] = c; else overflow = true;
+    } // Put
+
+    void PutP(const char* str);
+    void Terminate() { if (size > 0) buf[len] = '\0'; }
+    void BeginMember(const char* key, const char* open);
+    void EndContainer(char close);
+}; // class TVanJsonWriter
+
+#endif // VanBusJson_h
@@ -8,27 +8,64 @@
  * MIT license, all text above must be included in any redistribution.
  */
 
+#include <Schedule.h>
 #include "VanBusRx.h"
+#include "VanBusTx.h"
+
+#ifdef VAN_RX_DEFERRED_DECODING
+#include <i2s.h>
+#endif // VAN_RX_DEFERRED_DECODING
 
 static const uint16_t VAN_CRC_POLYNOM = 0x0F9D;
 
-uint16_t _crc(const uint8_t bytes[], int size)
+// Number of CPU cycles in one bit time: 640 at 80 MHz, 1280 at 160 MHz
+#define VAN_BIT_CPU_CYCLES (F_CPU / 125000)
+
+// Clock recovery. The first 9 bits of the SOF (0000 1111 0) are received as three series of bits with known length,
+// so the time they take is a measurement of the actual bit time, as used by the transmitter of the packet.
+// 'bitScale' is a fixed point factor, with VAN_BIT_SCALE_SHIFT fractional bits.
+#define VAN_BIT_SCALE_SHIFT 10
+#define VAN_BIT_SCALE_ONE (1 << VAN_BIT_SCALE_SHIFT)
+#define VAN_SOF_MEASURED_BITS 9
+#define VAN_SOF_NOMINAL_CYCLES (VAN_SOF_MEASURED_BITS * VAN_BIT_CPU_CYCLES)
+
+// Measured SOF times outside +/- 12.5% of nominal are not trusted
+#define VAN_SOF_MIN_CYCLES (VAN_SOF_NOMINAL_CYCLES - VAN_SOF_NOMINAL_CYCLES / 8)
+#define VAN_SOF_MAX_CYCLES (VAN_SOF_NOMINAL_CYCLES + VAN_SOF_NOMINAL_CYCLES / 8)
+
+// Above this, the CPU cycle count is not scaled (it would overflow, and it is way more than 9 bits anyway)
+#define VAN_BIT_SCALE_MAX_CYCLES (1UL << 20)
+
+// Lookup table for the VAN CRC-15, processing 4 bits (a "nibble") at a time. Entry 'n' is the result of running the
+// polynomial division over 'n << 11', i.e. 4 bits at the top of the 15-bit register.
+// A nibble table of 16 entries (32 bytes) is used in stead of a byte table of 256 entries (512 bytes): it halves the
+// number of steps compared to running bit by bit, without costing precious RAM.
+static const uint16_t crc15NibbleTable[16] =
 {
-    uint16_t crc16 = 0x7FFF;
-
-    for (int i = 1; i < size - 2; i++)  // Skip first byte (SOF, 0x0E) and last 2 (CRC)
+    0x0000, 0x0F9D, 0x1F3A, 0x10A7, 0x3E74, 0x31E9, 0x214E, 0x2ED3,
+    0x7CE8, 0x7375, 0x63D2, 0x6C4F, 0x429C, 0x4D01, 0x5DA6, 0x523B
+}; // crc15NibbleTable
+
+// Runs the VAN CRC-15 over 'size' bytes, starting with (15-bit) register value 'crc15'. Returns the new (15-bit)
+// register value.
+// Note: this is the one CRC engine; all CRC calculations and checks must go through here.
+uint16_t _crc15(uint16_t crc15, const uint8_t bytes[], int size)
+{
+    for (int i = 0; i < size; i++)
     {
         uint8_t byte = bytes[i];
 
-        for (int j = 0; j < 8; j++)
-        {
-            uint16_t bit = crc16 & 0x4000;
-            if (byte & 0x80) bit ^= 0x4000;
-            byte <<= 1;
-            crc16 <<= 1;
-            if (bit) crc16 ^= VAN_CRC_POLYNOM;
-        } // for
-    } // if
+        crc15 = crc15 << 4 ^ crc15NibbleTable[(crc15 >> 11 ^ byte >> 4) & 0x0F];
+        crc15 = crc15 << 4 ^ crc15NibbleTable[(crc15 >> 11 ^ byte) & 0x0F];
+    } // for
+
+    return crc15 & 0x7FFF;
+} // _crc15
+
+uint16_t _crc(const uint8_t bytes[], int size)
+{
+    // Skip first byte (SOF, 0x0E) and last 2 (CRC)
+    uint16_t crc16 = _crc15(0x7FFF, bytes + 1, size - 3);
 
     crc16 ^= 0x7FFF;
     crc16 <<= 1;  // Shift left 1 bit to turn 15 bit result into 16 bit representation
@@ -37,7 +74,8 @@ uint16_t _crc(const uint8_t bytes[], int size)
 } // _crc
 
 // Returns the IDEN field of a VAN packet
-uint16_t TVanPacketRxDesc::Iden() const
+// Note: also called from ISR, so it must be in IRAM
+uint16_t ICACHE_RAM_ATTR TVanPacketRxDesc::Iden() const
 {
     return bytes[1] << 4 | bytes[2] >> 4;
 } // TVanPacketRxDesc::Iden
@@ -66,102 +104,257 @@ int TVanPacketRxDesc::DataLen() const
     return size - 5;
 } // TVanPacketRxDesc::DataLen
 
+// Calculates the CRC of a VAN packet, and checks it against the CRC value in the packet, in one pass over the packet
+// bytes. The results are cached until the packet bytes change.
+void TVanPacketRxDesc::CalculateCrc() const
+{
+    if (size < 3)
+    {
+        crc = _crc(bytes, size);
+        crcOk = _crc15(0x7FFF, bytes + 1, size - 1) == 0x19B7;
+        return;
+    } // if
+
+    // Skip first byte (SOF, 0x0E)
+    uint16_t crc15 = _crc15(0x7FFF, bytes + 1, size - 3);
+    crc = (crc15 ^ 0x7FFF) << 1;
+
+    // Continue over the CRC value in the packet. Packet is OK if the remainder is 0x19B7.
+    crcOk = _crc15(crc15, bytes + size - 2, 2) == 0x19B7;
+} // TVanPacketRxDesc::CalculateCrc
+
 // Calculates the CRC of a VAN packet
 uint16_t TVanPacketRxDesc::Crc() const
 {
-    return _crc(bytes, size);
+    if (crc == VAN_CRC_UNKNOWN) CalculateCrc();
+    return crc;
 } // TVanPacketRxDesc::Crc
 
 // Checks the CRC value of a VAN packet
 bool TVanPacketRxDesc::CheckCrc() const
 {
-    uint16_t crc16 = 0x7FFF;
-
-    for (int i = 1; i < size; i++)  // Skip first byte (SOF, 0x0E)
-    {
-        unsigned char byte = bytes[i];
-
-        for (int j = 0; j < 8; j++)
-        {
-            uint16_t bit = crc16 & 0x4000;
-            if (byte & 0x80) bit ^= 0x4000;
-            byte <<= 1;
-            crc16 <<= 1;
-            if (bit) crc16 ^= VAN_CRC_POLYNOM;
-        } // for
-    } // if
-
-    crc16 &= 0x7FFF;
-
-    // Packet is OK if crc16 == 0x19B7
-    return crc16 == 0x19B7;
+    if (crc == VAN_CRC_UNKNOWN) CalculateCrc();
+    return crcOk;
 } // TVanPacketRxDesc::CheckCrc
 
-// Checks the CRC value of a VAN packet. If not, tries to repair it by flipping each bit.
+TVanPacketRxQueue& TVanPacketRxDesc::RxQueue() const
+{
+    TVanPacketRxQueue* rxQueue = bus < VAN_MAX_BUSES ? TVanPacketRxQueue::buses[bus] : NULL;
+    return rxQueue != NULL ? *rxQueue : VanBusRx;
+} // TVanPacketRxDesc::RxQueue
+
+// Advances a CRC-15 error pattern by one (zero) bit
+inline uint16_t _crc15ShiftZeroBit(uint16_t crc15)
+{
+    uint16_t bit = crc15 & 0x4000;
+    crc15 = crc15 << 1 & 0x7FFF;
+    if (bit) crc15 ^= VAN_CRC_POLYNOM;
+    return crc15;
+} // _crc15ShiftZeroBit
+
+// Checks the CRC value of a VAN packet. If not, tries to repair it by flipping a single bit. If
+// 'repairTwoConsecutiveBits' is true, will also try to repair an error in two adjacent bits.
 // Note: let's keep the counters sane by calling this only once.
-bool TVanPacketRxDesc::CheckCrcAndRepair()
+bool TVanPacketRxDesc::CheckCrcAndRepair(bool repairTwoConsecutiveBits)
 {
     if (CheckCrc()) return true;
 
-    VanBusRx.nCorrupt++;
-
-    for (int atByte = 0; atByte < size; atByte++)
+    // Skip first byte (SOF, 0x0E): it is not covered by the CRC
+    uint16_t syndrome = _crc15(0x7FFF, bytes + 1, size - 1) ^ 0x19B7;
+
+    TVanPacketRxQueue& rxQueue = RxQueue();
+    rxQueue.nCorrupt++;
+
+    // The CRC is linear, so flipping a bit changes the CRC register by a fixed pattern that depends only on the
+    // number of bits that follow the flipped bit. Instead of flipping each bit and re-calculating the CRC, walk the
+    // error patterns from the last bit backwards and compare each with the syndrome. This costs about the same as one
+    // (bit-by-bit) CRC calculation.
+    // Note: for packets up to VAN_MAX_PACKET_SIZE bytes, all single-bit and two-consecutive-bit error patterns are
+    // different from each other.
+    int nBits = (size - 1) * 8;
+    uint16_t errorPattern = VAN_CRC_POLYNOM;  // Pattern for the last bit of the packet
+    for (int atBit = 0; atBit < nBits; atBit++)
     {
-        for (int atBit = 0; atBit < 8; atBit++)
+        uint16_t nextErrorPattern = _crc15ShiftZeroBit(errorPattern);
+
+        if (syndrome == errorPattern)
         {
-            uint8_t mask = 1 << atBit;
-            bytes[atByte] ^= mask;  // Flip
-            if (CheckCrc())
-            {
-                VanBusRx.nRepaired++;
-                return true;
-            } // if
-            bytes[atByte] ^= mask;  // Flip back            
-        } // for
+            bytes[size - 1 - atBit / 8] ^= 1 << atBit % 8;  // Flip
+            crc = VAN_CRC_UNKNOWN;
+            rxQueue.nOneBitErrors++;
+            rxQueue.nRepaired++;
+            return true;
+        } // if
+
+        if (atBit + 1 < nBits && syndrome == (errorPattern ^ nextErrorPattern))
+        {
+            rxQueue.nTwoConsecutiveBitErrors++;
+            if (! repairTwoConsecutiveBits) break;
+
+            bytes[size - 1 - atBit / 8] ^= 1 << atBit % 8;  // Flip
+            bytes[size - 1 - (atBit + 1) / 8] ^= 1 << (atBit + 1) % 8;  // Flip the preceding bit too
+            crc = VAN_CRC_UNKNOWN;
+            rxQueue.nRepaired++;
+            return true;
+        } // if
+
+        errorPattern = nextErrorPattern;
     } // for
 
     return false;
 } // TVanPacketRxDesc::CheckCrcAndRepair
 
-// Dumps the raw packet bytes to a stream (e.g. 'Serial').
-// Optionally specify the last character; default is "\n" (newline).
-void TVanPacketRxDesc::DumpRaw(Stream& s, char last) const
+static const char hexDigits[16] =
 {
-    s.printf("Raw: #%04u (%*u/%u) %2d(%2d) ",
-        seqNo % 10000,
-        VAN_RX_QUEUE_SIZE > 100 ? 3 : VAN_RX_QUEUE_SIZE > 10 ? 2 : 1,  // This is all compile-time
-        slot + 1,
-        VAN_RX_QUEUE_SIZE,
-        size - 5 < 0 ? 0 : size - 5,
-        size);
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+}; // hexDigits
+
+inline char* _appendHex(char* p, uint8_t byte)
+{
+    *p++ = hexDigits[byte >> 4];
+    *p++ = hexDigits[byte & 0x0F];
+    return p;
+} // _appendHex
 
-    if (size >= 1) s.printf("%02X ", bytes[0]);  // SOF
-    if (size >= 3) s.printf("%03X %s ", Iden(), CommandFlagsStr());
+// Appends 'value' in decimal, with at least 'width' digits (or spaces, if 'pad' is ' ')
+inline char* _appendDec(char* p, unsigned int value, int width, char pad = '0')
+{
+    char digits[10];
+    int n = 0;
+    do
+    {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
 
-    for (int i = 3; i < size; i++) s.printf("%02X%c", bytes[i], i == size - 3 ? ':' : i < size - 1 ? '-' : ' ');
+    while (width-- > n) *p++ = pad;
+    while (n > 0) *p++ = digits[--n];
+    return p;
+} // _appendDec
 
-    s.print(AckStr());
-    s.print(" ");
-    s.print(ResultStr());
-    s.printf(" %04X", Crc());
-    s.printf(" %s", CheckCrc() ? "CRC_OK" : "CRC_ERROR");
+inline char* _appendStr(char* p, const char* str)
+{
+    while (*str) *p++ = *str++;
+    return p;
+} // _appendStr
+
+// Formats the raw packet bytes into 'buf', in the same way as 'DumpRaw(...)'. 'n' must be at least
+// VAN_MAX_DUMP_RAW_SIZE. Returns the number of characters written, including 'last' but excluding the terminating
+// '\0'; returns 0 if 'buf' is too small.
+// Note: does not use printf-like formatting, and calculates the CRC only once (see 'CalculateCrc()').
+int TVanPacketRxDesc::FormatRaw(char* buf, int n, char last) const
+{
+    if (n < VAN_MAX_DUMP_RAW_SIZE) return 0;
 
-    s.print(last);
+    char* p = _appendStr(buf, "Raw: #");
+    p = _appendDec(p, seqNo % 10000, 4);
+    p = _appendStr(p, " (");
+    int slotWidth = VAN_RX_QUEUE_SIZE > 100 ? 3 : VAN_RX_QUEUE_SIZE > 10 ? 2 : 1;
+    if (slot == VAN_RX_NO_SLOT)
+    {
+        while (--slotWidth > 0) *p++ = ' ';
+        *p++ = '-';
+    }
+    else
+    {
+        p = _appendDec(p, slot + 1, slotWidth, ' ');
+    } // if
+    *p++ = '/';
+    p = _appendDec(p, VAN_RX_QUEUE_SIZE, 1);
+    *p++ = ')';
+    *p++ = ' ';
+    p = _appendDec(p, size - 5 < 0 ? 0 : size - 5, 2, ' ');
+    *p++ = '(';
+    p = _appendDec(p, size, 2, ' ');
+    *p++ = ')';
+    *p++ = ' ';
+
+    if (size >= 1)
+    {
+        p = _appendHex(p, bytes[0]);  // SOF
+        *p++ = ' ';
+    } // if
+
+    if (size >= 3)
+    {
+        // IDEN is 3 hex digits
+        *p++ = hexDigits[bytes[1] >> 4];
+        *p++ = hexDigits[bytes[1] & 0x0F];
+        *p++ = hexDigits[bytes[2] >> 4];
+        *p++ = ' ';
+
+        // Same as 'CommandFlagsStr()'
+        *p++ = bytes[2] & 0x02 ? 'R' : 'W';
+        *p++ = bytes[2] & 0x04 ? 'A' : '-';
+        *p++ = bytes[2] & 0x01 ? '1' : '0';
+        *p++ = ' ';
+    } // if
+
+    for (int i = 3; i < size; i++)
+    {
+        p = _appendHex(p, bytes[i]);
+        *p++ = i == size - 3 ? ':' : i < size - 1 ? '-' : ' ';
+    } // for
+
+    p = _appendStr(p, AckStr());
+    *p++ = ' ';
+    p = _appendStr(p, ResultStr());
+    *p++ = ' ';
+    uint16_t crc16 = Crc();
+    p = _appendHex(p, crc16 >> 8);
+    p = _appendHex(p, crc16 & 0xFF);
+    p = _appendStr(p, CheckCrc() ? " CRC_OK" : " CRC_ERROR");
+
+    *p++ = last;
+    *p = '\0';
+
+    return p - buf;
+} // TVanPacketRxDesc::FormatRaw
+
+// Dumps the raw packet bytes to a stream (e.g. 'Serial').
+// Optionally specify the last character; default is "\n" (newline).
+// Note: formats the whole line first, then passes it to the stream in one write.
+void TVanPacketRxDesc::DumpRaw(Stream& s, char last) const
+{
+    char buf[VAN_MAX_DUMP_RAW_SIZE];
+    int len = FormatRaw(buf, sizeof(buf), last);
+    s.write((const uint8_t*)buf, len);
 } // TVanPacketRxDesc::DumpRaw
 
 // Copy a VAN packet out of the receive queue, if available. Otherwise, returns false.
 // If a valid pointer is passed to 'isQueueOverrun', will report then clear any queue overrun condition.
 bool TVanPacketRxQueue::Receive(TVanPacketRxDesc& pkt, bool* isQueueOverrun)
 {
-    if (! Available()) return false;
+    TVanPacketRxDesc* rxDesc = Peek(isQueueOverrun);
+    if (rxDesc == NULL) return false;
 
     // Copy the whole packet descriptor out (including the debug info)
     // Note:
     // Instead of copying out, we could also just pass the pointer to the descriptor. However, then we would have to
     // wait with freeing the descriptor, thus keeping one precious queue slot allocated. It is better to copy the
     // packet into the (usually stack-allocated) memory of 'pkt' and free the queue slot as soon as possible. The
-    // caller can now keep the packet as long as needed.
-    pkt = *tail;
+    // caller can now keep the packet as long as needed. If copying is too costly, use 'Peek()' and 'Release()'.
+    pkt = *rxDesc;
+
+    Release();
+
+    return true;
+} // TVanPacketRxQueue::Receive
+
+// Lend the oldest VAN packet in the receive queue, if available. Otherwise, returns NULL.
+// If a valid pointer is passed to 'isQueueOverrun', will report then clear any queue overrun condition.
+// The packet stays in its queue slot, so no copy is made. It can be inspected and repaired (e.g. with
+// 'CheckCrcAndRepair()') in place. The caller must call 'Release()' as soon as it has finished with the packet;
+// until then, the slot is not available for receiving new packets.
+TVanPacketRxDesc* TVanPacketRxQueue::Peek(bool* isQueueOverrun)
+{
+    // Packets at the front of the queue that have a receive callback, are not returned here
+    DeliverRxEvents();
+
+    // Not allowed from within a receive callback
+    if (deliveringRxEvents) return NULL;
+
+    if (! Available()) return NULL;
 
     if (isQueueOverrun)
     {
@@ -169,13 +362,464 @@ bool TVanPacketRxQueue::Receive(TVanPacketRxDesc& pkt, bool* isQueueOverrun)
         ClearQueueOverrun();
     } // if
 
+    return Tail();
+} // TVanPacketRxQueue::Peek
+
+// Return the packet, as lent by 'Peek()', to the receive queue. Does nothing if no packet is available.
+void TVanPacketRxQueue::Release()
+{
+    if (! Available()) return;
+
     // Indicate packet buffer is available for next packet
-    tail->Init();
+    Tail()->Init();
 
     AdvanceTail();
+} // TVanPacketRxQueue::Release
+
+// Moves at most 'maxCount' received packets out of the Rx queue, into compact records. Returns the number of records
+// filled. Cheaper than calling 'Receive(...)' for each packet: only the valid bytes of each packet are copied, and the
+// queue state is checked only once per packet. A queue overrun is reported in the 'flags' of the first record.
+// As with 'Peek()', packets that have a receive callback are not returned here.
+int TVanPacketRxQueue::DrainTo(TVanPacketRecord* records, int maxCount)
+{
+    DeliverRxEvents();
+
+    // Not allowed from within a receive callback
+    if (deliveringRxEvents) return 0;
+
+#ifdef VAN_RX_DEFERRED_DECODING
+    DecodeCapturedEdges();
+#endif // VAN_RX_DEFERRED_DECODING
+
+    // A packet must be forwarded before it can leave the queue
+    if (gateway != NULL) ForwardReceived();
+
+    int n = 0;
+
+    // Slots that are VAN_RX_DONE are not touched by the ISR, so no need to disable interrupts while copying
+    while (n < maxCount && TailState() == VAN_RX_DONE)
+    {
+        TVanPacketRxDesc* rxDesc = Tail();
+        TVanPacketRecord* record = records + n;
+
+        record->timestamp = rxDesc->timestamp;
+        record->seqNo = rxDesc->seqNo;
+        record->size = rxDesc->size;
+        record->flags = rxDesc->result | (rxDesc->ack == VAN_ACK ? VAN_RECORD_ACK : 0);
+        memcpy(record->bytes, rxDesc->bytes, rxDesc->size);
+
+        if (n == 0 && IsQueueOverrun())
+        {
+            record->flags |= VAN_RECORD_QUEUE_OVERRUN;
+            ClearQueueOverrun();
+        } // if
+
+        // Indicate packet buffer is available for next packet
+        rxDesc->Init();
+        AdvanceTail();
+
+        n++;
+    } // while
+
+    return n;
+} // TVanPacketRxQueue::DrainTo
+
+void TVanPacketRxDesc::Load(const TVanPacketRecord& record)
+{
+    size = record.size > VAN_MAX_PACKET_SIZE ? VAN_MAX_PACKET_SIZE : record.size;
+    memcpy(bytes, record.bytes, size);
+    state = VAN_RX_DONE;
+    result = record.Result();
+    ack = record.Ack();
+    crc = VAN_CRC_UNKNOWN;
+    seqNo = record.seqNo;
+    timestamp = record.timestamp;
+    slot = VAN_RX_NO_SLOT;
+    bus = VAN_NO_BUS;
+} // TVanPacketRxDesc::Load
+
+void TVanPacketRxDesc::Load(const TVanPacketRecord& record, const TVanPacketRxQueue& rxQueue)
+{
+    Load(record);
+    bus = rxQueue.busIdx;
+} // TVanPacketRxDesc::Load
+
+// Allocates the IDEN filter bitmap if not yet done, and sets all its bytes to 'fill'. Returns false if out of memory.
+bool TVanPacketRxQueue::SetIdenFilter(uint8_t fill)
+{
+    uint8_t* filter = idenFilter;
+    if (filter == NULL) filter = (uint8_t*) malloc(VAN_IDEN_FILTER_SIZE);
+    if (filter == NULL) return false;
+
+    // Make sure the ISR will not use a half-filled bitmap
+    ISR_ATOMIC_SET(idenFilter, NULL);
+    memset(filter, fill, VAN_IDEN_FILTER_SIZE);
+    ISR_ATOMIC_SET(idenFilter, filter);
 
     return true;
-} // TVanPacketRxQueue::Receive
+} // TVanPacketRxQueue::SetIdenFilter
+
+// Removes the IDEN filter, so that packets with any IDEN value are received
+void TVanPacketRxQueue::AcceptAllIdens()
+{
+    uint8_t* filter = idenFilter;
+    ISR_ATOMIC_SET(idenFilter, NULL);
+    free(filter);
+} // TVanPacketRxQueue::AcceptAllIdens
+
+// Sets the IDEN filter to reject all packets. Use 'AcceptIden(...)' to then accept only selected IDEN values.
+// Returns false if out of memory.
+bool TVanPacketRxQueue::RejectAllIdens()
+{
+    return SetIdenFilter(0x00);
+} // TVanPacketRxQueue::RejectAllIdens
+
+// Sets the IDEN filter to accept packets with the specified IDEN value. Always returns true.
+bool TVanPacketRxQueue::AcceptIden(uint16_t iden)
+{
+    if (idenFilter == NULL) return true;  // Already accepting all
+    iden &= 0xFFF;
+    idenFilter[iden >> 3] |= 1 << (iden & 0x07);  // Single byte write; the ISR only reads
+    return true;
+} // TVanPacketRxQueue::AcceptIden
+
+// Sets the IDEN filter to reject packets with the specified IDEN value. Returns false if out of memory.
+bool TVanPacketRxQueue::RejectIden(uint16_t iden)
+{
+    if (idenFilter == NULL && ! SetIdenFilter(0xFF)) return false;
+    iden &= 0xFFF;
+    idenFilter[iden >> 3] &= ~(1 << (iden & 0x07));  // Single byte write; the ISR only reads
+    return true;
+} // TVanPacketRxQueue::RejectIden
+
+// Returns true if packets with the specified IDEN value pass the IDEN filter
+bool TVanPacketRxQueue::IsIdenAccepted(uint16_t iden) const
+{
+    if (idenFilter == NULL) return true;
+    iden &= 0xFFF;
+    return idenFilter[iden >> 3] & 1 << (iden & 0x07);
+} // TVanPacketRxQueue::IsIdenAccepted
+
+// Returns the entry for the specified IDEN in the duplicate suppression table, or NULL if not found
+TIdenLastSeen* TVanPacketRxQueue::FindLastSeen(uint16_t iden) const
+{
+    for (int i = 0; i < nLastSeen; i++) if (lastSeen[i].iden == iden) return lastSeen + i;
+    return NULL;
+} // TVanPacketRxQueue::FindLastSeen
+
+// Suppresses packets with the specified IDEN value if they are the same as the last delivered packet with that IDEN
+// value. If 'heartbeatMs' is not 0, will deliver a duplicate packet anyway if the last delivered packet was more than
+// 'heartbeatMs' milliseconds ago. Returns false if out of memory, or if there are already VAN_MAX_DUPLICATE_FILTERS
+// IDEN values with suppression of duplicates.
+bool TVanPacketRxQueue::SuppressDuplicates(uint16_t iden, uint16_t heartbeatMs)
+{
+    iden &= 0xFFF;
+
+    TIdenLastSeen* entry = FindLastSeen(iden);
+    if (entry != NULL)
+    {
+        ISR_ATOMIC_SET(entry->heartbeatMs, heartbeatMs);
+        return true;
+    } // if
+
+    if (lastSeen == NULL) lastSeen = (TIdenLastSeen*) malloc(VAN_MAX_DUPLICATE_FILTERS * sizeof(TIdenLastSeen));
+    if (lastSeen == NULL || nLastSeen >= VAN_MAX_DUPLICATE_FILTERS) return false;
+
+    // Fill in the new entry before the ISR can see it
+    entry = lastSeen + nLastSeen;
+    entry->iden = iden;
+    entry->heartbeatMs = heartbeatMs;
+    entry->size = 0;
+    ISR_ATOMIC_SET(nLastSeen, nLastSeen + 1);
+
+    return true;
+} // TVanPacketRxQueue::SuppressDuplicates
+
+// Stops suppressing duplicate packets with the specified IDEN value
+void TVanPacketRxQueue::DeliverDuplicates(uint16_t iden)
+{
+    TIdenLastSeen* entry = FindLastSeen(iden & 0xFFF);
+    if (entry == NULL) return;
+
+    // Move the last entry into the freed spot
+    noInterrupts();
+    *entry = lastSeen[--nLastSeen];
+    interrupts();
+} // TVanPacketRxQueue::DeliverDuplicates
+
+// Makes sure the next packet with the specified IDEN value will be delivered, even if it is a duplicate
+void TVanPacketRxQueue::ForgetLastSeen(uint16_t iden)
+{
+    TIdenLastSeen* entry = FindLastSeen(iden);
+    if (entry != NULL) entry->size = 0;  // Single byte write; safe w.r.t. ISR
+} // TVanPacketRxQueue::ForgetLastSeen
+
+// Returns true if the packet is a duplicate of the last delivered packet with the same IDEN, and must be suppressed.
+// Otherwise, registers the packet as last delivered. Packets with a receive error are never suppressed and never
+// registered. The CRC is not checked here: a corrupt packet is registered as is, but since the whole packet is
+// compared, the next correct copy will not match it, and is delivered.
+// Only to be called from ISR, unsafe otherwise
+bool ICACHE_RAM_ATTR TVanPacketRxQueue::_IsDuplicate(const TVanPacketRxDesc* rxDesc)
+{
+    if (nLastSeen == 0) return false;
+
+    // At least SOF, IDEN, COM and CRC
+    int size = rxDesc->size;
+    if (rxDesc->result != VAN_RX_PACKET_OK || size < 5) return false;
+
+    uint16_t iden = rxDesc->Iden();
+    int i = 0;
+    while (i < nLastSeen && lastSeen[i].iden != iden) i++;
+    if (i == nLastSeen) return false;
+
+    TIdenLastSeen* entry = lastSeen + i;
+    uint32_t now = millis();
+
+    // IDEN is already known to be equal; compare the rest, COM up to and including CRC
+    if (entry->size == size
+        && memcmp(entry->bytes, rxDesc->bytes + 2, size - 2) == 0
+        && (entry->heartbeatMs == 0 || now - entry->deliveredAt < entry->heartbeatMs))  // Arithmetic has safe roll-over
+    {
+        nDuplicates++;
+        return true;
+    } // if
+
+    memcpy(entry->bytes, rxDesc->bytes + 2, size - 2);
+    entry->size = size;
+    entry->deliveredAt = now;
+    return false;
+} // TVanPacketRxQueue::_IsDuplicate
+
+// Sets the function to call for each received packet that has no callback of its own (see 'Subscribe(...)'). Pass
+// NULL to go back to polling with 'Receive(...)' or 'Peek(...)'.
+void TVanPacketRxQueue::SetRxCallback(TVanPacketRxCallback callback)
+{
+    ISR_ATOMIC_SET(rxCallback, callback);
+} // TVanPacketRxQueue::SetRxCallback
+
+// Sets the function to call for each received packet with the specified IDEN value. When a callback was already set
+// for that IDEN value, it is replaced. Returns false if there are already VAN_MAX_RX_SUBSCRIPTIONS IDEN values with
+// a callback.
+bool TVanPacketRxQueue::Subscribe(uint16_t iden, TVanPacketRxCallback callback)
+{
+    iden &= 0xFFF;
+
+    for (int i = 0; i < nSubscriptions; i++)
+    {
+        if (subscriptions[i].iden == iden)
+        {
+            ISR_ATOMIC_SET(subscriptions[i].callback, callback);
+            return true;
+        } // if
+    } // for
+
+    if (nSubscriptions >= VAN_MAX_RX_SUBSCRIPTIONS) return false;
+
+    // Fill in the new entry before the ISR can see it
+    subscriptions[nSubscriptions].iden = iden;
+    subscriptions[nSubscriptions].callback = callback;
+    ISR_ATOMIC_SET(nSubscriptions, nSubscriptions + 1);
+
+    return true;
+} // TVanPacketRxQueue::Subscribe
+
+// Removes the callback for the specified IDEN value
+void TVanPacketRxQueue::Unsubscribe(uint16_t iden)
+{
+    iden &= 0xFFF;
+
+    for (int i = 0; i < nSubscriptions; i++)
+    {
+        if (subscriptions[i].iden == iden)
+        {
+            // Move the last entry into the freed spot
+            noInterrupts();
+            subscriptions[i] = subscriptions[--nSubscriptions];
+            interrupts();
+            return;
+        } // if
+    } // for
+} // TVanPacketRxQueue::Unsubscribe
+
+// Returns the callback function for packets with the specified IDEN value, or NULL if there is none
+TVanPacketRxCallback ICACHE_RAM_ATTR TVanPacketRxQueue::_FindRxCallback(uint16_t iden) const
+{
+    for (int i = 0; i < nSubscriptions; i++) if (subscriptions[i].iden == iden) return subscriptions[i].callback;
+    return rxCallback;
+} // TVanPacketRxQueue::_FindRxCallback
+
+// Passes the packets at the front of the receive queue to their callback function, as long as they have one. Stops
+// at the first packet without a callback; that packet is left for 'Receive(...)' or 'Peek(...)'.
+void TVanPacketRxQueue::DeliverRxEvents()
+{
+    // Called from within a callback?
+    if (deliveringRxEvents) return;
+    deliveringRxEvents = true;
+
+    // Any packet completing from here on must schedule a new delivery
+    ISR_ATOMIC_SET(_rxEventScheduled, false);
+
+    while (Available())
+    {
+        TVanPacketRxDesc* rxDesc = Tail();
+        TVanPacketRxCallback callback = _FindRxCallback(rxDesc->Iden());
+        if (callback == NULL) break;
+
+        // The packet is passed in its queue slot; no copy is made
+        callback(*rxDesc);
+
+        Release();
+    } // while
+
+    deliveringRxEvents = false;
+} // TVanPacketRxQueue::DeliverRxEvents
+
+void DeliverRxEventsScheduled()
+{
+    // Not known which bus scheduled this; the others have nothing to do, and return quickly
+    for (int i = 0; i < VAN_MAX_BUSES; i++)
+    {
+        if (TVanPacketRxQueue::buses[i] != NULL) TVanPacketRxQueue::buses[i]->DeliverRxEvents();
+    } // for
+} // DeliverRxEventsScheduled
+
+// Constructed once, so that the ISR does not have to
+static const std::function<void(void)> deliverRxEventsFn(DeliverRxEventsScheduled);
+
+// Schedules the callback for a just completed packet, to run as soon as the current 'loop()' iteration returns.
+// Only to be called from ISR, unsafe otherwise.
+void ICACHE_RAM_ATTR TVanPacketRxQueue::_ScheduleRxEvent(const TVanPacketRxDesc* rxDesc)
+{
+    if (_rxEventScheduled) return;
+    if (_FindRxCallback(rxDesc->Iden()) == NULL && ! _IsForwarded(rxDesc->Iden())) return;
+
+    // If the scheduler is out of slots, the next completed packet will try again
+    _rxEventScheduled = schedule_function(deliverRxEventsFn);
+} // TVanPacketRxQueue::_ScheduleRxEvent
+
+// Sets the transmitter that packets with a forwarded IDEN value (see 'ForwardIden(...)') are sent by; normally the
+// transmitter of another bus. Packets that are already in the Rx queue are not forwarded. Pass NULL to stop.
+// Note: do not forward an IDEN value in both directions while loopback is enabled (see
+// 'TVanPacketTxQueue::SetLoopback(...)'): each forwarded packet is then received again, and forwarded back.
+void TVanPacketRxQueue::SetGateway(TVanPacketTxQueue* txQueue)
+{
+    noInterrupts();
+    forwardIdx = _headIdx;
+    forwardSeqNo = count;
+    gateway = txQueue;
+    interrupts();
+} // TVanPacketRxQueue::SetGateway
+
+// Forwards packets with the specified IDEN value, see 'SetGateway(...)'. Returns false if out of memory.
+bool TVanPacketRxQueue::ForwardIden(uint16_t iden)
+{
+    if (forwardFilter == NULL)
+    {
+        uint8_t* filter = (uint8_t*) calloc(VAN_IDEN_FILTER_SIZE, 1);
+        if (filter == NULL) return false;
+        ISR_ATOMIC_SET(forwardFilter, filter);
+    } // if
+
+    iden &= 0xFFF;
+    forwardFilter[iden >> 3] |= 1 << (iden & 0x07);  // Single byte write; the ISR only reads
+    return true;
+} // TVanPacketRxQueue::ForwardIden
+
+// Forwards packets with any IDEN value, see 'SetGateway(...)'. Use 'StopForwardingIden(...)' to then leave out
+// selected IDEN values. Returns false if out of memory.
+bool TVanPacketRxQueue::ForwardAllIdens()
+{
+    if (! ForwardIden(0)) return false;
+    memset(forwardFilter, 0xFF, VAN_IDEN_FILTER_SIZE);
+    return true;
+} // TVanPacketRxQueue::ForwardAllIdens
+
+// Stops forwarding packets with the specified IDEN value
+void TVanPacketRxQueue::StopForwardingIden(uint16_t iden)
+{
+    if (forwardFilter == NULL) return;
+    iden &= 0xFFF;
+    forwardFilter[iden >> 3] &= ~(1 << (iden & 0x07));  // Single byte write; the ISR only reads
+} // TVanPacketRxQueue::StopForwardingIden
+
+// Returns true if packets with the specified IDEN value are forwarded, once a gateway is set
+bool TVanPacketRxQueue::IsIdenForwarded(uint16_t iden) const
+{
+    if (forwardFilter == NULL) return false;
+    iden &= 0xFFF;
+    return forwardFilter[iden >> 3] & 1 << (iden & 0x07);
+} // TVanPacketRxQueue::IsIdenForwarded
+
+// Returns true if packets with the specified IDEN value must be forwarded. Also called from ISR, to schedule the
+// forwarding.
+bool ICACHE_RAM_ATTR TVanPacketRxQueue::_IsForwarded(uint16_t iden) const
+{
+    const uint8_t* filter = forwardFilter;
+    return gateway != NULL && filter != NULL && filter[iden >> 3] & 1 << (iden & 0x07);
+} // TVanPacketRxQueue::_IsForwarded
+
+// Passes each packet that was received since the last call and has a forwarded IDEN value, to the gateway
+// transmitter. Only packets that were received without error, and have a correct CRC, are forwarded. The packet is
+// stuffed into the Tx queue directly from its Rx queue slot, including its CRC; no copy is made.
+// Called from 'Available()', so that a packet is always forwarded before it leaves the Rx queue.
+void TVanPacketRxQueue::ForwardReceived()
+{
+    TVanPacketTxQueue* txQueue = gateway;
+    if (txQueue == NULL) return;
+
+    // The next packet to forward is in the next slot. A slot that is not done, or holds an older packet (queue
+    // full), has not yet received it.
+    while (SlotState(forwardIdx) == VAN_RX_DONE && (int32_t)(pool[forwardIdx].seqNo - forwardSeqNo) >= 0)
+    {
+        TVanPacketRxDesc* rxDesc = pool + forwardIdx;
+
+        if (_IsForwarded(rxDesc->Iden()) && rxDesc->result == VAN_RX_PACKET_OK && rxDesc->CheckCrc())
+        {
+            if (txQueue->ForwardPacket(*rxDesc)) nForwarded++; else nForwardDropped++;
+        } // if
+
+        forwardIdx = (forwardIdx + 1) & VAN_RX_QUEUE_MASK;  // roll over if needed
+        forwardSeqNo = rxDesc->seqNo + 1;
+    } // while
+} // TVanPacketRxQueue::ForwardReceived
+
+// Counts the packet in 'lostPacket', lost because the Rx queue was full, and makes 'lostPacket' ready for the next
+// packet.
+// Only to be called from ISR, unsafe otherwise.
+void ICACHE_RAM_ATTR TVanPacketRxQueue::_CountLostPacket()
+{
+    _overrun = true;
+    nLost++;
+
+    if (lostPacket.size < 3)
+    {
+        // Cut off before the IDEN was complete
+        nLostOtherIdens++;
+    }
+    else
+    {
+        uint16_t iden = lostPacket.bytes[1] << 4 | lostPacket.bytes[2] >> 4;
+        int i = 0;
+        while (i < nLostIdens && lostPerIden[i].iden != iden) i++;
+
+        if (i < nLostIdens)
+        {
+            lostPerIden[i].count++;
+        }
+        else if (nLostIdens < VAN_MAX_LOST_IDENS)
+        {
+            lostPerIden[i].iden = iden;
+            lostPerIden[i].count = 1;
+            nLostIdens++;
+        }
+        else
+        {
+            nLostOtherIdens++;
+        } // if
+    } // if
+
+    lostPacket.Init();
+} // TVanPacketRxQueue::_CountLostPacket
 
 // Simple function to generate a string representation of a float value.
 // Note: passed buffer size must be (at least) MAX_FLOAT_SIZE bytes, e.g. declare like this:
@@ -191,10 +835,133 @@ char* FloatToStr(char* buffer, float f, int prec)
     return strippedStr;
 } // FloatToStr
 
+uint32_t TVanHistogram::Count() const
+{
+    uint32_t n = 0;
+    for (int i = 0; i < VAN_HISTOGRAM_BUCKETS; i++) n += counts[i];
+    return n;
+} // TVanHistogram::Count
+
+uint32_t TVanHistogram::Percentile(int percent) const
+{
+    uint64_t needed = (uint64_t)Count() * percent;
+    uint64_t n = 0;
+
+    for (int i = 0; i < VAN_HISTOGRAM_BUCKETS - 1; i++)
+    {
+        n += counts[i];
+        if (n * 100 >= needed && n > 0) return (uint32_t)(i + 1) << shift;
+    } // for
+
+    return max;
+} // TVanHistogram::Percentile
+
+void TVanHistogram::Dump(Stream& s) const
+{
+    // Only the buckets that have a count
+    const char* separator = "";
+    for (int i = 0; i < VAN_HISTOGRAM_BUCKETS; i++)
+    {
+        if (counts[i] == 0) continue;
+
+        if (i < VAN_HISTOGRAM_BUCKETS - 1)
+        {
+            s.printf_P(PSTR("%s<%lu: %lu"), separator, (uint32_t)(i + 1) << shift, counts[i]);
+        }
+        else
+        {
+            s.printf_P(PSTR("%s>=%lu: %lu"), separator, (uint32_t)i << shift, counts[i]);
+        } // if
+
+        separator = ", ";
+    } // for
+
+    s.printf_P(PSTR("%smax: %lu"), separator, max);
+} // TVanHistogram::Dump
+
+// Fills 'stats' with a snapshot of the receiver statistics
+void TVanPacketRxQueue::GetStats(TVanRxStats& stats) const
+{
+    stats.nReceived = GetCount();
+    stats.nCorrupt = nCorrupt;
+    stats.nRepaired = nRepaired;
+    stats.nOneBitErrors = nOneBitErrors;
+    stats.nTwoConsecutiveBitErrors = nTwoConsecutiveBitErrors;
+    stats.nFiltered = nFiltered;
+    stats.nDuplicates = nDuplicates;
+#ifdef VAN_RX_DEFERRED_DECODING
+    stats.nEdgesLost = nEdgesLost;
+#else
+    stats.nEdgesLost = 0;
+#endif // VAN_RX_DEFERRED_DECODING
+    stats.nForwarded = nForwarded;
+    stats.nForwardDropped = nForwardDropped;
+
+    // Copy each group of values that belong together with interrupts disabled, but keep each such period short
+    noInterrupts();
+    stats.nErrorNBits = nResults[VAN_RX_ERROR_NBITS];
+    stats.nErrorManchester = nResults[VAN_RX_ERROR_MANCHESTER];
+    stats.nErrorMaxPacket = nResults[VAN_RX_ERROR_MAX_PACKET];
+    stats.maxQueueLevel = maxQueueLevel;
+    stats.nQueueHighWater = nQueueHighWater;
+    stats.busyBits = busyBits;
+    interrupts();
+
+    noInterrupts();
+    stats.nLost = nLost;
+    stats.nLostIdens = nLostIdens;
+    memcpy(stats.lostPerIden, lostPerIden, sizeof(lostPerIden));
+    stats.nLostOtherIdens = nLostOtherIdens;
+    interrupts();
+
+    noInterrupts();
+    uint32_t nSof = nSofMeasured;
+    uint64_t sofSum = sofCyclesSum;
+    uint32_t sofMin = sofCyclesMin;
+    uint32_t sofMax = sofCyclesMax;
+    interrupts();
+
+    noInterrupts();
+    stats.isrCycles = isrCycles;
+    interrupts();
+
+    noInterrupts();
+    stats.edgeLateness = edgeLateness;
+    interrupts();
+
+    // 125 bits per millisecond
+    stats.elapsedMs = millis() - statsSince;  // Arithmetic has safe roll-over
+    stats.busLoadPercent = stats.elapsedMs == 0 ? 0.0 : 100.0 * stats.busyBits / (stats.elapsedMs * 125.0);
+
+    // Note: a longer SOF means a slower clock
+    stats.nSofMeasured = nSof;
+    stats.busClockPercent = nSof == 0 ? 0.0 : 100.0 * VAN_SOF_NOMINAL_CYCLES * nSof / sofSum - 100.0;
+    stats.busClockMinPercent = nSof == 0 ? 0.0 : 100.0 * VAN_SOF_NOMINAL_CYCLES / sofMax - 100.0;
+    stats.busClockMaxPercent = nSof == 0 ? 0.0 : 100.0 * VAN_SOF_NOMINAL_CYCLES / sofMin - 100.0;
+} // TVanPacketRxQueue::GetStats
+
+// Restarts the histograms, the maximum queue level and the bus load measurement
+void TVanPacketRxQueue::ResetStats()
+{
+    noInterrupts();
+    isrCycles.Clear();
+    interrupts();
+
+    noInterrupts();
+    edgeLateness.Clear();
+    maxQueueLevel = 0;
+    busyBits = 0;
+    statsSince = millis();
+    interrupts();
+} // TVanPacketRxQueue::ResetStats
+
 // Dumps packet statistics
 void TVanPacketRxQueue::DumpStats(Stream& s) const
 {
-    uint32_t pktCount = GetCount();
+    TVanRxStats stats;
+    GetStats(stats);
+
+    uint32_t pktCount = stats.nReceived;
 
    char floatBuf[MAX_FLOAT_SIZE];
 
@@ -202,29 +969,181 @@ void TVanPacketRxQueue::DumpStats(Stream& s) const
     s.printf_P(
         PSTR("received pkts: %lu, corrupt: %lu (%s%%)"),
         pktCount,
-        nCorrupt,
+        stats.nCorrupt,
         pktCount == 0
             ? "-.---"
-            : FloatToStr(floatBuf, 100.0 * nCorrupt / pktCount, 3));
+            : FloatToStr(floatBuf, 100.0 * stats.nCorrupt / pktCount, 3));
 
     s.printf_P(
         PSTR(", repaired: %lu (%s%%)"),
-        nRepaired,
-        nCorrupt == 0
+        stats.nRepaired,
+        stats.nCorrupt == 0
             ? "---" 
-            : FloatToStr(floatBuf, 100.0 * nRepaired / nCorrupt, 0));
+            : FloatToStr(floatBuf, 100.0 * stats.nRepaired / stats.nCorrupt, 0));
+
+    s.printf_P(
+        PSTR(" (one bit: %lu, two consecutive bits: %lu)"),
+        stats.nOneBitErrors,
+        stats.nTwoConsecutiveBitErrors);
 
-    uint32_t overallCorrupt = nCorrupt - nRepaired;
+    uint32_t overallCorrupt = stats.nCorrupt - stats.nRepaired;
     s.printf_P(
-        PSTR(", overall: %lu (%s%%)\n"),
+        PSTR(", overall: %lu (%s%%)"),
         overallCorrupt,
         pktCount == 0
             ? "-.---" 
             : FloatToStr(floatBuf, 100.0 * overallCorrupt / pktCount, 3));
+
+    if (idenFilter != NULL) s.printf_P(PSTR(", filtered: %lu"), stats.nFiltered);
+    if (nLastSeen != 0) s.printf_P(PSTR(", duplicates: %lu"), stats.nDuplicates);
+
+#ifdef VAN_RX_DEFERRED_DECODING
+    s.printf_P(PSTR(", edges lost: %lu"), stats.nEdgesLost);
+#endif // VAN_RX_DEFERRED_DECODING
+
+    if (gateway != NULL)
+    {
+        s.printf_P(PSTR(", forwarded: %lu (dropped: %lu)"), stats.nForwarded, stats.nForwardDropped);
+    } // if
+
+    // Estimated bus clock, as deviation from the nominal 125 kbit/sec
+    if (stats.nSofMeasured != 0)
+    {
+        s.printf_P(PSTR(", bus clock: %s%%"), FloatToStr(floatBuf, stats.busClockPercent, 2));
+        s.printf_P(PSTR(" (min: %s%%"), FloatToStr(floatBuf, stats.busClockMinPercent, 2));
+        s.printf_P(PSTR(", max: %s%%)"), FloatToStr(floatBuf, stats.busClockMaxPercent, 2));
+    } // if
+
+    s.print("\n");
+
+    s.printf_P(
+        PSTR("read errors: nbits: %lu, manchester: %lu, max packet: %lu; queue max: %u/%u, high water: %lu"),
+        stats.nErrorNBits,
+        stats.nErrorManchester,
+        stats.nErrorMaxPacket,
+        stats.maxQueueLevel,
+        VAN_RX_QUEUE_SIZE,
+        stats.nQueueHighWater);
+
+    s.printf_P(PSTR(", bus load: %s%%"), FloatToStr(floatBuf, stats.busLoadPercent, 1));
+
+    if (stats.nLost != 0)
+    {
+        s.printf_P(PSTR(", lost: %lu ("), stats.nLost);
+        for (int i = 0; i < stats.nLostIdens; i++)
+        {
+            s.printf_P(PSTR("%03X: %lu, "), stats.lostPerIden[i].iden, stats.lostPerIden[i].count);
+        } // for
+        s.printf_P(PSTR("other: %lu)"), stats.nLostOtherIdens);
+    } // if
+
+    s.print("\n");
+
+    if (stats.isrCycles.Count() != 0)
+    {
+        s.print("Rx ISR CPU cycles: ");
+        stats.isrCycles.Dump(s);
+        s.print("\n");
+    } // if
+
+    if (stats.edgeLateness.Count() != 0)
+    {
+        s.print("Rx edge lateness CPU cycles: ");
+        stats.edgeLateness.Dump(s);
+        s.print("\n");
+    } // if
 } // TVanPacketRxQueue::DumpStats
 
+// Bit time classification, used by 'nBitsFromCycles'.
+//
+// The tuning values below are expressed in units of 1/640 bit time. At 80 MHz, this equals 1 CPU cycle. They were
+// found empirically (see the real-world tests in 'nBitsFromCycles'):
+// - Upper bound (exclusive) of the time for 1, 2, ..., 5 bits
+// - Time for 1, 2, ..., 5 bits above which the excess is carried over as jitter into the next bit time
+// Both can be overridden with a build flag of 5 comma-separated values, e.g. to try other values on recorded traces
+// with the replay harness in 'extras/replay'.
+#define VAN_BIT_CLASS_MAX_BITS 5
+
+#ifndef VAN_BIT_UPPER_BOUNDS
+#define VAN_BIT_UPPER_BOUNDS 1124, 1744, 2383, 3045, 3665
+#endif // VAN_BIT_UPPER_BOUNDS
+
+#ifndef VAN_BIT_JITTER_BASES
+#define VAN_BIT_JITTER_BASES 800, 1380, 2100, 2655, 3300
+#endif // VAN_BIT_JITTER_BASES
+
+constexpr uint32_t VanBitTuning(int i, uint32_t v1, uint32_t v2, uint32_t v3, uint32_t v4, uint32_t v5)
+{
+    return i == 1 ? v1 : i == 2 ? v2 : i == 3 ? v3 : i == 4 ? v4 : v5;
+} // VanBitTuning
+
+constexpr uint32_t VanBitCycles(uint32_t tuning) { return tuning * VAN_BIT_CPU_CYCLES / 640; }
+
+constexpr uint32_t VanBitUpperBound(int nBits)
+{
+    return VanBitCycles(VanBitTuning(nBits, VAN_BIT_UPPER_BOUNDS));
+} // VanBitUpperBound
+
+constexpr uint32_t VanBitJitterBase(int nBits)
+{
+    return VanBitCycles(VanBitTuning(nBits, VAN_BIT_JITTER_BASES));
+} // VanBitJitterBase
+
+// Number of bits for a given number of cycles, or 0 if more than VAN_BIT_CLASS_MAX_BITS
+constexpr uint8_t VanBitClass(uint32_t nCycles, int nBits = 1)
+{
+    return
+        nBits > VAN_BIT_CLASS_MAX_BITS ? 0 :
+        nCycles < VanBitUpperBound(nBits) ? nBits :
+        VanBitClass(nCycles, nBits + 1);
+} // VanBitClass
+
+// The lookup table is indexed by 'nCycles >> VAN_BIT_LUT_SHIFT'. A slot must be smaller than the smallest distance
+// between two upper bounds, so that each slot contains at most one upper bound; that bound is stored in the slot.
+#define VAN_BIT_LUT_SHIFT (CPU_F_FACTOR == 1 ? 9 : 10)
+#define VAN_BIT_LUT_SLOT (1UL << VAN_BIT_LUT_SHIFT)
+#define VAN_BIT_LUT_SIZE 8
+
+static_assert(VAN_BIT_LUT_SLOT < VanBitUpperBound(2) - VanBitUpperBound(1), "VAN_BIT_LUT_SHIFT too large");
+static_assert(VAN_BIT_LUT_SLOT < VanBitUpperBound(3) - VanBitUpperBound(2), "VAN_BIT_LUT_SHIFT too large");
+static_assert(VAN_BIT_LUT_SLOT < VanBitUpperBound(4) - VanBitUpperBound(3), "VAN_BIT_LUT_SHIFT too large");
+static_assert(VAN_BIT_LUT_SLOT < VanBitUpperBound(5) - VanBitUpperBound(4), "VAN_BIT_LUT_SHIFT too large");
+static_assert(VanBitUpperBound(VAN_BIT_CLASS_MAX_BITS) >> VAN_BIT_LUT_SHIFT < VAN_BIT_LUT_SIZE,
+    "VAN_BIT_LUT_SIZE too small");
+
+struct TVanBitClass
+{
+    uint16_t bound;  // Below this: 'nBitsBelow', else 'nBitsAbove'
+    uint8_t nBitsBelow;
+    uint8_t nBitsAbove;  // 0 = more than VAN_BIT_CLASS_MAX_BITS
+}; // struct TVanBitClass
+
+#define VAN_BIT_LUT_ENTRY(I) \
+{ \
+    (uint16_t) (VanBitClass((I) * VAN_BIT_LUT_SLOT) == VanBitClass(((I) + 1) * VAN_BIT_LUT_SLOT - 1) \
+        ? ((I) + 1) * VAN_BIT_LUT_SLOT \
+        : VanBitUpperBound(VanBitClass((I) * VAN_BIT_LUT_SLOT))), \
+    VanBitClass((I) * VAN_BIT_LUT_SLOT), \
+    VanBitClass(((I) + 1) * VAN_BIT_LUT_SLOT - 1) \
+}
+
+// Generated at compile time, for the CPU frequency at hand.
+// Note: on the ESP8266, const data is in DRAM, so it is safe to read from ISR.
+static const TVanBitClass bitClassLut[VAN_BIT_LUT_SIZE] =
+{
+    VAN_BIT_LUT_ENTRY(0), VAN_BIT_LUT_ENTRY(1), VAN_BIT_LUT_ENTRY(2), VAN_BIT_LUT_ENTRY(3),
+    VAN_BIT_LUT_ENTRY(4), VAN_BIT_LUT_ENTRY(5), VAN_BIT_LUT_ENTRY(6), VAN_BIT_LUT_ENTRY(7)
+}; // bitClassLut
+
+static const uint16_t bitJitterBase[VAN_BIT_CLASS_MAX_BITS + 1] =
+{
+    0, VanBitJitterBase(1), VanBitJitterBase(2), VanBitJitterBase(3), VanBitJitterBase(4), VanBitJitterBase(5)
+}; // bitJitterBase
+
 // Calculate number of bits from a number of elapsed CPU cycles
-// TODO - does ICACHE_RAM_ATTR have any effect on an inline function?
+// Note: when the compiler inlines this function, the code ends up in the caller (in IRAM). When the compiler decides
+// not to inline it (e.g. in 'TIsrDebugPacket::Dump()'), ICACHE_RAM_ATTR makes sure the out-of-line copy is also in
+// IRAM, so that it is safe to call from ISR.
 inline unsigned int ICACHE_RAM_ATTR nBitsFromCycles(uint32_t nCycles, uint32_t& jitter)
 {
     // Here is the heart of the machine; lots of voodoo magic here...
@@ -252,108 +1171,102 @@ inline unsigned int ICACHE_RAM_ATTR nBitsFromCycles(uint32_t nCycles, uint32_t&
     //   5 bit times varies between 3161 and 3255 cycles
     //                                                  
 
-    // Prevent calculations with roll-over (e.g. if nCycles = 2^32 - 1, adding 347 will roll over to 346)
-    // Well no... do we really care?
-    //if (nCycles > 999999 * 694 - 347) return 999999;
-
     // Sometimes, samples are stretched, because the ISR is called too late. If that happens,
     // we must compress the "sample time" for the next bit.
     nCycles += jitter;
     jitter = 0;
-    if (nCycles < 1124 * CPU_F_FACTOR)
-    {
-        if (nCycles > 800 * CPU_F_FACTOR) jitter = nCycles - 800 * CPU_F_FACTOR;
-        return 1;
-    } // if
-    if (nCycles < 1744 * CPU_F_FACTOR)
-    {
-        if (nCycles > 1380 * CPU_F_FACTOR) jitter = nCycles - 1380 * CPU_F_FACTOR;
-        return 2;
-    } // if
-    if (nCycles < 2383 * CPU_F_FACTOR)
-    {
-        if (nCycles > 2100 * CPU_F_FACTOR) jitter = nCycles - 2100 * CPU_F_FACTOR;
-        return 3;
-    } // if
-    if (nCycles < 3045 * CPU_F_FACTOR)
-    {
-        if (nCycles > 2655 * CPU_F_FACTOR) jitter = nCycles - 2655 * CPU_F_FACTOR;
-        return 4;
-    } // if
-    if (nCycles < 3665 * CPU_F_FACTOR)
+
+    // One table lookup and one compare, in stead of a ladder of compares
+    unsigned int slot = nCycles >> VAN_BIT_LUT_SHIFT;
+    if (slot < VAN_BIT_LUT_SIZE)
     {
-        if (nCycles > 3300 * CPU_F_FACTOR) jitter = nCycles - 3300 * CPU_F_FACTOR;
-        return 5;
+        const TVanBitClass& bitClass = bitClassLut[slot];
+        unsigned int nBits = nCycles < bitClass.bound ? bitClass.nBitsBelow : bitClass.nBitsAbove;
+        if (nBits != 0)
+        {
+            if (nCycles > bitJitterBase[nBits]) jitter = nCycles - bitJitterBase[nBits];
+            return nBits;
+        } // if
     } // if
 
     // We hardly ever get here. And if we do, the "number of bits" is not so important.
-    //unsigned int nBits = (nCycles + 347) / 694;
-    //unsigned int nBits = (nCycles + 335) / 640; // ( 305...944==1; 945...1584==2; 1585...2224==3; 2225...2864==4, ...
-    //unsigned int nBits = (nCycles + 347) / 660;
-    //unsigned int nBits = (nCycles + 250) / 640;
-    //unsigned int nBits = (nCycles + 300 * CPU_F_FACTOR) / 640 * CPU_F_FACTOR;
-    unsigned int nBits = (nCycles + 300 * CPU_F_FACTOR) / 650 * CPU_F_FACTOR;
-
-    return nBits;
+    return (nCycles + 300 * CPU_F_FACTOR) / (650 * CPU_F_FACTOR);
 } // nBitsFromCycles
 
-void ICACHE_RAM_ATTR SetTxBitTimer()
+// The time-out for the ACK bit has expired: the packet is VAN_RX_DONE. 'ack' has already been initially set to
+// VAN_NO_ACK, and then to VAN_ACK if a new bit was received within the time-out period.
+void ICACHE_RAM_ATTR FinishPacketReception(TVanPacketRxQueue& rx)
 {
-    timer1_disable(); 
+    TVanPacketRxDesc* rxDesc = rx._Head();
 
-    if (VanBusRx.txTimerIsr)
-    {
-        // Turn on the Tx bit timer
-        timer1_attachInterrupt(VanBusRx.txTimerIsr);
-
-        // Clock to timer (prescaler) is always 80MHz, even F_CPU is 160 MHz
-        timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+    // E.g. the ACK time-out of a packet in 'lostPacket', when a queue slot has become free in the meantime
+    if (rxDesc->state != VAN_RX_WAITING_ACK) return;
 
-        timer1_write(VanBusRx.txTimerTicks);
+    // Suppressed duplicate packet? Then just re-use the slot for the next packet. A lost packet is not registered
+    // as delivered.
+    if (rxDesc != &rx.lostPacket && rx._IsDuplicate(rxDesc))
+    {
+        rxDesc->Init();
+        return;
     } // if
-} // SetTxBitTimer
 
-// If the timeout expires, the packet is VAN_RX_DONE. 'ack' has already been initially set to VAN_NO_ACK,
-// and then to VAN_ACK if a new bit was received within the time-out period.
-void ICACHE_RAM_ATTR WaitAckIsr()
-{
-    SetTxBitTimer();
+    rx._AdvanceHead();
+} // FinishPacketReception
 
-    VanBusRx._AdvanceHead();
+// ACK time-out, see 'TVanBusTimer'. 'context' is the receiving queue.
+void ICACHE_RAM_ATTR WaitAckIsr(void* context)
+{
+    FinishPacketReception(*(TVanPacketRxQueue*)context);
 } // WaitAckIsr
 
-// Pin level change interrupt handler
-void ICACHE_RAM_ATTR RxPinChangeIsr()
-{
-    // The logic is:
-    // - if pinLevelChangedTo == VAN_LOGICAL_HIGH, we've just had a series of VAN_LOGICAL_LOW bits.
-    // - if pinLevelChangedTo == VAN_LOGICAL_LOW, we've just had a series of VAN_LOGICAL_HIGH bits.
-    int pinLevelChangedTo = GPIP(VanBusRx.pin);  // GPIP() is faster than digitalRead()?
-    static int prevPinLevelChangedTo = VAN_BIT_RECESSIVE;
+// Time-out for the ACK bit: 2 time slots after EOD, like 'WaitAckIsr'
+#define VAN_ACK_TIMEOUT_CYCLES (2 * VAN_BIT_CPU_CYCLES)
 
-    static uint32_t prev = 0;
-    uint32_t curr = ESP.getCycleCount();  // Store CPU cycle counter value as soon as possible
+// Bit decoder: processes one pin level change, at CPU cycle counter value 'curr'. Called directly from
+// 'RxPinChangeIsr', or, if VAN_RX_DEFERRED_DECODING is defined, from 'TVanPacketRxQueue::DecodeCapturedEdges()'.
+// The logic is:
+// - if pinLevelChangedTo == VAN_LOGICAL_HIGH, we've just had a series of VAN_LOGICAL_LOW bits.
+// - if pinLevelChangedTo == VAN_LOGICAL_LOW, we've just had a series of VAN_LOGICAL_HIGH bits.
+inline void ICACHE_RAM_ATTR DecodeRxEdge(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr)
+{
+    TIsrRxState& isr = rx.isrState;
 
-    // Return quickly when it is a spurious interrupt (pin level not changed).
-    if (pinLevelChangedTo == prevPinLevelChangedTo) return;
-    prevPinLevelChangedTo = pinLevelChangedTo;
+    uint32_t nCycles = curr - isr.prev;  // Arithmetic has safe roll-over
+    isr.prev = curr;
 
-    // Media access detection for packet transmission
-    if (pinLevelChangedTo == VAN_BIT_RECESSIVE)
+    // Clock recovery: normalize to the bit time as measured from the SOF of the current packet
+    uint32_t rawCycles = nCycles;
+    if (isr.bitScale != VAN_BIT_SCALE_ONE && nCycles < VAN_BIT_SCALE_MAX_CYCLES)
     {
-        // Pin level just changed to 'recessive', so that was the end of the media access ('dominant')
-        VanBusRx.lastMediaAccessAt = curr;
+        nCycles = nCycles * isr.bitScale >> VAN_BIT_SCALE_SHIFT;
     } // if
 
-    uint32_t nCycles = curr - prev;  // Arithmetic has safe roll-over
-    prev = curr;
+    unsigned int nBits = nBitsFromCycles(nCycles, isr.jitter);
 
-    static uint32_t jitter = 0;
-    unsigned int nBits = nBitsFromCycles(nCycles, jitter);
- 
-    TVanPacketRxDesc* rxDesc = VanBusRx._head;
+    // Statistics: bus load, and how much later than a whole number of bit times after the previous pin level change
+    // this one was seen. A longer run of equal bits means the bus is idle.
+    if (nBits <= 9)
+    {
+        rx.busyBits += nBits;
+        int32_t late = nCycles - nBits * VAN_BIT_CPU_CYCLES;
+        rx.edgeLateness.Add(late > 0 ? late : 0);
+    } // if
+
+    TVanPacketRxDesc* rxDesc = rx._Head();
     PacketReadState_t state = rxDesc->state;
-    rxDesc->slot = rxDesc - VanBusRx.pool;
+    rxDesc->slot = rx._headIdx;
+
+#ifdef VAN_RX_DEFERRED_DECODING
+    // There is no ACK timer: a pin level change later than the ACK time-out is the start of the next packet
+    if (state == VAN_RX_WAITING_ACK && curr - isr.eodAt > VAN_ACK_TIMEOUT_CYCLES)
+    {
+        FinishPacketReception(rx);
+
+        rxDesc = rx._Head();
+        state = rxDesc->state;
+        rxDesc->slot = rx._headIdx;
+    } // if
+#endif // VAN_RX_DEFERRED_DECODING
 
 #ifdef VAN_RX_ISR_DEBUGGING
     // Record some data to be used for debugging outside this ISR
@@ -376,7 +1289,7 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
     { \
         if (state != VAN_RX_DONE && isrDebugPacket->at < VAN_ISR_DEBUG_BUFFER_SIZE) \
         { \
-            debugIsr->pinLevelAtReturnFromIsr = GPIP(VanBusRx.pin); \
+            debugIsr->pinLevelAtReturnFromIsr = GPIP(rx.pin); \
             debugIsr->nCyclesProcessing = ESP.getCycleCount() - curr; \
             isrDebugPacket->at++; \
         } \
@@ -384,18 +1297,35 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
     }
 #endif // VAN_RX_ISR_DEBUGGING
 
-    static unsigned int atBit = 0;
-    static uint16_t readBits = 0;
+    if (state == VAN_RX_SKIPPING)
+    {
+        // Skip the rest of a packet that was rejected by the IDEN filter. Wait until the bus has been idle (EOF + IFS),
+        // then treat this as a vacant slot.
+        if (nBits <= 9 || pinLevelChangedTo != VAN_LOGICAL_LOW) return;
+
+        rxDesc->state = VAN_RX_VACANT;
+        state = VAN_RX_VACANT;
+    } // if
 
     if (state == VAN_RX_VACANT)
     {
         // Wait until we've seen a series of VAN_LOGICAL_HIGH bits
         if (pinLevelChangedTo == VAN_LOGICAL_LOW)
         {
+            // A queue slot became free while a packet was being decoded into 'lostPacket': that packet is cut off
+            TVanPacketRxDesc* lost = &rx.lostPacket;
+            if (rxDesc != lost && lost->state != VAN_RX_VACANT)
+            {
+                if (lost->state == VAN_RX_LOADING || lost->state == VAN_RX_WAITING_ACK) rx._CountLostPacket();
+                else lost->Init();
+            } // if
+
             rxDesc->state = VAN_RX_SEARCHING;
             rxDesc->ack = VAN_NO_ACK;
-            atBit = 0;
-            readBits = 0;
+            isr.atBit = 0;
+            isr.readBits = 0;
+            isr.sofCycles = 0;
+            isr.bitScale = VAN_BIT_SCALE_ONE;
             rxDesc->size = 0;
 
             //timer1_disable(); // TODO - necessary?
@@ -409,7 +1339,7 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
         rxDesc->ack = VAN_ACK;
 
         // The timer ISR 'WaitAckIsr' will do this
-        //VanBusRx._AdvanceHead();
+        //rx._AdvanceHead();
 
         return;
     } // if
@@ -417,7 +1347,7 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
     // If the current head packet is already VAN_RX_DONE, the circular buffer is completely full
     if (state != VAN_RX_SEARCHING && state != VAN_RX_LOADING)
     {
-        VanBusRx._overrun = true;
+        rx._overrun = true;
         //SetTxBitTimer();
         return;
     } // if
@@ -430,14 +1360,16 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
     {
         if (state == VAN_RX_SEARCHING)
         {
-            atBit = 0;
-            readBits = 0;
+            isr.atBit = 0;
+            isr.readBits = 0;
+            isr.sofCycles = 0;
+            isr.bitScale = VAN_BIT_SCALE_ONE;
             rxDesc->size = 0;
             return;
         } // if
 
         rxDesc->result = VAN_RX_ERROR_NBITS;
-        VanBusRx._AdvanceHead();
+        rx._AdvanceHead();
         //WaitAckIsr();
 
         return;
@@ -446,27 +1378,51 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
     // Wait at most one extra bit time for the Manchester bit (5 --> 4, 10 --> 9)
     // But... Manchester bit error at bit 10 is needed to see EOD, so skip that.
     if (nBits > 1
-        && (atBit + nBits == 5
-            /*|| (rxDesc->size < 5 && atBit + nBits == 9)*/))
+        && (isr.atBit + nBits == 5
+            /*|| (rxDesc->size < 5 && isr.atBit + nBits == 9)*/))
     {
         nBits--;
-        jitter = 500;
+        isr.jitter = 500;
+    } // if
+
+    // Measure the time taken by the first 9 bits of the SOF
+    if (state == VAN_RX_SEARCHING && isr.atBit < VAN_SOF_MEASURED_BITS)
+    {
+        isr.sofCycles += rawCycles;
+
+        if (isr.atBit + nBits == VAN_SOF_MEASURED_BITS)
+        {
+            uint32_t sofCycles = isr.sofCycles;
+            if (sofCycles > VAN_SOF_MIN_CYCLES && sofCycles < VAN_SOF_MAX_CYCLES)
+            {
+                rx.nSofMeasured++;
+                rx.sofCyclesSum += sofCycles;
+                if (sofCycles < rx.sofCyclesMin) rx.sofCyclesMin = sofCycles;
+                if (sofCycles > rx.sofCyclesMax) rx.sofCyclesMax = sofCycles;
+
+                // Just one division per packet
+                if (rx.clockRecovery)
+                {
+                    isr.bitScale = ((uint32_t)VAN_SOF_NOMINAL_CYCLES << VAN_BIT_SCALE_SHIFT) / sofCycles;
+                } // if
+            } // if
+        } // if
     } // if
 
-    atBit += nBits;
-    readBits <<= nBits;
+    isr.atBit += nBits;
+    isr.readBits <<= nBits;
 
     // Remember: if pinLevelChangedTo == VAN_LOGICAL_LOW, we've just had a series of VAN_LOGICAL_HIGH bits
     uint16_t pattern = 0;
     if (pinLevelChangedTo == VAN_LOGICAL_LOW) pattern = (1 << nBits) - 1;
-    readBits |= pattern;
+    isr.readBits |= pattern;
 
-    if (atBit >= 10)
+    if (isr.atBit >= 10)
     {
-        atBit -= 10;
+        isr.atBit -= 10;
 
         // uint16_t, not uint8_t: we are reading 10 bits per byte ("Enhanced Manchester" encoding)
-        uint16_t currentByte = readBits >> atBit;
+        uint16_t currentByte = isr.readBits >> isr.atBit;
 
         if (state == VAN_RX_SEARCHING)
         {
@@ -482,7 +1438,7 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
         } // if
 
         // Get ready for next byte
-        readBits &= (1 << atBit) - 1;
+        isr.readBits &= (1 << isr.atBit) - 1;
 
         // Remove the 2 Manchester bits 'm'; the relevant 8 bits are 'X':
         //   9 8 7 6 5 4 3 2 1 0
@@ -491,12 +1447,28 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
 
         rxDesc->bytes[rxDesc->size++] = readByte;
 
+        // IDEN complete? Then apply the IDEN filter, if any
+        if (rxDesc->size == 3)
+        {
+            const uint8_t* filter = rx.idenFilter;
+            if (filter != NULL)
+            {
+                uint16_t iden = rxDesc->bytes[1] << 4 | readByte >> 4;
+                if ((filter[iden >> 3] & 1 << (iden & 0x07)) == 0)
+                {
+                    rx.nFiltered++;
+                    rxDesc->state = VAN_RX_SKIPPING;
+                    return;
+                } // if
+            } // if
+        } // if
+
         // EOD detected?
         if ((currentByte & 0x003) == 0)
         {
             // Not really necessary to do this within the limited time there is inside this ISR
             #if 0
-            if (   atBit != 0  // EOD must end with a transition 0 -> 1
+            if (   isr.atBit != 0  // EOD must end with a transition 0 -> 1
                 || (currentByte >> 1 & 0x20) == (currentByte & 0x20))
             {
                 rxDesc->result = VAN_RX_ERROR_MANCHESTER;
@@ -504,16 +1476,17 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
             #endif
 
             rxDesc->state = VAN_RX_WAITING_ACK;
+            isr.eodAt = curr;
 
-            // Set a timeout for the ACK bit
-            timer1_disable();
-            timer1_attachInterrupt(WaitAckIsr);
-
-            // Clock to timer (prescaler) is always 80MHz, even F_CPU is 160 MHz
-            timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+            // If VAN_RX_DEFERRED_DECODING is defined, 'DecodeRxEdge' and 'DecodeCapturedEdges' will check the ACK
+            // time-out
+#ifndef VAN_RX_DEFERRED_DECODING
+            // While transmitting, 'RxPinSampledByTx' will check the ACK time-out
+            if (isr.txLoopback) return;
 
-            //timer1_write(12 * 5); // 1.5 time slots = 1.5 * 8 us = 12 us
-            timer1_write(16 * 5); // 2 time slots = 2 * 8 us = 12 us
+            // Set a timeout for the ACK bit
+            VanBusTimer._Arm(VAN_TIMER_RX_SLOT(rx.busIdx), curr + VAN_ACK_TIMEOUT_CYCLES, WaitAckIsr, &rx);
+#endif // VAN_RX_DEFERRED_DECODING
 
             return;
         } // if
@@ -521,7 +1494,7 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
         if (rxDesc->size >= VAN_MAX_PACKET_SIZE)
         {
             rxDesc->result = VAN_RX_ERROR_MAX_PACKET;
-            VanBusRx._AdvanceHead();
+            rx._AdvanceHead();
             //WaitAckIsr();
 
             return;
@@ -540,20 +1513,390 @@ void ICACHE_RAM_ATTR RxPinChangeIsr()
         #endif
     } // if
 
+#ifndef VAN_RX_DEFERRED_DECODING
+    // In-frame response. Byte 2 is:
+    //   9 8 7 6 5 4   3   2   1   0
+    //   IDEN    m EXT RAK R/W RTR m
+    // With 4 or more bits of byte 2 read, the IDEN is complete. R/W and RTR are recessive in a "read" packet
+    // requesting an in-frame response, so there is no edge after the start of R/W until we overwrite RTR. Set a timer
+    // for the start of RTR; every new edge before that sets it more precisely.
+    // The response is sent with the bit timer, so skip it while another bus is transmitting.
+    if (rxDesc->size == 2 && isr.atBit >= 4 && isr.atBit <= 7 && rx.nInFrameResponses != 0 && ! isr.txLoopback
+        && ! VanBusTimer._IsBitTimerRunning())
+    {
+        uint16_t iden = rxDesc->bytes[1] << 4 | (isr.readBits >> (isr.atBit - 4) & 0x0F);
+        TVanPacketTxDesc* response = rx._FindInFrameResponse(iden);
+
+        // A change to VAN_LOGICAL_LOW at the start of R/W means "write"
+        if (isr.atBit == 7 && pinLevelChangedTo == VAN_LOGICAL_LOW) response = NULL;
+
+        if (response != NULL)
+        {
+            // If RAK was not yet seen, it has the same (recessive) level as R/W
+            rx._armedResponseRak = isr.atBit == 7 ? isr.readBits & 1 : 1;
+            rx._armedResponse = response;
+
+            uint32_t nCycles = (8 - isr.atBit) * VAN_BIT_CPU_CYCLES;
+            if (isr.bitScale != VAN_BIT_SCALE_ONE) nCycles = (nCycles << VAN_BIT_SCALE_SHIFT) / isr.bitScale;
+
+            VanBusTimer._Arm(VAN_TIMER_RX_SLOT(rx.busIdx), curr + nCycles, InFrameResponseIsr, &rx);
+        }
+        else if (rx._armedResponse != NULL)
+        {
+            rx._armedResponse = NULL;
+            VanBusTimer._Disarm(VAN_TIMER_RX_SLOT(rx.busIdx));
+        } // if
+    } // if
+#endif // VAN_RX_DEFERRED_DECODING
+
     return;
 
     #undef return
 
+} // DecodeRxEdge
+
+#ifdef VAN_RX_DEFERRED_DECODING
+
+// Pin level change, capturing only. Stores the CPU cycle counter value and the new pin level in the edge ring;
+// 'TVanPacketRxQueue::DecodeCapturedEdges()' will do the rest.
+inline void ICACHE_RAM_ATTR RxPinLevelChanged(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr)
+{
+    // Return quickly when it is a spurious interrupt (pin level not changed).
+    if (pinLevelChangedTo == rx.isrState.prevPinLevelChangedTo) return;
+    rx.isrState.prevPinLevelChangedTo = pinLevelChangedTo;
+
+    // Media access detection for packet transmission
+    if (pinLevelChangedTo == VAN_BIT_RECESSIVE)
+    {
+        // Pin level just changed to 'recessive', so that was the end of the media access ('dominant')
+        rx.lastMediaAccessAt = curr;
+    } // if
+
+    uint16_t headIdx = rx._edgeHeadIdx;
+    uint16_t nextIdx = (headIdx + 1) & VAN_RX_EDGE_RING_MASK;
+    if (nextIdx == rx.edgeTailIdx)
+    {
+        // Ring is full; the decoder will drop the packet it is working on
+        rx._edgesLost = true;
+        rx.nEdgesLost++;
+        return;
+    } // if
+
+    // Bit 0 holds the new pin level; losing one CPU cycle (12.5 nsec) of resolution is no problem
+    rx.edges[headIdx] = (curr & ~1UL) | (pinLevelChangedTo ? 1 : 0);
+
+    // Publish only after the entry is written
+    rx._edgeHeadIdx = nextIdx;
+} // RxPinLevelChanged
+
+// Pin level change interrupt handler
+void ICACHE_RAM_ATTR RxPinChangeIsr(TVanPacketRxQueue& rx)
+{
+    int pinLevelChangedTo = GPIP(rx.pin);
+    uint32_t curr = ESP.getCycleCount();  // Store CPU cycle counter value as soon as possible
+
+    RxPinLevelChanged(rx, pinLevelChangedTo, curr);
+
+    rx.isrCycles.Add(ESP.getCycleCount() - curr);
+} // RxPinChangeIsr
+
+// Pin level as sampled by the transmitter; see 'SendBitIsr'
+void ICACHE_RAM_ATTR RxPinSampledByTx(TVanPacketRxQueue& rx, int pinLevel, uint32_t at)
+{
+    // 'DecodeCapturedEdges' will check the ACK time-out
+    RxPinLevelChanged(rx, pinLevel, at);
+} // RxPinSampledByTx
+
+// Decodes all edges captured so far by 'RxPinChangeIsr'. Called outside interrupt context, from
+// 'TVanPacketRxQueue::Available()' and periodically via the ESP8266 core scheduler.
+void TVanPacketRxQueue::DecodeCapturedEdges()
+{
+    if (engine == VAN_RX_ENGINE_I2S)
+    {
+        // Each DMA sample is a 32-bit word (16 bits "left", 16 bits "right"), holding 32 samples of the Rx pin
+        int16_t left;
+        int16_t right;
+        while (i2s_rx_available() > 0 && i2s_read_sample(&left, &right, false))
+        {
+            DecodeI2sWord((uint32_t)(uint16_t)left << 16 | (uint16_t)right);
+        } // while
+
+        // No new edge within the ACK time-out? Note: in the time base of the samples, not of the CPU cycle counter.
+        uint32_t sampledUntil = i2sSampleAt * i2sCyclesPerSample;
+        if (_Head()->state == VAN_RX_WAITING_ACK && sampledUntil - isrState.eodAt > VAN_ACK_TIMEOUT_CYCLES)
+        {
+            FinishPacketReception(*this);
+        } // if
+
+        return;
+    } // if
+
+    // Any edge until now is in the ring (see the ACK time-out below)
+    uint32_t now = ESP.getCycleCount();
+
+    if (_edgesLost)
+    {
+        // Drop the packet being received, and start searching for the next SOF
+        _edgesLost = false;
+        TVanPacketRxDesc* rxDesc = _Head();
+        if (rxDesc->state != VAN_RX_DONE) rxDesc->Init();
+    } // if
+
+    uint16_t headIdx = _edgeHeadIdx;
+    uint16_t tailIdx = edgeTailIdx;
+
+    while (tailIdx != headIdx)
+    {
+        uint32_t edge = edges[tailIdx];
+        tailIdx = (tailIdx + 1) & VAN_RX_EDGE_RING_MASK;
+
+        DecodeRxEdge(*this, edge & 1 ? HIGH : LOW, edge);
+    } // while
+
+    // Free the ring slots
+    edgeTailIdx = tailIdx;
+
+    // No new edge within the ACK time-out?
+    if (_Head()->state == VAN_RX_WAITING_ACK && now - isrState.eodAt > VAN_ACK_TIMEOUT_CYCLES)
+    {
+        FinishPacketReception(*this);
+    } // if
+} // TVanPacketRxQueue::DecodeCapturedEdges
+
+// Finds the pin level changes in a word of 32 I2S samples (oldest sample in bit 31), and passes them to the decoder.
+// Most words have no pin level change at all; those take just one compare.
+void TVanPacketRxQueue::DecodeI2sWord(uint32_t word)
+{
+    uint32_t levelMask = i2sLevel ? 0xFFFFFFFF : 0;
+    uint32_t changed = word ^ levelMask;  // Bits set where the sample differs from the current pin level
+    int at = 0;
+
+    while (changed != 0)
+    {
+        // Skip the samples with unchanged pin level
+        at += __builtin_clz(changed);
+
+        i2sLevel = ! i2sLevel;
+        levelMask = ~levelMask;
+
+        // There is no ISR to detect media access: just take the current time, which is later than the real media
+        // access. Waiting a bit longer before transmitting is no problem.
+        if (i2sLevel == VAN_BIT_RECESSIVE) lastMediaAccessAt = ESP.getCycleCount();
+
+        DecodeRxEdge(*this, i2sLevel, (i2sSampleAt + at) * i2sCyclesPerSample);
+
+        // Look for the next change in the remaining samples
+        changed = (word ^ levelMask) << at;
+    } // while
+
+    i2sSampleAt += 32;
+} // TVanPacketRxQueue::DecodeI2sWord
+
+#else
+
+// Pin level change: pass on to the decoder
+inline void ICACHE_RAM_ATTR RxPinLevelChanged(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr)
+{
+    // Return quickly when it is a spurious interrupt (pin level not changed).
+    if (pinLevelChangedTo == rx.isrState.prevPinLevelChangedTo) return;
+    rx.isrState.prevPinLevelChangedTo = pinLevelChangedTo;
+
+    // Media access detection for packet transmission
+    if (pinLevelChangedTo == VAN_BIT_RECESSIVE)
+    {
+        // Pin level just changed to 'recessive', so that was the end of the media access ('dominant')
+        rx.lastMediaAccessAt = curr;
+    } // if
+
+    DecodeRxEdge(rx, pinLevelChangedTo, curr);
+} // RxPinLevelChanged
+
+// Pin level change interrupt handler
+void ICACHE_RAM_ATTR RxPinChangeIsr(TVanPacketRxQueue& rx)
+{
+    int pinLevelChangedTo = GPIP(rx.pin);  // GPIP() is faster than digitalRead()?
+    uint32_t curr = ESP.getCycleCount();  // Store CPU cycle counter value as soon as possible
+
+    RxPinLevelChanged(rx, pinLevelChangedTo, curr);
+
+    rx.isrCycles.Add(ESP.getCycleCount() - curr);
 } // RxPinChangeIsr
 
-// Initializes the VAN packet receiver
-void TVanPacketRxQueue::Setup(uint8_t rxPin)
+// Pin level as sampled by the transmitter, once every bit time. While transmitting with loopback enabled (see
+// 'TVanPacketTxQueue::SetLoopback(...)'), 'SendBitIsr' calls this in stead of having 'RxPinChangeIsr' attached.
+// 'at' is the CPU cycle counter value at the start of the sampled bit.
+void ICACHE_RAM_ATTR RxPinSampledByTx(TVanPacketRxQueue& rx, int pinLevel, uint32_t at)
+{
+    TIsrRxState& isr = rx.isrState;
+
+    // Timer1 is busy sending bits, so there is no 'WaitAckIsr'. Check the ACK time-out here; the transmitter keeps on
+    // sampling during the ACK and EOF time slots.
+    if (rx._Head()->state == VAN_RX_WAITING_ACK && at - isr.eodAt > VAN_ACK_TIMEOUT_CYCLES)
+    {
+        FinishPacketReception(rx);
+    } // if
+
+    isr.txLoopback = true;
+    RxPinLevelChanged(rx, pinLevel, at);
+    isr.txLoopback = false;
+} // RxPinSampledByTx
+
+#endif // VAN_RX_DEFERRED_DECODING
+
+// Enables or disables clock recovery. When enabled, the bit time is measured from the SOF of each received packet,
+// and used to decode the rest of that packet. Can help on buses where the transmitter's clock deviates from the
+// nominal 125 kbit/sec, e.g. depending on the vehicle or the temperature. Disabled by default.
+// Note: the estimated bus clock is always measured, and reported by 'DumpStats(...)'.
+void TVanPacketRxQueue::SetClockRecovery(bool enable)
+{
+    clockRecovery = enable;
+} // TVanPacketRxQueue::SetClockRecovery
+
+// Registers the in-frame response for "read" packets with the specified IDEN value. When a "read" packet with that
+// IDEN value, with the RTR bit set, is received, the ISR overwrites the RTR bit and transmits the response data
+// within the same frame. The response must have been prepared with 'TVanPacketTxDesc::PrepareInFrameResponse(...)',
+// and must stay allocated while registered. To change the response data, first pass NULL. The response is sent by
+// the transmitter on the same bus, so that must have been set up with this receiver, see
+// 'TVanPacketTxQueue::Setup(...)'.
+// Returns false if VAN_MAX_IN_FRAME_RESPONSES IDENs already have a response, or if VAN_RX_DEFERRED_DECODING is
+// defined.
+bool TVanPacketRxQueue::SetInFrameResponse(uint16_t iden, TVanPacketTxDesc* response)
+{
+#ifdef VAN_RX_DEFERRED_DECODING
+    (void)iden;
+    return response == NULL;
+#else
+    iden &= 0xFFF;
+
+    for (int i = 0; i < nInFrameResponses; i++)
+    {
+        if (inFrameResponses[i].iden == iden)
+        {
+            noInterrupts();
+            if (response != NULL) inFrameResponses[i].response = response;
+            else inFrameResponses[i] = inFrameResponses[--nInFrameResponses];  // Move the last entry into this spot
+            interrupts();
+            return true;
+        } // if
+    } // for
+
+    if (response == NULL) return true;
+    if (nInFrameResponses >= VAN_MAX_IN_FRAME_RESPONSES) return false;
+
+    // Fill in the new entry before the ISR can see it
+    inFrameResponses[nInFrameResponses].iden = iden;
+    inFrameResponses[nInFrameResponses].response = response;
+    ISR_ATOMIC_SET(nInFrameResponses, nInFrameResponses + 1);
+
+    return true;
+#endif // VAN_RX_DEFERRED_DECODING
+} // TVanPacketRxQueue::SetInFrameResponse
+
+// Returns the in-frame response for "read" packets with the specified IDEN value, or NULL if there is none
+TVanPacketTxDesc* ICACHE_RAM_ATTR TVanPacketRxQueue::_FindInFrameResponse(uint16_t iden) const
+{
+    for (int i = 0; i < nInFrameResponses; i++)
+    {
+        if (inFrameResponses[i].iden == iden) return inFrameResponses[i].response;
+    } // for
+    return NULL;
+} // TVanPacketRxQueue::_FindInFrameResponse
+
+TVanPacketRxQueue* TVanPacketRxQueue::buses[VAN_MAX_BUSES];
+
+// 'attachInterrupt' does not pass an argument to the ISR, so each bus has its own pin change ISR, passing its queue
+void ICACHE_RAM_ATTR RxPinChangeIsr0() { RxPinChangeIsr(*TVanPacketRxQueue::buses[0]); }
+#if VAN_MAX_BUSES > 1
+void ICACHE_RAM_ATTR RxPinChangeIsr1() { RxPinChangeIsr(*TVanPacketRxQueue::buses[1]); }
+#endif
+#if VAN_MAX_BUSES > 2
+void ICACHE_RAM_ATTR RxPinChangeIsr2() { RxPinChangeIsr(*TVanPacketRxQueue::buses[2]); }
+#endif
+#if VAN_MAX_BUSES > 3
+void ICACHE_RAM_ATTR RxPinChangeIsr3() { RxPinChangeIsr(*TVanPacketRxQueue::buses[3]); }
+#endif
+
+static void (* const rxPinChangeIsrs[VAN_MAX_BUSES])() =
+{
+    RxPinChangeIsr0,
+#if VAN_MAX_BUSES > 1
+    RxPinChangeIsr1,
+#endif
+#if VAN_MAX_BUSES > 2
+    RxPinChangeIsr2,
+#endif
+#if VAN_MAX_BUSES > 3
+    RxPinChangeIsr3,
+#endif
+}; // rxPinChangeIsrs
+
+// Initializes the VAN packet receiver. Each bus has its own TVanPacketRxQueue object, on its own 'rxPin'; the first
+// is 'VanBusRx'. Returns false if VAN_MAX_BUSES are already set up, or (only if VAN_RX_DEFERRED_DECODING is defined)
+// if the scheduler is out of slots for the decoder. 'Setup(...)' can be called again, e.g. to change the pin.
+// The I2S engine ('VAN_RX_ENGINE_I2S') is only available if VAN_RX_DEFERRED_DECODING is defined, and requires
+// 'rxPin' to be VAN_RX_I2S_PIN. If that is not the case, or if the I2S peripheral cannot be started, the GPIO ISR
+// engine is used. Only one bus can have the I2S engine.
+bool TVanPacketRxQueue::Setup(uint8_t rxPin, VanRxEngine_t rxEngine)
 {
+    if (busIdx == VAN_NO_BUS)
+    {
+        for (int i = 0; i < VAN_MAX_BUSES && busIdx == VAN_NO_BUS; i++)
+        {
+            if (buses[i] == NULL) busIdx = i;
+        } // for
+
+        if (busIdx == VAN_NO_BUS) return false;
+    } // if
+
+#ifdef VAN_RX_DEFERRED_DECODING
+    // Also decode when the sketch is not polling. Only once, also if 'Setup(...)' is called again.
+    if (! decoderScheduled)
+    {
+        decoderScheduled =
+            schedule_recurrent_function_us([this]() { DecodeCapturedEdges(); return true; }, VAN_RX_DECODE_INTERVAL_US);
+
+        if (! decoderScheduled)
+        {
+            // Leave the bus free, if it was not taken yet
+            if (buses[busIdx] != this) busIdx = VAN_NO_BUS;
+            return false;
+        } // if
+    } // if
+#endif // VAN_RX_DEFERRED_DECODING
+
     pin = rxPin;
-    pinMode(rxPin, INPUT_PULLUP);
-    attachInterrupt(digitalPinToInterrupt(rxPin), RxPinChangeIsr, CHANGE);
-    timer1_isr_init();
-    timer1_disable();
+    statsSince = millis();
+
+    memset(&isrState, 0, sizeof(isrState));
+    isrState.bitScale = VAN_BIT_SCALE_ONE;
+    isrState.prevPinLevelChangedTo = VAN_BIT_RECESSIVE;
+
+    pinChangeIsr = rxPinChangeIsrs[busIdx];
+    buses[busIdx] = this;
+    VanBusTimer.Setup();
+
+#ifdef VAN_RX_DEFERRED_DECODING
+    if (rxEngine == VAN_RX_ENGINE_I2S && rxPin == VAN_RX_I2S_PIN && i2s_rxtx_begin(true, false))
+    {
+        // 32 samples (bits) per I2S word
+        i2s_set_rate(125000 * VAN_RX_I2S_OVERSAMPLING / 32);
+
+        // The I2S clock dividers may not hit the requested rate exactly, so use the real rate for the time base
+        i2sCyclesPerSample = F_CPU / (i2s_get_real_rate() * 32) + 0.5;
+
+        engine = VAN_RX_ENGINE_I2S;
+    } // if
+#else
+    (void)rxEngine;
+#endif // VAN_RX_DEFERRED_DECODING
+
+    if (engine == VAN_RX_ENGINE_GPIO_ISR)
+    {
+        pinMode(rxPin, INPUT_PULLUP);
+        attachInterrupt(digitalPinToInterrupt(rxPin), pinChangeIsr, CHANGE);
+    } // if
+
+    return true;
 } // TVanPacketRxQueue::Setup
 
 #ifdef VAN_RX_ISR_DEBUGGING
@@ -755,6 +2098,23 @@ void TIsrDebugPacket::Dump(Stream& s) const
         i++;
     } // while
 
+    // Summary of the time spent inside the ISR, to compare the effect of changes in 'RxPinChangeIsr'
+    if (at > 2)
+    {
+        uint32_t minCycles = UINT32_MAX;
+        uint32_t maxCycles = 0;
+        uint32_t sumCycles = 0;
+        for (int j = 0; j < at; j++)
+        {
+            uint32_t nCyclesProcessing = samples[j].nCyclesProcessing;
+            if (nCyclesProcessing < minCycles) minCycles = nCyclesProcessing;
+            if (nCyclesProcessing > maxCycles) maxCycles = nCyclesProcessing;
+            sumCycles += nCyclesProcessing;
+        } // for
+
+        s.printf_P(PSTR("ISR CPU cycles: min %lu, avg %lu, max %lu\n"), minCycles, sumCycles / at, maxCycles);
+    } // if
+
     #undef reset()
 } // TIsrDebugPacket::Dump
 
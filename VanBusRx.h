@@ -27,9 +27,13 @@
 #define VanBusRx_h
 
 #include <Arduino.h>
+#include "VanBusTimer.h"
 
 //#define VAN_RX_ISR_DEBUGGING
 
+// Define VAN_RX_DEFERRED_DECODING as a build flag (e.g. '-DVAN_RX_DEFERRED_DECODING') to have the pin level change
+// ISR only capture edge timestamps; decoding is then done outside interrupt context. See README.md.
+
 // VAN_BIT_DOMINANT, VAN_BIT_RECESSIVE: pick the logic
 
 // MCP2551 CAN_H pin connected to VAN_DATA, CAN_L connected to VAN_DATA_BAR
@@ -55,11 +59,21 @@
 
 #define VAN_NO_PIN_ASSIGNED (0xFF)
 
-void RxPinChangeIsr();
+class TVanPacketRxQueue;
+class TVanPacketTxQueue;
+
+void RxPinChangeIsr(TVanPacketRxQueue& rx);
+void RxPinSampledByTx(TVanPacketRxQueue& rx, int pinLevel, uint32_t at);
+void RxPinLevelChanged(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr);
+void DecodeRxEdge(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr);
+void FinishPacketReception(TVanPacketRxQueue& rx);
+void WaitAckIsr(void* context);
+void InFrameResponseIsr(void* context);
 
 #define MAX_FLOAT_SIZE 12
 char* FloatToStr(char* buffer, float f, int prec = 1);
 
+uint16_t _crc15(uint16_t crc15, const uint8_t bytes[], int size);
 uint16_t _crc(const uint8_t bytes[], int size);
 
 #ifdef VAN_RX_ISR_DEBUGGING
@@ -81,7 +95,7 @@ class TIsrDebugPacket
 {
   public:
 
-    void Init() { at = 0; }
+    void ICACHE_RAM_ATTR Init() { at = 0; }  // Also called from ISR
     void Dump(Stream& s) const;
     TIsrDebugPacket() { Init(); }  // Constructor
 
@@ -91,17 +105,19 @@ class TIsrDebugPacket
     TIsrDebugData samples[VAN_ISR_DEBUG_BUFFER_SIZE];
     int at;  // Index of next sample to write into
 
-    friend void RxPinChangeIsr();
+    friend void RxPinChangeIsr(TVanPacketRxQueue& rx);
+    friend void DecodeRxEdge(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr);
     friend class TVanPacketRxDesc;
 }; // TIsrDebugPacket
 
 #endif // VAN_RX_ISR_DEBUGGING
 
-enum PacketReadState_t { VAN_RX_VACANT, VAN_RX_SEARCHING, VAN_RX_LOADING, VAN_RX_WAITING_ACK, VAN_RX_DONE };
+enum PacketReadState_t { VAN_RX_VACANT, VAN_RX_SEARCHING, VAN_RX_LOADING, VAN_RX_SKIPPING, VAN_RX_WAITING_ACK, VAN_RX_DONE };
 enum PacketReadResult_t { VAN_RX_PACKET_OK, VAN_RX_ERROR_NBITS, VAN_RX_ERROR_MANCHESTER, VAN_RX_ERROR_MAX_PACKET };
 enum PacketAck_t { VAN_ACK, VAN_NO_ACK };
 
 class Stream;
+struct TVanPacketRecord;
 
 // VAN packet Rx descriptor
 class TVanPacketRxDesc
@@ -121,20 +137,27 @@ class TVanPacketRxDesc
     #define VAN_MAX_DATA_BYTES 28
     #define VAN_MAX_PACKET_SIZE 33
 
-    TVanPacketRxDesc() { Init(); }
+    TVanPacketRxDesc() : bus(VAN_NO_BUS) { Init(); }
     uint16_t Iden() const;
     uint8_t CommandFlags() const;  // See page 17 of http://ww1.microchip.com/downloads/en/DeviceDoc/doc4205.pdf
     const uint8_t* Data() const;
     int DataLen() const;
     uint16_t Crc() const;
     bool CheckCrc() const;
-    bool CheckCrcAndRepair();  // Yes, we can sometimes repair a corrupt packet by flipping a single bit
+    bool CheckCrcAndRepair(bool repairTwoConsecutiveBits = false);  // Yes, we can sometimes repair a corrupt packet
     void DumpRaw(Stream& s, char last = '\n') const;
+    int FormatRaw(char* buf, int n, char last = '\n') const;
+
+    // Loads a packet from a record, as filled by 'TVanPacketRxQueue::DrainTo(...)', e.g. to pass it to code that takes
+    // a TVanPacketRxDesc. The Rx queue slot is not known; 'DumpRaw(...)' prints it as '-'. Pass the receiver that
+    // drained the record, so that e.g. 'CheckCrcAndRepair()' counts on the right bus; without it, 'VanBusRx' is used.
+    void Load(const TVanPacketRecord& record);
+    void Load(const TVanPacketRecord& record, const TVanPacketRxQueue& rxQueue);
 
     // Example of the longest string that can be dumped (not realistic):
-    // Raw: #1234 (123/123) 28(33) 0E ABC RA0 01-02-03-04-05-06-07-08-09-10-11-12-13-14-15-16-17-18-19-20-21-22-23-24-25-26-27-28:CC-DD NO_ACK VAN_RX_ERROR_MAX_PACKET CCDD CRC_ERROR
-    // + 1 for terminating '\0'
-    #define VAN_MAX_DUMP_RAW_SIZE (38 + VAN_MAX_DATA_BYTES * 3 + 45 + 1)
+    // Raw: #1234 (123/256) 28(33) 0E ABC RA0 01-02-03-04-05-06-07-08-09-10-11-12-13-14-15-16-17-18-19-20-21-22-23-24-25-26-27-28:CC-DD NO_ACK ERROR_MANCHESTER CCDD CRC_ERROR
+    // + 1 for the last character, + 1 for terminating '\0'
+    #define VAN_MAX_DUMP_RAW_SIZE (39 + VAN_MAX_DATA_BYTES * 3 + 6 + 38 + 1 + 1)
 
 #ifdef VAN_RX_ISR_DEBUGGING
     const TIsrDebugPacket& getIsrDebugPacket() const { return isrDebugPacket; }
@@ -177,22 +200,43 @@ class TVanPacketRxDesc
     TIsrDebugPacket isrDebugPacket;  // For debugging of packet reception inside ISR
 #endif // VAN_RX_ISR_DEBUGGING
 
+    // Cached results of 'Crc()' and 'CheckCrc()'; calculated once, when first needed.
+    // Note: a real CRC value always has its LSB cleared, so an odd value can mean "not calculated".
+    #define VAN_CRC_UNKNOWN 0x0001
+    mutable uint16_t crc;
+    mutable bool crcOk;  // Only valid if 'crc' is not VAN_CRC_UNKNOWN
+
     uint32_t seqNo;
-    uint8_t slot;  // in RxQueue
+    uint32_t timestamp;  // Value of 'millis()' when the packet was complete
+    uint16_t slot;  // in RxQueue; VAN_RX_NO_SLOT if loaded from a record
+    #define VAN_RX_NO_SLOT 0xFFFF
+    uint8_t bus;  // Of the Rx queue that received the packet; VAN_NO_BUS if not known
 
-    void Init()
+    // Also called from ISR
+    void ICACHE_RAM_ATTR Init()
     {
         size = 0;
         state = VAN_RX_VACANT;
         result = VAN_RX_PACKET_OK; // TODO - not necessary
         ack = VAN_NO_ACK; // TODO - not necessary
+        crc = VAN_CRC_UNKNOWN;
 #ifdef VAN_RX_ISR_DEBUGGING
         isrDebugPacket.Init();
 #endif // VAN_RX_ISR_DEBUGGING
     } // Init
 
-    friend void RxPinChangeIsr();
+    void CalculateCrc() const;
+
+    // The Rx queue that received the packet, for its statistics. VanBusRx if not known.
+    TVanPacketRxQueue& RxQueue() const;
+
+    friend void RxPinChangeIsr(TVanPacketRxQueue& rx);
+    friend void RxPinSampledByTx(TVanPacketRxQueue& rx, int pinLevel, uint32_t at);
+    friend void DecodeRxEdge(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr);
+    friend void FinishPacketReception(TVanPacketRxQueue& rx);
+    friend void InFrameResponseIsr(void* context);
     friend class TVanPacketRxQueue;
+    friend class TVanPacketTxQueue;
 }; // class TVanPacketRxDesc
 
 #define ISR_SAFE_GET(TYPE, CODE) \
@@ -210,81 +254,589 @@ class TVanPacketRxDesc
     interrupts(); \
 }
 
+// A naturally aligned variable of at most one word (32 bits) is read or written with a single load or store
+// instruction, which an ISR cannot interrupt halfway. So, just reading or writing such a variable does not need
+// interrupts disabled.
+// The ESP8266 has a single, in-order core; a compiler barrier is enough to keep the memory accesses around the
+// variable in order. E.g. a queue slot's contents are read only after its state was seen "done", and written
+// before its index is published.
+#define ISR_ATOMIC_GET(TYPE, VAR) \
+{ \
+    static_assert(sizeof(VAR) <= sizeof(void*), #VAR " is not a single word"); \
+    TYPE result = *(const volatile TYPE*)&(VAR); \
+    __asm__ __volatile__("" ::: "memory"); \
+    return result; \
+}
+
+#define ISR_ATOMIC_SET(VAR, VALUE) \
+{ \
+    static_assert(sizeof(VAR) <= sizeof(void*), #VAR " is not a single word"); \
+    __asm__ __volatile__("" ::: "memory"); \
+    *(volatile decltype(VAR)*)&(VAR) = (VALUE); \
+}
+
+// Critical section that restores the interrupt level as it was, in stead of just enabling interrupts. It can be
+// nested, and entered from ISR.
+#define ISR_SAFE_BEGIN() uint32_t _savedInterruptLevel = xt_rsil(15)
+#define ISR_SAFE_END() xt_wsr_ps(_savedInterruptLevel)
+
 // Forward declaration
 class TVanPacketTxDesc;
 
+#define VAN_RECORD_RESULT_MASK 0x03  // PacketReadResult_t
+#define VAN_RECORD_ACK 0x04
+#define VAN_RECORD_QUEUE_OVERRUN 0x08  // The Rx queue overran before this packet
+
+// Compact record of a received packet, as filled by 'TVanPacketRxQueue::DrainTo(...)'. Packed into 41 bytes, so that
+// it can also be written as is to a file or a socket.
+struct __attribute__((packed)) TVanPacketRecord
+{
+    uint32_t timestamp;  // Value of 'millis()' when the packet was received
+    uint16_t seqNo;  // 16 LSB of the sequence number
+    uint8_t size;  // Number of valid bytes in 'bytes'
+    uint8_t flags;  // VAN_RECORD_...
+    uint8_t bytes[VAN_MAX_PACKET_SIZE];  // SOF up to and including CRC
+
+    // Same meaning as in TVanPacketRxDesc
+    uint16_t Iden() const { return bytes[1] << 4 | bytes[2] >> 4; }
+    uint8_t CommandFlags() const { return bytes[2] & 0x0F; }
+    const uint8_t* Data() const { return bytes + 3; }
+    int DataLen() const { return size - 5; }
+    bool CheckCrc() const { return _crc15(0x7FFF, bytes + 1, size - 1) == 0x19B7; }
+    PacketReadResult_t Result() const { return (PacketReadResult_t)(flags & VAN_RECORD_RESULT_MASK); }
+    PacketAck_t Ack() const { return flags & VAN_RECORD_ACK ? VAN_ACK : VAN_NO_ACK; }
+}; // struct TVanPacketRecord
+
+// Number of slots in the Rx queue. Must be a power of 2.
+// To override, define as a build flag (e.g. '-DVAN_RX_QUEUE_SIZE=32'), so that it is the same for all compile units:
+// the library sources as well as the sketch. Just placing a '#define' in the sketch is not enough.
+#ifndef VAN_RX_QUEUE_SIZE
+#define VAN_RX_QUEUE_SIZE 16
+#endif // VAN_RX_QUEUE_SIZE
+
+#if VAN_RX_QUEUE_SIZE < 2 || VAN_RX_QUEUE_SIZE > 256 || (VAN_RX_QUEUE_SIZE & (VAN_RX_QUEUE_SIZE - 1)) != 0
+#error "VAN_RX_QUEUE_SIZE must be a power of 2, at most 256"
+#endif
+
+#define VAN_RX_QUEUE_MASK (VAN_RX_QUEUE_SIZE - 1)
+
+// Rx queue fill level that is counted as "high water" in the statistics (see 'TVanRxStats')
+#ifndef VAN_RX_QUEUE_HIGH_WATER
+#define VAN_RX_QUEUE_HIGH_WATER (VAN_RX_QUEUE_SIZE * 3 / 4)
+#endif // VAN_RX_QUEUE_HIGH_WATER
+
+#ifdef VAN_RX_DEFERRED_DECODING
+
+// Number of pin level changes ("edges") that can be captured before they are decoded. Must be a power of 2. A
+// packet has at most 33 * 10 = 330 bit times, but far less edges.
+#ifndef VAN_RX_EDGE_RING_SIZE
+#define VAN_RX_EDGE_RING_SIZE 256
+#endif // VAN_RX_EDGE_RING_SIZE
+
+#if VAN_RX_EDGE_RING_SIZE < 2 || (VAN_RX_EDGE_RING_SIZE & (VAN_RX_EDGE_RING_SIZE - 1)) != 0
+#error "VAN_RX_EDGE_RING_SIZE must be a power of 2"
+#endif
+
+#define VAN_RX_EDGE_RING_MASK (VAN_RX_EDGE_RING_SIZE - 1)
+
+// Interval at which the ESP8266 core scheduler runs the decoder, in microseconds
+#ifndef VAN_RX_DECODE_INTERVAL_US
+#define VAN_RX_DECODE_INTERVAL_US 500
+#endif // VAN_RX_DECODE_INTERVAL_US
+
+// I2S receive engine: the I2S peripheral samples the Rx pin into DMA buffers, at VAN_RX_I2S_OVERSAMPLING times the
+// VAN bus bit rate. The I2S data input is fixed to GPIO 12 (D6 on most boards). Note: GPIO 13 and 14 (I2S bit clock
+// and word select) cannot be used for anything else.
+#define VAN_RX_I2S_PIN 12
+
+#ifndef VAN_RX_I2S_OVERSAMPLING
+#define VAN_RX_I2S_OVERSAMPLING 8
+#endif // VAN_RX_I2S_OVERSAMPLING
+
+#endif // VAN_RX_DEFERRED_DECODING
+
+enum VanRxEngine_t
+{
+    VAN_RX_ENGINE_GPIO_ISR,  // Pin level change interrupt on every edge
+#ifdef VAN_RX_DEFERRED_DECODING
+    VAN_RX_ENGINE_I2S  // Rx pin sampled by I2S peripheral, via DMA
+#endif // VAN_RX_DEFERRED_DECODING
+}; // enum VanRxEngine_t
+
+// Number of buckets in a histogram (see TVanHistogram)
+#ifndef VAN_HISTOGRAM_BUCKETS
+#define VAN_HISTOGRAM_BUCKETS 16
+#endif // VAN_HISTOGRAM_BUCKETS
+
+// Histogram of values, with VAN_HISTOGRAM_BUCKETS buckets of equal width. Bucket i counts the values from
+// 'i << shift' up to (not including) '(i + 1) << shift'; the last bucket also counts all larger values. Adding a value
+// takes only a shift and a compare, so it is cheap enough to do inside an ISR.
+struct TVanHistogram
+{
+    // Constructor
+    TVanHistogram(uint8_t shift = 0) : shift(shift) { Clear(); }
+
+    void Clear()
+    {
+        memset(counts, 0, sizeof(counts));
+        max = 0;
+    } // Clear
+
+    void ICACHE_RAM_ATTR Add(uint32_t value)
+    {
+        uint32_t i = value >> shift;
+        counts[i < VAN_HISTOGRAM_BUCKETS ? i : VAN_HISTOGRAM_BUCKETS - 1]++;
+        if (value > max) max = value;
+    } // Add
+
+    uint32_t Count() const;
+
+    // Returns the upper bound of the bucket that holds the specified percentile, e.g. 'Percentile(99)'. Returns
+    // 'max' if that is in the last bucket.
+    uint32_t Percentile(int percent) const;
+
+    // Prints the histogram on one line, e.g. "<64: 12, <128: 1034, ..., max: 700"
+    void Dump(Stream& s) const;
+
+    uint8_t shift;
+    uint32_t max;  // Largest value added
+    uint32_t counts[VAN_HISTOGRAM_BUCKETS];
+}; // struct TVanHistogram
+
+// Maximum number of IDENs for which packets lost due to an Rx queue overrun are counted separately
+#ifndef VAN_MAX_LOST_IDENS
+#define VAN_MAX_LOST_IDENS 8
+#endif // VAN_MAX_LOST_IDENS
+
+struct TVanIdenCount
+{
+    uint16_t iden;
+    uint32_t count;
+}; // struct TVanIdenCount
+
+// Snapshot of the receiver statistics, as filled by 'TVanPacketRxQueue::GetStats(...)'. Numbers can roll over.
+struct TVanRxStats
+{
+    uint32_t nReceived;  // Packets placed in the Rx queue
+    uint32_t nCorrupt;  // CRC errors, as found by 'CheckCrcAndRepair()'
+    uint32_t nRepaired;
+    uint32_t nOneBitErrors;
+    uint32_t nTwoConsecutiveBitErrors;
+    uint32_t nFiltered;  // Rejected by IDEN filter
+    uint32_t nDuplicates;  // Suppressed as duplicate
+    uint32_t nEdgesLost;  // Only if VAN_RX_DEFERRED_DECODING is defined
+
+    // Gateway: packets forwarded to the transmitter of another bus, and packets that could not be forwarded because
+    // that transmitter's queue was full
+    uint32_t nForwarded;
+    uint32_t nForwardDropped;
+
+    // Packets placed in the Rx queue with a receive error, by PacketReadResult_t
+    uint32_t nErrorNBits;
+    uint32_t nErrorManchester;
+    uint32_t nErrorMaxPacket;
+
+    // Packets lost because the Rx queue was full, in total and per IDEN. Packets with an IDEN that does not fit in
+    // 'lostPerIden', or that were cut off before their IDEN was complete, are counted in 'nLostOtherIdens'.
+    uint32_t nLost;
+    uint8_t nLostIdens;  // Number of entries used in 'lostPerIden'
+    TVanIdenCount lostPerIden[VAN_MAX_LOST_IDENS];
+    uint32_t nLostOtherIdens;
+
+    // Rx queue fill level, counted when a packet is placed in the queue
+    uint16_t maxQueueLevel;
+    uint32_t nQueueHighWater;  // Packets placed while the queue was at or above VAN_RX_QUEUE_HIGH_WATER
+
+    // Bus load: time slots in which a frame was being received (SOF up to and including ACK), as percentage of the
+    // time since 'ResetStats()' (or 'Setup(...)')
+    float busLoadPercent;
+    uint32_t busyBits;
+    uint32_t elapsedMs;
+
+    // Estimated bus clock, as deviation from the nominal 125 kbit/sec, in percent. All 0 if not yet measured.
+    uint32_t nSofMeasured;
+    float busClockPercent;
+    float busClockMinPercent;
+    float busClockMaxPercent;
+
+    // Execution time of the Rx pin change ISR, in CPU cycles. Empty if the I2S receive engine is used.
+    TVanHistogram isrCycles;
+
+    // Interrupt entry latency, in CPU cycles. The moment of a pin level change can not be seen in software; measured
+    // is how much later than a whole number of bit times after the previous change it was seen by the decoder. So this
+    // is the extra latency relative to that of the previous interrupt (plus any bus clock deviation).
+    TVanHistogram edgeLateness;
+}; // struct TVanRxStats
+
+// Maximum number of IDENs for which duplicate packets can be suppressed
+#ifndef VAN_MAX_DUPLICATE_FILTERS
+#define VAN_MAX_DUPLICATE_FILTERS 32
+#endif // VAN_MAX_DUPLICATE_FILTERS
+
+// Last seen packet for an IDEN for which duplicate packets are suppressed
+struct TIdenLastSeen
+{
+    uint16_t iden;
+    uint16_t heartbeatMs;  // Deliver a duplicate anyway if the last delivered packet is older than this; 0 = never
+    uint32_t deliveredAt;  // millis() value when last delivered
+    uint8_t size;  // Size of last delivered packet; 0 = none delivered yet
+
+    // Bytes of the last delivered packet, from the byte with the last IDEN nibble and COM, up to and including CRC.
+    // The whole packet is compared: packets with different data can have the same CRC.
+    uint8_t bytes[VAN_MAX_PACKET_SIZE - 2];
+}; // struct TIdenLastSeen
+
+// Maximum number of IDENs that can have their own receive callback
+#ifndef VAN_MAX_RX_SUBSCRIPTIONS
+#define VAN_MAX_RX_SUBSCRIPTIONS 8
+#endif // VAN_MAX_RX_SUBSCRIPTIONS
+
+// Receive callback. The packet is passed in its receive queue slot; the slot is released when the callback returns.
+// Note: a callback must not call 'Receive(...)', 'Peek(...)' or 'Release()'.
+typedef void (*TVanPacketRxCallback)(TVanPacketRxDesc& pkt);
+
+struct TIdenSubscription
+{
+    uint16_t iden;
+    TVanPacketRxCallback callback;
+}; // struct TIdenSubscription
+
+// Maximum number of IDENs for which an in-frame response can be registered
+#ifndef VAN_MAX_IN_FRAME_RESPONSES
+#define VAN_MAX_IN_FRAME_RESPONSES 4
+#endif // VAN_MAX_IN_FRAME_RESPONSES
+
+struct TInFrameResponse
+{
+    uint16_t iden;
+    TVanPacketTxDesc* response;  // Prepared with 'TVanPacketTxDesc::PrepareInFrameResponse(...)'
+}; // struct TInFrameResponse
+
+// State of the bit decoder in 'RxPinChangeIsr', kept together in one compact struct. It is placed at the start of
+// the Rx queue object, so that its members are at small offsets from the address of the queue: the decoder gets at
+// them from a single base address, in stead of loading a separate address for each.
+// Note: on the ESP8266, data is always in (uncached) DRAM; only code needs ICACHE_RAM_ATTR.
+struct TIsrRxState
+{
+    uint32_t prev;  // CPU cycle counter value at previous pin level change
+    uint32_t jitter;  // Correction for the next bit time, see 'nBitsFromCycles'
+    uint32_t sofCycles;  // CPU cycles elapsed since start of SOF, for clock recovery
+    uint16_t readBits;  // Bits read so far for the current byte
+    uint16_t bitScale;  // Clock recovery: factor to normalize CPU cycles to nominal bit time; see VAN_BIT_SCALE_ONE
+    uint8_t atBit;  // Number of bits in 'readBits'
+    uint8_t prevPinLevelChangedTo;
+#ifndef VAN_RX_DEFERRED_DECODING
+    uint8_t txLoopback;  // Pin level was sampled by 'SendBitIsr', which is on timer1: don't set the ACK timer
+#endif // VAN_RX_DEFERRED_DECODING
+    uint32_t eodAt;  // CPU cycle counter value when EOD was seen, for the ACK time-out
+}; // struct TIsrRxState
+
 //  Circular buffer of VAN packet Rx descriptors
 class TVanPacketRxQueue
 {
   public:
 
-    #define VAN_RX_QUEUE_SIZE 15
-
     // Constructor
     TVanPacketRxQueue()
         : pin(VAN_NO_PIN_ASSIGNED)
-        , _head(pool)
-        , tail(pool)
-        , end(pool + VAN_RX_QUEUE_SIZE)
+        , busIdx(VAN_NO_BUS)
+        , engine(VAN_RX_ENGINE_GPIO_ISR)
+        , isrState()
+        , pinChangeIsr(NULL)
+        , txQueue(NULL)
+        , _headIdx(0)
+        , tailIdx(0)
         , _overrun(false)
-        , txTimerIsr(NULL)
-        , txTimerTicks(0)
+        , idenFilter(NULL)
+        , lastSeen(NULL)
+        , nLastSeen(0)
+        , nSubscriptions(0)
+        , rxCallback(NULL)
+        , _rxEventScheduled(false)
+        , deliveringRxEvents(false)
+        , nInFrameResponses(0)
+        , _armedResponse(NULL)
+        , _armedResponseRak(0)
+        , gateway(NULL)
+        , forwardFilter(NULL)
+        , forwardIdx(0)
+        , forwardSeqNo(0)
+        , nForwarded(0)
+        , nForwardDropped(0)
         , lastMediaAccessAt(0)
         , count(0)
         , nCorrupt(0)
         , nRepaired(0)
-    { }
+        , nOneBitErrors(0)
+        , nTwoConsecutiveBitErrors(0)
+        , nFiltered(0)
+        , nDuplicates(0)
+        , nLost(0)
+        , nLostIdens(0)
+        , nLostOtherIdens(0)
+        , maxQueueLevel(0)
+        , nQueueHighWater(0)
+        , busyBits(0)
+        , statsSince(0)
+        , isrCycles(CPU_F_FACTOR == 1 ? 6 : 7)  // Buckets of 0.8 usec
+        , edgeLateness(CPU_F_FACTOR == 1 ? 5 : 6)  // Buckets of 0.4 usec
+        , clockRecovery(false)
+        , nSofMeasured(0)
+        , sofCyclesSum(0)
+        , sofCyclesMin(UINT32_MAX)
+        , sofCyclesMax(0)
+#ifdef VAN_RX_DEFERRED_DECODING
+        , _edgeHeadIdx(0)
+        , edgeTailIdx(0)
+        , _edgesLost(false)
+        , nEdgesLost(0)
+        , i2sSampleAt(0)
+        , i2sCyclesPerSample(0)
+        , i2sLevel(VAN_BIT_RECESSIVE)
+        , decoderScheduled(false)
+#endif // VAN_RX_DEFERRED_DECODING
+    {
+        memset(nResults, 0, sizeof(nResults));
+    } // TVanPacketRxQueue
 
-    void Setup(uint8_t rxPin);
-    bool Available() const { ISR_SAFE_GET(bool, tail->state == VAN_RX_DONE); }
+    bool Setup(uint8_t rxPin, VanRxEngine_t engine = VAN_RX_ENGINE_GPIO_ISR);
+    bool Available()
+    {
+#ifdef VAN_RX_DEFERRED_DECODING
+        DecodeCapturedEdges();
+#endif // VAN_RX_DEFERRED_DECODING
+
+        // A packet must be forwarded before it can leave the queue
+        if (gateway != NULL) ForwardReceived();
+
+        return TailState() == VAN_RX_DONE;
+    } // Available
     bool Receive(TVanPacketRxDesc& pkt, bool* isQueueOverrun = NULL);
-    uint32_t GetCount() const { ISR_SAFE_GET(uint32_t, count); }
+    int DrainTo(TVanPacketRecord* records, int maxCount);
+    TVanPacketRxDesc* Peek(bool* isQueueOverrun = NULL);
+    void Release();
+    uint32_t GetCount() const { ISR_ATOMIC_GET(uint32_t, count); }
     void DumpStats(Stream& s) const;
 
+    // Statistics as a struct, e.g. to pass on to a monitoring system. 'ResetStats()' restarts the histograms, the
+    // maximum queue level and the bus load measurement; the counters keep counting.
+    void GetStats(TVanRxStats& stats) const;
+    void ResetStats();
+
+    // IDEN acceptance filter, applied inside the ISR. Rejected packets never occupy a slot in the Rx queue.
+    // By default, all IDENs are accepted.
+    void AcceptAllIdens();
+    bool RejectAllIdens();
+    bool AcceptIden(uint16_t iden);
+    bool RejectIden(uint16_t iden);
+    bool IsIdenAccepted(uint16_t iden) const;
+
+    // Duplicate packet suppression, applied inside the ISR. A packet that is the same as the last delivered packet
+    // with that IDEN, does not occupy a slot in the Rx queue.
+    bool SuppressDuplicates(uint16_t iden, uint16_t heartbeatMs = 0);
+    void DeliverDuplicates(uint16_t iden);
+    void ForgetLastSeen(uint16_t iden);
+
+    // Event-driven delivery. In stead of waiting to be polled with 'Receive(...)', a packet that has a callback is
+    // passed to it as soon as possible after it is received. A callback can be set for all packets, and per IDEN.
+    void SetRxCallback(TVanPacketRxCallback callback);
+    bool Subscribe(uint16_t iden, TVanPacketRxCallback callback);
+    void Unsubscribe(uint16_t iden);
+
+    // Clock recovery: measure the bit time from the SOF of each packet, and use it to decode the rest of the packet
+    void SetClockRecovery(bool enable);
+
+    // In-frame response: reply to a "read" packet (R/W and RTR set) with the specified IDEN, within the same frame.
+    // The response is sent from inside the ISR. Pass NULL to stop responding.
+    // Not available if VAN_RX_DEFERRED_DECODING is defined: decoding is then too late to respond in time.
+    bool SetInFrameResponse(uint16_t iden, TVanPacketTxDesc* response);
+
+    // Gateway: packets with a forwarded IDEN are sent on another bus, by the specified transmitter, as soon as they
+    // are received. They are also delivered as usual. By default, no IDENs are forwarded. Pass NULL to stop.
+    void SetGateway(TVanPacketTxQueue* txQueue);
+    bool ForwardIden(uint16_t iden);
+    bool ForwardAllIdens();
+    void StopForwardingIden(uint16_t iden);
+    bool IsIdenForwarded(uint16_t iden) const;
+
   private:
 
     uint8_t pin;
+    uint8_t busIdx;  // Index into 'buses'; VAN_NO_BUS if not set up
+    VanRxEngine_t engine;
+    TIsrRxState isrState;  // Keep near the start of the object, see TIsrRxState
+    void (*pinChangeIsr)();
+    TVanPacketTxQueue* txQueue;  // The transmitter on this bus, if any
     TVanPacketRxDesc pool[VAN_RX_QUEUE_SIZE];
-    TVanPacketRxDesc* volatile _head;
-    TVanPacketRxDesc* tail;
-    TVanPacketRxDesc* end;
+    volatile uint8_t _headIdx;  // Index into 'pool'
+    uint8_t tailIdx;  // Index into 'pool'
     volatile bool _overrun;
-    uint32_t txTimerTicks;
-    timercallback txTimerIsr;
+
+    // Bitmap of accepted IDEN values (bit set = accepted), or NULL if all IDEN values are accepted
+    #define VAN_IDEN_FILTER_SIZE (4096 / 8)
+    uint8_t* volatile idenFilter;
+
+    // IDENs for which duplicate packets are suppressed
+    TIdenLastSeen* lastSeen;
+    volatile uint8_t nLastSeen;
+
+    // Receive callbacks: per IDEN, and for all other IDENs
+    TIdenSubscription subscriptions[VAN_MAX_RX_SUBSCRIPTIONS];
+    volatile uint8_t nSubscriptions;
+    TVanPacketRxCallback volatile rxCallback;
+    volatile bool _rxEventScheduled;
+    bool deliveringRxEvents;
+
+    // In-frame responses, and the one that is about to be sent
+    TInFrameResponse inFrameResponses[VAN_MAX_IN_FRAME_RESPONSES];
+    volatile uint8_t nInFrameResponses;
+    TVanPacketTxDesc* volatile _armedResponse;
+    volatile uint8_t _armedResponseRak;  // RAK bit as sent by the requester; the response CRC depends on it
+
+    // Gateway. 'forwardIdx' and 'forwardSeqNo' are the slot and sequence number of the next packet to be forwarded.
+    TVanPacketTxQueue* volatile gateway;
+    uint8_t* volatile forwardFilter;  // Bitmap of forwarded IDEN values, like 'idenFilter'
+    uint8_t forwardIdx;
+    uint32_t forwardSeqNo;
+    uint32_t nForwarded;
+    uint32_t nForwardDropped;
+
     volatile uint32_t lastMediaAccessAt;  // For carrier sense: CPU cycle counter value when last sensed
 
     // Some statistics. Numbers can roll over.
     uint32_t count;
     uint32_t nCorrupt;
     uint32_t nRepaired;
-
-    void RegisterTxTimerTicks(uint32_t ticks) { txTimerTicks = ticks; };
-    void RegisterTxIsr(timercallback isr) { ISR_SAFE_SET(txTimerIsr, isr); };
-
-    uint32_t GetLastMediaAccessAt() { ISR_SAFE_GET(uint32_t, lastMediaAccessAt); };
-    void SetLastMediaAccessAt(uint32_t at) { ISR_SAFE_SET(lastMediaAccessAt, at); };
-
-    bool IsQueueOverrun() const { ISR_SAFE_GET(bool, _overrun); }
-    bool ClearQueueOverrun() { ISR_SAFE_SET(_overrun, false); }
+    uint32_t nOneBitErrors;
+    uint32_t nTwoConsecutiveBitErrors;  // Detected; only repaired on request
+    uint32_t nFiltered;  // Rejected by IDEN filter
+    uint32_t nDuplicates;  // Suppressed as duplicate
+    uint32_t nResults[4];  // Per PacketReadResult_t
+
+    // Packets lost because the Rx queue was full. Such a packet is still decoded, into 'lostPacket', for its IDEN.
+    TVanPacketRxDesc lostPacket;
+    uint32_t nLost;
+    uint8_t nLostIdens;
+    TVanIdenCount lostPerIden[VAN_MAX_LOST_IDENS];
+    uint32_t nLostOtherIdens;
+
+    uint16_t maxQueueLevel;
+    uint32_t nQueueHighWater;
+    uint32_t busyBits;  // For bus load
+    uint32_t statsSince;  // millis() value at last 'ResetStats()'
+    TVanHistogram isrCycles;
+    TVanHistogram edgeLateness;
+
+    // Clock recovery, and estimated bus clock
+    volatile bool clockRecovery;
+    uint32_t nSofMeasured;
+    uint64_t sofCyclesSum;
+    uint32_t sofCyclesMin;
+    uint32_t sofCyclesMax;
+
+#ifdef VAN_RX_DEFERRED_DECODING
+    // Single-producer ('RxPinChangeIsr', or 'RxPinSampledByTx' while transmitting), single-consumer
+    // ('DecodeCapturedEdges') ring of captured edges. Each entry is the CPU cycle counter value, with the new pin
+    // level in bit 0.
+    volatile uint32_t edges[VAN_RX_EDGE_RING_SIZE];
+    volatile uint16_t _edgeHeadIdx;  // Only written by the ISR
+    volatile uint16_t edgeTailIdx;  // Only written by the decoder
+    volatile bool _edgesLost;
+    uint32_t nEdgesLost;
+
+    // I2S receive engine
+    uint32_t i2sSampleAt;  // Number of samples processed, rolling over
+    uint32_t i2sCyclesPerSample;  // CPU cycles per sample, to fit the decoder's time base
+    uint8_t i2sLevel;  // Pin level at last sample processed
+
+    bool decoderScheduled;
+
+    void DecodeCapturedEdges();
+    void DecodeI2sWord(uint32_t word);
+#endif // VAN_RX_DEFERRED_DECODING
+
+    // The set up buses
+    static TVanPacketRxQueue* buses[VAN_MAX_BUSES];
+
+    uint32_t GetLastMediaAccessAt() { ISR_ATOMIC_GET(uint32_t, lastMediaAccessAt); };
+    void SetLastMediaAccessAt(uint32_t at) { ISR_ATOMIC_SET(lastMediaAccessAt, at); };
+
+    bool IsQueueOverrun() const { ISR_ATOMIC_GET(bool, _overrun); }
+    void ClearQueueOverrun() { ISR_ATOMIC_SET(_overrun, false); }
+
+    bool SetIdenFilter(uint8_t fill);
+
+    TIdenLastSeen* FindLastSeen(uint16_t iden) const;
+    bool ICACHE_RAM_ATTR _IsDuplicate(const TVanPacketRxDesc* rxDesc);
+
+    TVanPacketRxCallback ICACHE_RAM_ATTR _FindRxCallback(uint16_t iden) const;
+    void ICACHE_RAM_ATTR _CountLostPacket();
+    void ICACHE_RAM_ATTR _ScheduleRxEvent(const TVanPacketRxDesc* rxDesc);
+    void DeliverRxEvents();
+
+    TVanPacketTxDesc* ICACHE_RAM_ATTR _FindInFrameResponse(uint16_t iden) const;
+
+    bool ICACHE_RAM_ATTR _IsForwarded(uint16_t iden) const;
+    void ForwardReceived();
+
+    TVanPacketRxDesc* Tail() { return pool + tailIdx; }
+    const TVanPacketRxDesc* Tail() const { return pool + tailIdx; }
+
+    // Only the ISR sets a slot to VAN_RX_DONE; 'tailIdx' is only changed outside ISR
+    PacketReadState_t TailState() const { ISR_ATOMIC_GET(PacketReadState_t, Tail()->state); }
+    PacketReadState_t SlotState(int idx) const { ISR_ATOMIC_GET(PacketReadState_t, pool[idx].state); }
+
+    // Returns the slot that is receiving. When the queue is full, that is 'lostPacket'.
+    // Only to be called from ISR, unsafe otherwise
+    TVanPacketRxDesc* ICACHE_RAM_ATTR _Head()
+    {
+        TVanPacketRxDesc* head = pool + _headIdx;
+        return head->state == VAN_RX_DONE ? &lostPacket : head;
+    } // _Head
 
     // Only to be called from ISR, unsafe otherwise
     void ICACHE_RAM_ATTR _AdvanceHead()
     {
-        _head->state = VAN_RX_DONE;
-        _head->seqNo = count++;
-        if (++_head == end) _head = pool;  // roll over if needed
+        TVanPacketRxDesc* head = _Head();
+        if (head == &lostPacket)
+        {
+            _CountLostPacket();
+            return;
+        } // if
+
+        // Fill level, including this packet
+        uint16_t level = ((_headIdx - tailIdx) & VAN_RX_QUEUE_MASK) + 1;
+        if (level > maxQueueLevel) maxQueueLevel = level;
+        if (level >= VAN_RX_QUEUE_HIGH_WATER) nQueueHighWater++;
+        nResults[head->result & 0x03]++;
+
+        head->state = VAN_RX_DONE;
+        head->seqNo = count++;
+        head->bus = busIdx;
+        head->timestamp = millis();
+        _headIdx = (_headIdx + 1) & VAN_RX_QUEUE_MASK;  // roll over if needed
+        _ScheduleRxEvent(head);
     } // _AdvanceHead
 
     void AdvanceTail()
     {
-        if (++tail == end) tail = pool;  // roll over if needed
-    } // _AdvanceTail
-
-    friend void FinishPacketTransmission(TVanPacketTxDesc* txDesc);
-    friend void SendBitIsr();
-    friend void RxPinChangeIsr();
-    friend void SetTxBitTimer();
-    friend void WaitAckIsr();
+        tailIdx = (tailIdx + 1) & VAN_RX_QUEUE_MASK;  // roll over if needed
+    } // AdvanceTail
+
+    friend void FinishPacketTransmission(TVanPacketTxQueue& tx, TVanPacketTxDesc* txDesc);
+    friend void SendBit(TVanPacketTxQueue& tx, uint32_t curr);
+    friend void RxPinChangeIsr(TVanPacketRxQueue& rx);
+    friend void RxPinChangeIsr0();
+    friend void RxPinChangeIsr1();
+    friend void RxPinChangeIsr2();
+    friend void RxPinChangeIsr3();
+    friend void RxPinSampledByTx(TVanPacketRxQueue& rx, int pinLevel, uint32_t at);
+    friend void RxPinLevelChanged(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr);
+    friend void DecodeRxEdge(TVanPacketRxQueue& rx, int pinLevelChangedTo, uint32_t curr);
+    friend void FinishPacketReception(TVanPacketRxQueue& rx);
+    friend void InFrameResponseIsr(void* context);
+    friend void DeliverRxEventsScheduled();
+    friend void DeliverTxCompletionsScheduled();
     friend class TVanPacketRxDesc;
     friend class TVanPacketTxQueue;
 }; // class TVanPacketRxQueue
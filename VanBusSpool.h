@@ -0,0 +1,234 @@
+/*
+ * VanBus packet spool
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+/*
+ * USAGE
+ *
+ *   Add the following line to your sketch:
+ *     #include <VanBusSpool.h>
+ *
+ *   Declare a spool, e.g. for 64 packets:
+ *     TVanPacketSpool<64> spool;
+ *
+ *   In setup() :
+ *     VanBusRx.Setup(RX_PIN);
+ *     spool.Start();  // Keep draining the Rx queue into the spool, also while 'loop()' is busy
+ *
+ *   In loop() :
+ *     TVanPacketRxDesc pkt;
+ *     if (spool.Receive(pkt)) ... // Handle the packet, e.g. send it over the network
+ */
+
+#ifndef VanBusSpool_h
+#define VanBusSpool_h
+
+#include <Schedule.h>
+#include "VanBusRx.h"
+
+// Interval at which the ESP8266 core scheduler drains the Rx queue into a started spool, in microseconds. The
+// scheduler runs the spool between two 'loop()' calls, and at every 'yield()' or 'delay()', e.g. while a web
+// server is sending a large page.
+#ifndef VAN_SPOOL_FILL_INTERVAL_US
+#define VAN_SPOOL_FILL_INTERVAL_US 1000
+#endif // VAN_SPOOL_FILL_INTERVAL_US
+
+// What to do with received packets when the spool is full
+enum VanSpoolDropPolicy_t
+{
+    VAN_SPOOL_DROP_OLDEST,  // Discard the oldest packet in the spool, to make room for the new packet
+    VAN_SPOOL_DROP_NEWEST,  // Discard the new packet
+    VAN_SPOOL_BLOCK  // Leave the new packet in the Rx queue; when that is full too, the Rx queue overruns
+}; // enum VanSpoolDropPolicy_t
+
+// Second stage behind the Rx queue: a larger buffer of received packets, as compact records. The spool drains the Rx
+// queue whenever it gets the chance, so that a slow consumer (e.g. a network connection) does not cause an Rx queue
+// overrun. The consumer takes the packets out at its own pace.
+//
+// Backpressure: the spool is "congested" when its fill level reaches the high water mark; it stays congested until
+// the level drops to the low water mark. While congested, the consumer should postpone other work (e.g. serving a
+// web page) and take out more packets at once. When the spool is full, packets are dropped according to the drop
+// policy.
+//
+// The spool is filled and emptied in the same (non-ISR) context, so no locking is needed. Note that filling can
+// happen at any 'yield()' or 'delay()', so between two calls to 'Receive(...)', but never during one.
+template <int N>
+class TVanPacketSpool
+{
+    static_assert(N >= 2 && N <= 32768 && (N & (N - 1)) == 0, "Spool size N must be a power of 2, at most 32768");
+
+  public:
+
+    // Constructor. By default, the high water mark is at 3/4 of the spool size, the low water mark at 1/4.
+    TVanPacketSpool(TVanPacketRxQueue& rxQueue = VanBusRx, VanSpoolDropPolicy_t policy = VAN_SPOOL_DROP_OLDEST)
+        : rxQueue(rxQueue)
+        , policy(policy)
+        , highWater(N * 3 / 4)
+        , lowWater(N / 4)
+        , headIdx(0)
+        , tailIdx(0)
+        , congested(false)
+        , started(false)
+        , nIn(0)
+        , nOut(0)
+        , nDropped(0)
+        , nBlocked(0)
+        , nRxOverruns(0)
+        , nCongested(0)
+        , maxLevel(0)
+    { }
+
+    // Lets the ESP8266 core scheduler call 'Fill()' every VAN_SPOOL_FILL_INTERVAL_US microseconds. Returns false if
+    // the scheduler is out of slots.
+    bool Start()
+    {
+        if (started) return true;
+        started = schedule_recurrent_function_us([this]() { Fill(); return true; }, VAN_SPOOL_FILL_INTERVAL_US);
+        return started;
+    } // Start
+
+    void SetDropPolicy(VanSpoolDropPolicy_t newPolicy) { policy = newPolicy; }
+    void SetWaterMarks(int high, int low) { highWater = high; lowWater = low; }
+
+    // Moves all received packets from the Rx queue into the spool, applying the drop policy when the spool is full.
+    // Can also be called directly, e.g. from a long-running loop. Returns the number of packets added.
+    int Fill()
+    {
+        int n = 0;
+
+        for (;;)
+        {
+            int room = N - Level();
+
+            if (room == 0)
+            {
+                if (! rxQueue.Available()) break;
+
+                if (policy == VAN_SPOOL_BLOCK)
+                {
+                    nBlocked++;
+                    break;
+                } // if
+
+                nDropped++;
+
+                if (policy == VAN_SPOOL_DROP_OLDEST)
+                {
+                    tailIdx++;
+                    room = 1;
+                }
+                else
+                {
+                    TVanPacketRecord discarded;
+                    if (rxQueue.DrainTo(&discarded, 1) == 0) break;
+                    if (discarded.flags & VAN_RECORD_QUEUE_OVERRUN) nRxOverruns++;
+                    continue;
+                } // if
+            } // if
+
+            // Drain straight into the ring, as far as it has contiguous room
+            int at = headIdx & (N - 1);
+            int got = rxQueue.DrainTo(records + at, room < N - at ? room : N - at);
+            if (got == 0) break;
+
+            if (records[at].flags & VAN_RECORD_QUEUE_OVERRUN) nRxOverruns++;
+
+            headIdx += got;
+            nIn += got;
+            n += got;
+        } // for
+
+        int level = Level();
+        if (level > maxLevel) maxLevel = level;
+        if (! congested && level >= highWater)
+        {
+            congested = true;
+            nCongested++;
+        } // if
+
+        return n;
+    } // Fill
+
+    // Copies the oldest packet out of the spool. Returns false if the spool is empty.
+    bool Receive(TVanPacketRecord& record)
+    {
+        if (Level() == 0) return false;
+
+        record = records[tailIdx & (N - 1)];
+        tailIdx++;
+        nOut++;
+
+        if (congested && Level() <= lowWater) congested = false;
+
+        return true;
+    } // Receive
+
+    // Same, into a packet descriptor (see 'TVanPacketRxDesc::Load(...)')
+    bool Receive(TVanPacketRxDesc& pkt)
+    {
+        if (Level() == 0) return false;
+
+        pkt.Load(records[tailIdx & (N - 1)], rxQueue);
+        tailIdx++;
+        nOut++;
+
+        if (congested && Level() <= lowWater) congested = false;
+
+        return true;
+    } // Receive
+
+    int Level() const { return (uint16_t)(headIdx - tailIdx); }
+    bool IsCongested() const { return congested; }
+
+    // Statistics. Numbers can roll over.
+    uint32_t GetInCount() const { return nIn; }
+    uint32_t GetOutCount() const { return nOut; }
+    uint32_t GetDropCount() const { return nDropped; }
+    uint32_t GetRxOverrunCount() const { return nRxOverruns; }
+
+    void DumpStats(Stream& s) const
+    {
+        s.printf_P(
+            PSTR("spool in: %lu, out: %lu, dropped: %lu, blocked: %lu, Rx overruns: %lu, congested: %lu, "
+                "level: %d/%d (max %d)\n"),
+            nIn,
+            nOut,
+            nDropped,
+            nBlocked,
+            nRxOverruns,
+            nCongested,
+            Level(),
+            N,
+            maxLevel);
+    } // DumpStats
+
+  private:
+
+    TVanPacketRxQueue& rxQueue;
+    VanSpoolDropPolicy_t policy;
+    int highWater;
+    int lowWater;
+
+    TVanPacketRecord records[N];
+    uint16_t headIdx;  // Free-running; index into 'records' is 'headIdx & (N - 1)'
+    uint16_t tailIdx;  // Same
+    bool congested;
+    bool started;
+
+    // Statistics
+    uint32_t nIn;  // Drained from the Rx queue into the spool
+    uint32_t nOut;  // Taken out by the consumer
+    uint32_t nDropped;  // Discarded because the spool was full
+    uint32_t nBlocked;  // Times that packets were left in the Rx queue because the spool was full
+    uint32_t nRxOverruns;  // Rx queue overruns seen; each may have lost one or more packets
+    uint32_t nCongested;  // Times that the high water mark was reached
+    int maxLevel;
+}; // class TVanPacketSpool
+
+#endif // VanBusSpool_h
@@ -0,0 +1,149 @@
+/*
+ * VanBus timer scheduler for ESP8266
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+#include "VanBusTimer.h"
+
+// Clock to timer (prescaler) is always 80MHz, even F_CPU is 160 MHz. With TIM_DIV16, one tick is 16 CPU cycles at
+// 80 MHz.
+#define VAN_TIMER_TICK_CPU_CYCLES (16 * (F_CPU / 80000000))
+
+// Longest time that timer1 can be set for (23 bits); a later time-out is just set again when that expires
+#define VAN_TIMER_MAX_TICKS 0x7FFFFF
+
+// Timer1 ISR while the bit timer is not running
+void ICACHE_RAM_ATTR TimeoutIsr()
+{
+    VanBusTimer._RunExpired();
+} // TimeoutIsr
+
+void TVanBusTimer::Setup()
+{
+    if (initialized) return;
+    initialized = true;
+
+    timer1_isr_init();
+    timer1_disable();
+} // TVanBusTimer::Setup
+
+void ICACHE_RAM_ATTR TVanBusTimer::_Arm(int slot, uint32_t at, TVanTimeoutIsr isr, void* context)
+{
+    TVanTimeout* timeout = timeouts + slot;
+    timeout->at = at;
+    timeout->isr = isr;
+    timeout->context = context;
+
+    _waiting &= ~(1 << slot);
+    _armed |= 1 << slot;
+
+    // While the bit timer is running, its ISR checks the time-outs
+    if (_bitTimerIsr == NULL && ! _running) _SetTimer();
+} // TVanBusTimer::_Arm
+
+void ICACHE_RAM_ATTR TVanBusTimer::_Disarm(int slot)
+{
+    _waiting &= ~(1 << slot);
+    if ((_armed & 1 << slot) == 0) return;
+
+    _armed &= ~(1 << slot);
+    if (_bitTimerIsr == NULL && ! _running) _SetTimer();
+} // TVanBusTimer::_Disarm
+
+void ICACHE_RAM_ATTR TVanBusTimer::_WaitForBitTimer(int slot, TVanTimeoutIsr isr, void* context)
+{
+    TVanTimeout* timeout = timeouts + slot;
+    timeout->isr = isr;
+    timeout->context = context;
+
+    _armed &= ~(1 << slot);
+    _waiting |= 1 << slot;
+} // TVanBusTimer::_WaitForBitTimer
+
+void ICACHE_RAM_ATTR TVanBusTimer::_StartBitTimer(timercallback isr, uint32_t ticks)
+{
+    _bitTimerIsr = isr;
+
+    timer1_disable();
+    timer1_attachInterrupt(isr);
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+    timer1_write(ticks);
+} // TVanBusTimer::_StartBitTimer
+
+void ICACHE_RAM_ATTR TVanBusTimer::_StopBitTimer()
+{
+    _bitTimerIsr = NULL;
+
+    // Whoever was waiting for the bit timer, can try now
+    if (_waiting != 0)
+    {
+        uint32_t now = ESP.getCycleCount();
+        for (int slot = 0; slot < VAN_TIMER_SLOTS; slot++)
+        {
+            if (_waiting & 1 << slot) timeouts[slot].at = now;
+        } // for
+
+        _armed |= _waiting;
+        _waiting = 0;
+    } // if
+
+    if (! _running) _SetTimer();
+} // TVanBusTimer::_StopBitTimer
+
+// Calls the ISR of each expired time-out. Then, unless one of those has started the bit timer, sets timer1 for the
+// next time-out.
+void ICACHE_RAM_ATTR TVanBusTimer::_RunExpired()
+{
+    _running = true;
+
+    uint32_t now = ESP.getCycleCount();
+    for (int slot = 0; slot < VAN_TIMER_SLOTS; slot++)
+    {
+        if ((_armed & 1 << slot) == 0) continue;
+
+        TVanTimeout* timeout = timeouts + slot;
+        if ((int32_t)(now - timeout->at) < 0) continue;  // Arithmetic has safe roll-over
+
+        // Disarm first: the ISR may arm the slot again
+        _armed &= ~(1 << slot);
+        timeout->isr(timeout->context);
+    } // for
+
+    _running = false;
+
+    if (_bitTimerIsr == NULL) _SetTimer();
+} // TVanBusTimer::_RunExpired
+
+// Sets timer1, single shot, for the earliest armed time-out. Disables timer1 if there is none.
+void ICACHE_RAM_ATTR TVanBusTimer::_SetTimer()
+{
+    timer1_disable();
+    if (_armed == 0) return;
+
+    uint32_t now = ESP.getCycleCount();
+    int32_t earliest = INT32_MAX;
+    for (int slot = 0; slot < VAN_TIMER_SLOTS; slot++)
+    {
+        if ((_armed & 1 << slot) == 0) continue;
+
+        int32_t nCycles = timeouts[slot].at - now;  // Arithmetic has safe roll-over
+        if (nCycles < earliest) earliest = nCycles;
+    } // for
+
+    // Round up, so that the time-out has expired when the ISR is called
+    uint32_t ticks =
+        earliest <= 0 ? 1 :
+        (uint32_t)earliest / VAN_TIMER_TICK_CPU_CYCLES + 1;
+    if (ticks > VAN_TIMER_MAX_TICKS) ticks = VAN_TIMER_MAX_TICKS;
+
+    timer1_attachInterrupt(TimeoutIsr);
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+    timer1_write(ticks);
+} // TVanBusTimer::_SetTimer
+
+TVanBusTimer VanBusTimer;
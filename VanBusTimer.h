@@ -0,0 +1,108 @@
+/*
+ * VanBus timer scheduler for ESP8266
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+// The ESP8266 has one hardware timer that can be used from ISR: timer1. All VAN buses share it, for:
+// - the ACK time-out after each received packet;
+// - the start of an in-frame response;
+// - the start of a transmission, as soon as the bus may be idle;
+// - the bit timer, once every bit time, while a packet or an in-frame response is being sent.
+// The first three are "time-outs": single shot, at a CPU cycle counter value. Each bus has one time-out slot for its
+// receiver and one for its transmitter. Timer1 is set for the earliest armed time-out.
+// The bit timer can be used by only one bus at a time. While it runs, the time-outs are checked by the bit timer ISR,
+// once every bit time, so they can be up to one bit time late. A transmitter that wants the bit timer while another
+// bus is using it, waits until it is stopped.
+// This is internal to the library; the sketch does not need to use it.
+
+#ifndef VanBusTimer_h
+#define VanBusTimer_h
+
+#include <Arduino.h>
+
+// Maximum number of VAN buses, i.e. TVanPacketRxQueue objects that can be set up. Each bus has its own Rx pin (and
+// pin change ISR) and its own time-out slots.
+// To override, define as a build flag (e.g. '-DVAN_MAX_BUSES=1'), so that it is the same for all compile units.
+#ifndef VAN_MAX_BUSES
+#define VAN_MAX_BUSES 2
+#endif // VAN_MAX_BUSES
+
+#if VAN_MAX_BUSES < 1 || VAN_MAX_BUSES > 4
+#error "VAN_MAX_BUSES must be 1 ... 4"
+#endif
+
+#define VAN_NO_BUS (0xFF)
+
+#define VAN_TIMER_RX_SLOT(BUS) ((BUS) * 2)
+#define VAN_TIMER_TX_SLOT(BUS) ((BUS) * 2 + 1)
+#define VAN_TIMER_SLOTS (VAN_MAX_BUSES * 2)
+
+// Called from ISR when a time-out has expired, with the context as passed to 'TVanBusTimer::_Arm(...)'
+typedef void (*TVanTimeoutIsr)(void* context);
+
+struct TVanTimeout
+{
+    uint32_t at;  // CPU cycle counter value
+    TVanTimeoutIsr isr;
+    void* context;
+}; // struct TVanTimeout
+
+class TVanBusTimer
+{
+  public:
+
+    // Constructor
+    TVanBusTimer()
+        : initialized(false)
+        , _armed(0)
+        , _waiting(0)
+        , _bitTimerIsr(NULL)
+        , _running(false)
+    { }
+
+    // Takes timer1; the first call does the work
+    void Setup();
+
+    // The methods below are only to be called from ISR, or with interrupts disabled
+
+    // Arms the time-out in 'slot', to call 'isr' at CPU cycle counter value 'at'. An already armed time-out in that
+    // slot is replaced.
+    void ICACHE_RAM_ATTR _Arm(int slot, uint32_t at, TVanTimeoutIsr isr, void* context);
+    void ICACHE_RAM_ATTR _Disarm(int slot);
+    bool ICACHE_RAM_ATTR _IsArmed(int slot) const { return (_armed | _waiting) & 1 << slot; }
+
+    // Calls 'isr' as soon as the bit timer is stopped
+    void ICACHE_RAM_ATTR _WaitForBitTimer(int slot, TVanTimeoutIsr isr, void* context);
+
+    // Starts the bit timer, calling 'isr' every 'ticks' timer1 ticks, in phase with the current moment. The caller
+    // must have checked with '_IsBitTimerRunning()' that no other bus is using it.
+    void ICACHE_RAM_ATTR _StartBitTimer(timercallback isr, uint32_t ticks);
+    void ICACHE_RAM_ATTR _StopBitTimer();
+    bool ICACHE_RAM_ATTR _IsBitTimerRunning() const { return _bitTimerIsr != NULL; }
+
+    // To be called by the bit timer ISR, once every bit time: runs the expired time-outs
+    void ICACHE_RAM_ATTR _Poll() { if (_armed != 0) _RunExpired(); }
+
+  private:
+
+    bool initialized;
+    TVanTimeout timeouts[VAN_TIMER_SLOTS];
+    volatile uint8_t _armed;  // Bit mask of slots
+    volatile uint8_t _waiting;  // Bit mask of slots waiting for the bit timer
+    timercallback volatile _bitTimerIsr;  // NULL if the bit timer is not running
+    bool _running;  // Inside '_RunExpired()'
+
+    void ICACHE_RAM_ATTR _RunExpired();
+    void ICACHE_RAM_ATTR _SetTimer();
+
+    friend void TimeoutIsr();
+}; // class TVanBusTimer
+
+extern TVanBusTimer VanBusTimer;
+
+#endif // VanBusTimer_h
@@ -8,6 +8,7 @@
  * MIT license, all text above must be included in any redistribution.
  */
 
+#include <Schedule.h>
 #include "VanBus.h"
 
 // 1 bit time slot = 8 us
@@ -16,123 +17,366 @@
 // 1 bit time slot = 8.2 us --> Seems to work much better than 8 us time slots ?!
 #define VAN_BIT_TIMER_TICKS (8 * 5 + 1)
 
+void DeliverTxCompletionsScheduled()
+{
+    // Not known which bus scheduled this; the others have nothing to report, and return quickly
+    for (int i = 0; i < VAN_MAX_BUSES; i++)
+    {
+        TVanPacketRxQueue* rxQueue = TVanPacketRxQueue::buses[i];
+        if (rxQueue != NULL && rxQueue->txQueue != NULL) rxQueue->txQueue->DeliverTxCompletions();
+    } // for
+} // DeliverTxCompletionsScheduled
+
+// Constructed once, so that the ISR does not have to
+static const std::function<void(void)> deliverTxCompletionsFn(DeliverTxCompletionsScheduled);
+
+// Lookup table for the "Enhanced Manchester" encoding of a nibble: the 4 bits, followed by the inverse of the 4th bit.
+// Like the CRC-15 lookup table, a nibble table of 16 entries is used in stead of a byte table of 256 entries (512
+// bytes of precious RAM); it takes just one extra shift and OR per byte.
+static const uint8_t stuffedNibbleTable[16] =
+{
+    0x01, 0x02, 0x05, 0x06, 0x09, 0x0A, 0x0D, 0x0E,
+    0x11, 0x12, 0x15, 0x16, 0x19, 0x1A, 0x1D, 0x1E
+}; // stuffedNibbleTable
+
+// Returns the "Enhanced Manchester" encoding of a byte: after every 4 bits, the inverse of the 4th bit is inserted.
+//   9 8 7 6 5 4 3 2 1 0
+//   X X X X m X X X X m
+inline uint16_t StuffByte(uint8_t byte)
+{
+    return stuffedNibbleTable[byte >> 4] << 5 | stuffedNibbleTable[byte & 0x0F];
+} // StuffByte
+
+// The transmitter that has the bit timer, i.e. that is sending a packet; NULL if none. There is only one timer1, so
+// only one bus can send at a time; see 'TVanBusTimer'.
+static TVanPacketTxQueue* volatile txSending;
+
 // Finish packet transmission
-void ICACHE_RAM_ATTR FinishPacketTransmission(TVanPacketTxDesc* txDesc)
+void ICACHE_RAM_ATTR FinishPacketTransmission(TVanPacketTxQueue& tx, TVanPacketTxDesc* txDesc)
 {
+    TVanPacketRxQueue& rx = *tx.rxQueue;
+
     // Save statistics
+    ++tx.nTransmitted;
     if (txDesc->nCollisions != 0)
     {
-        if (txDesc->nCollisions == 1) ++VanBusTx.nSingleCollisions; else ++VanBusTx.nMultipleCollisions;
+        if (txDesc->nCollisions == 1) ++tx.nSingleCollisions; else ++tx.nMultipleCollisions;
     } // if
 
-    VanBusTx._AdvanceTail();
+    // The packet is sent, so there is time for a division
+    tx.ifsBits.Add(txDesc->interFrameCpuCycles / (VAN_BIT_TIMER_TICKS * 16 * CPU_F_FACTOR));
+
+    tx._AdvanceTail();
 
     // Nothing more to send?
-    if (VanBusTx._tail->state == VAN_TX_DONE)
+    if (tx._nQueued == 0)
     {
-        VanBusRx.RegisterTxIsr(NULL);
-        timer1_disable();
+        txSending = NULL;
+        VanBusTimer._StopBitTimer();
     } // if 
 
-    VanBusRx.SetLastMediaAccessAt(ESP.getCycleCount()); // It was me! :-)
+    rx.SetLastMediaAccessAt(ESP.getCycleCount()); // It was me! :-)
 
     // Start listening again at other devices on the bus
-    attachInterrupt(digitalPinToInterrupt(VanBusRx.pin), RxPinChangeIsr, CHANGE);
-} // 
+    if (rx.engine == VAN_RX_ENGINE_GPIO_ISR)
+    {
+        attachInterrupt(digitalPinToInterrupt(rx.pin), rx.pinChangeIsr, CHANGE);
+    } // if
 
-// Send one bit on the VAN bus
-void ICACHE_RAM_ATTR SendBitIsr()
-{
-    uint32_t curr = ESP.getCycleCount();  // Store CPU cycle counter value as soon as possible
+    // Report completion outside ISR
+    if (tx.txCallback != NULL) schedule_function(deliverTxCompletionsFn);
+} // FinishPacketTransmission
+
+// Number of CPU cycles the bus must have been idle before a transmission may start: 8 (EOF) + 5 (IFS) bits
+#define VAN_TX_IDLE_CPU_CYCLES ((8 /* EOF */ + 5 /* IFS */) * (VAN_BIT_TIMER_TICKS * 16) * CPU_F_FACTOR)
 
-    static unsigned int atBit = 9;
+void ICACHE_RAM_ATTR SendBitIsr();
+void ICACHE_RAM_ATTR TxStartIsr(void* context);
+
+// Arms the time-out once, for the earliest moment that transmission may start, given that the bus has been idle for
+// 'nIdleCycles' CPU cycles at CPU cycle counter value 'curr'. Any bus activity in the meantime pushes that moment
+// further; the ISR then just arms again. This saves calling the ISR every bit time while the bus is busy, i.e. while
+// a packet is being received. If this transmitter has the bit timer, it is given up.
+void ICACHE_RAM_ATTR TVanPacketTxQueue::_ArmStartTimer(uint32_t curr, uint32_t nIdleCycles)
+{
+    uint32_t nCycles = nIdleCycles < VAN_TX_IDLE_CPU_CYCLES ? VAN_TX_IDLE_CPU_CYCLES - nIdleCycles : 0;
+    VanBusTimer._Arm(VAN_TIMER_TX_SLOT(rxQueue->busIdx), curr + nCycles, TxStartIsr, this);
 
+    if (txSending == this)
+    {
+        txSending = NULL;
+        VanBusTimer._StopBitTimer();
+    } // if
+} // TVanPacketTxQueue::_ArmStartTimer
+
+// Send one bit on the VAN bus. 'curr' is the CPU cycle counter value at ISR entry.
+// Note: when the compiler inlines this function, the code ends up in the caller (in IRAM). When the compiler decides
+// not to inline it, ICACHE_RAM_ATTR makes sure the out-of-line copy is also in IRAM, so that it is safe to call from
+// ISR.
+// Only one transmitter has the bit timer at a time, so the static variables below are never shared between buses.
+inline void ICACHE_RAM_ATTR SendBit(TVanPacketTxQueue& tx, uint32_t curr)
+{
     static uint16_t* p_stuffedByte;
 
-    TVanPacketTxDesc* txDesc = VanBusTx._tail;
+    // The stuffed byte being sent, fetched once per 10 bits, and a mask rolling over it from bit 9 down to bit 0
+    static uint16_t stuffedByte;
+    static uint16_t bitMask;
 
-    //if (txDesc->state == VAN_TX_DONE) return;
+    // Loopback: while sending, the Rx pin level is sampled here, once every bit time, in stead of having
+    // 'RxPinChangeIsr' attached
+    static bool rxLoopback = false;
+
+    TVanPacketRxQueue& rx = *tx.rxQueue;
+    TVanPacketTxDesc* txDesc = tx._Tail();
 
     if (txDesc->state == VAN_TX_WAITING)
     {
-        // Wait at least 8 (EOF) + 4 (IFS) bits after last media access
-        uint32_t nCycles = curr - VanBusRx.GetLastMediaAccessAt();  // Arithmetic has safe roll-over
-        if (nCycles < (8 /* EOF */ + 5 /* IFS */) * (VAN_BIT_TIMER_TICKS * 16) * CPU_F_FACTOR)
+        // Wait at least 8 (EOF) + 5 (IFS) bits after last media access
+        uint32_t nCycles = curr - rx.GetLastMediaAccessAt();  // Arithmetic has safe roll-over
+        if (nCycles < VAN_TX_IDLE_CPU_CYCLES)
         {
             txDesc->busOccupied = true;
+            tx.nWastedTimerWakeups++;
+            tx._ArmStartTimer(curr, nCycles);
             return;
         } // if
 
+        if (txSending != &tx)
+        {
+            // Another bus is sending? Then wait for it to finish, and check again.
+            if (VanBusTimer._IsBitTimerRunning())
+            {
+                VanBusTimer._WaitForBitTimer(VAN_TIMER_TX_SLOT(rx.busIdx), TxStartIsr, &tx);
+                return;
+            } // if
+
+            // Start the bit timer, in phase with this first bit
+            txSending = &tx;
+            VanBusTimer._StartBitTimer(SendBitIsr, VAN_BIT_TIMER_TICKS);
+        } // if
+
         // Don't waste precious CPU time handling the RX pin interrupts of my own transmssion.
-        // TODO - this will cause any colliding incoming packet to be not received by the receiver.
-        detachInterrupt(digitalPinToInterrupt(VanBusRx.pin));
+        // Note: unless loopback is enabled, this will cause any colliding incoming packet to be not received by the
+        // receiver. The I2S receive engine does not need the interrupts, and always receives.
+        // A "read" packet requesting an in-frame response is always sampled: the receiver must have the whole
+        // frame, to receive the response.
+        rxLoopback = false;
+        if (rx.engine == VAN_RX_ENGINE_GPIO_ISR)
+        {
+            detachInterrupt(digitalPinToInterrupt(rx.pin));
+            rxLoopback = tx.loopback || txDesc->IsInFrameRequest();
+        } // if
 
         txDesc->interFrameCpuCycles = nCycles;
         txDesc->state = VAN_TX_SENDING;
-        atBit = 9;
         p_stuffedByte = txDesc->stuffedBytes;
+        stuffedByte = *p_stuffedByte;
+        bitMask = 1 << 9;
     } // if
 
     static int lastSetLevel = VAN_BIT_RECESSIVE;
+    static uint32_t lastSetAt;  // CPU cycle counter value when the previous bit was written
+
+    // Check if previously transmitted bit has been copied by reading RX pin
+    int pinLevel = GPIP(rx.pin);
 
     // Detect collision and bit errors until (but not including) the EOD. Otherwise we will see an ACK bit from the
-    // receiver as a collision.
+    // receiver as a collision. Most of the time, the bit was copied just fine.
     if (p_stuffedByte < txDesc->p_eod)
     {
-        // Check if previously transmitted bit has been copied by reading RX pin
-        int pinLevel = GPIP(VanBusRx.pin);
-
-        if (pinLevel == VAN_BIT_DOMINANT && lastSetLevel == VAN_BIT_RECESSIVE)
+        if (pinLevel == lastSetLevel) txDesc->bitOk = true;
+        else if (pinLevel == VAN_BIT_RECESSIVE) txDesc->bitError = true;
+        else
         {
             int atByte = p_stuffedByte - txDesc->stuffedBytes;
-            if (txDesc->nCollisions == 0) txDesc->firstCollisionAtBit = atByte * 10 + (9 - atBit);
+
+            // RTR bit overwritten? Then that is not a collision, but the start of an in-frame response.
+            if (atByte == 2 && bitMask == 1 << 0 && txDesc->IsInFrameRequest())
+            {
+                // Stop driving the bus, and let the receiver take the rest of the frame
+                GPOS = (1 << tx.txPin);
+                lastSetLevel = VAN_BIT_RECESSIVE;
+                if (rxLoopback) RxPinSampledByTx(rx, pinLevel, lastSetAt);
+                txDesc->inFrameResponse = true;
+                FinishPacketTransmission(tx, txDesc);
+                return;
+            } // if
+
+            if (txDesc->nCollisions == 0) txDesc->firstCollisionAtBit = atByte * 10 + (9 - __builtin_ctz(bitMask));
             txDesc->nCollisions++;
 
             // Backout and start all over again
             txDesc->state = VAN_TX_WAITING;
-        } // if
 
-        if (pinLevel == VAN_BIT_RECESSIVE && lastSetLevel == VAN_BIT_DOMINANT) txDesc->bitError = true;
-
-        if (pinLevel == lastSetLevel) txDesc->bitOk = true;
+            if (rxLoopback)
+            {
+                // Lost arbitration: stop driving the bus, and hand over to the receiver, so that it receives the
+                // winning packet. Also, media access detection in 'RxPinChangeIsr' makes us wait until that packet
+                // is finished.
+                GPOS = (1 << tx.txPin);
+                lastSetLevel = VAN_BIT_RECESSIVE;
+                // Arbitration is bit-synchronous: the winner's dominant bit started when we wrote our recessive bit
+                RxPinSampledByTx(rx, pinLevel, lastSetAt);
+                attachInterrupt(digitalPinToInterrupt(rx.pin), rx.pinChangeIsr, CHANGE);
+                rxLoopback = false;
+                return;
+            } // if
+        } // if
+    }
+    else if (p_stuffedByte == txDesc->p_eod && (bitMask & (1 << 8 | 1 << 7)))
+    {
+        // We are sending recessive during the two ACK time slots; a dominant level means a receiver acknowledged
+        if (pinLevel == VAN_BIT_DOMINANT) txDesc->ackSeen = true;
     } // if
 
-    uint16_t byte = *p_stuffedByte;
-    uint16_t bit = byte & (1 << atBit); // TODO - use static bitMask variable: bitmask <<= 1;
+    // The bit was on the bus from the moment it was written
+    if (rxLoopback) RxPinSampledByTx(rx, pinLevel, lastSetAt);
 
     // Write to GPIO pin
-    if (bit != 0)
+    if (stuffedByte & bitMask)
     {
-        GPOS = (1 << VanBusTx.txPin);
+        GPOS = (1 << tx.txPin);
         lastSetLevel = VAN_BIT_RECESSIVE;
     }
     else
     {
-        GPOC = (1 << VanBusTx.txPin);
+        GPOC = (1 << tx.txPin);
         lastSetLevel = VAN_BIT_DOMINANT;
     } // if
+    lastSetAt = curr;
 
     // Advance to next bit
-    if (atBit-- == 0)
+    bitMask >>= 1;
+    if (bitMask == 0)
     {
         // Advance to next byte
-        atBit = 9;
+        bitMask = 1 << 9;
 
         // Finished sending packet?
-        if (++p_stuffedByte == txDesc->p_last) FinishPacketTransmission(txDesc);
+        if (++p_stuffedByte == txDesc->p_last) FinishPacketTransmission(tx, txDesc);
+        else stuffedByte = *p_stuffedByte;
     } // if
+} // SendBit
+
+// Measure the CPU cycles spent in the transmitter ISR: the longer it takes, the more it wobbles the Rx ISR timing
+inline void ICACHE_RAM_ATTR CountBitIsrCycles(TVanPacketTxQueue& tx, uint32_t curr)
+{
+    uint32_t nCycles = ESP.getCycleCount() - curr;  // Arithmetic has safe roll-over
+    tx.nBitIsrCalls++;
+    tx.nBitIsrCycles += nCycles;
+    tx.bitIsrCycles.Add(nCycles);
+} // CountBitIsrCycles
+
+// Timer1 ISR while there are packets to send: called once every bit time
+void ICACHE_RAM_ATTR SendBitIsr()
+{
+    uint32_t curr = ESP.getCycleCount();  // Store CPU cycle counter value as soon as possible
+
+    // Finishing the packet may give up the bit timer
+    TVanPacketTxQueue& tx = *txSending;
+    SendBit(tx, curr);
+    CountBitIsrCycles(tx, curr);
+
+    // The time-outs of the other buses
+    VanBusTimer._Poll();
 } // SendBitIsr
 
-// Initializes the VAN packet transmitter
-void TVanPacketTxQueue::Setup(uint8_t theRxPin, uint8_t theTxPin)
+// The bus may be idle: start transmitting. Called on timer1, see 'TVanPacketTxQueue::_ArmStartTimer(...)'.
+void ICACHE_RAM_ATTR TxStartIsr(void* context)
+{
+    uint32_t curr = ESP.getCycleCount();  // Store CPU cycle counter value as soon as possible
+
+    TVanPacketTxQueue& tx = *(TVanPacketTxQueue*)context;
+    SendBit(tx, curr);
+    CountBitIsrCycles(tx, curr);
+} // TxStartIsr
+
+// In-frame response being sent, the transmitter sending it, and the bit to send next
+static TVanPacketTxDesc* responseDesc;
+static TVanPacketTxQueue* responseTx;
+static uint16_t* p_responseByte;
+static int responseAtBit;
+
+// Send one bit of an in-frame response
+void ICACHE_RAM_ATTR SendResponseBitIsr()
+{
+    TVanPacketTxDesc* response = responseDesc;
+    uint8_t txPin = responseTx->txPin;
+
+    // EOD sent? Then leave the ACK slots to whoever wants to acknowledge.
+    if (p_responseByte == response->p_eod)
+    {
+        GPOS = (1 << txPin);
+        response->state = VAN_TX_DONE;
+        responseTx->nInFrameResponses++;
+
+        // Give timer1 back to the transmitters and the time-outs
+        VanBusTimer._StopBitTimer();
+        return;
+    } // if
+
+    if (*p_responseByte & 1 << responseAtBit) GPOS = (1 << txPin); else GPOC = (1 << txPin);
+
+    // Advance to next bit
+    if (responseAtBit-- == 0)
+    {
+        responseAtBit = 9;
+        p_responseByte++;
+    } // if
+
+    // The time-outs of the other buses
+    VanBusTimer._Poll();
+} // SendResponseBitIsr
+
+// Start of the RTR bit of a "read" packet, for which an in-frame response is registered. Called on timer1, as set
+// by the receiver ISR. 'context' is the receiving queue; the response is sent by the transmitter on the same bus.
+void ICACHE_RAM_ATTR InFrameResponseIsr(void* context)
+{
+    TVanPacketRxQueue& rx = *(TVanPacketRxQueue*)context;
+    TVanPacketTxQueue* tx = rx.txQueue;
+
+    TVanPacketTxDesc* response = rx._armedResponse;
+    rx._armedResponse = NULL;
+
+    // The requester must still be sending the recessive R/W and RTR bits. The bit timer may have been taken by
+    // another bus in the meantime.
+    if (response == NULL || tx == NULL || VanBusTimer._IsBitTimerRunning()
+        || GPIP(rx.pin) != VAN_BIT_RECESSIVE || rx._Head()->size != 2)
+    {
+        return;
+    } // if
+
+    // Overwrite the RTR bit
+    GPOC = (1 << tx->txPin);
+
+    // The requester has chosen the RAK bit, and with that, the CRC
+    int rak = rx._armedResponseRak;
+    response->stuffedBytes[response->eodAt - 2] = response->stuffedCrc[rak][0];
+    response->stuffedBytes[response->eodAt - 1] = response->stuffedCrc[rak][1];
+    response->state = VAN_TX_SENDING;
+
+    // Continue with the Manchester bit after RTR, then the data, CRC and EOD
+    responseDesc = response;
+    responseTx = tx;
+    p_responseByte = response->stuffedBytes + 2;
+    responseAtBit = 0;
+
+    VanBusTimer._StartBitTimer(SendResponseBitIsr, VAN_BIT_TIMER_TICKS);
+} // InFrameResponseIsr
+
+// Initializes the VAN packet transmitter, and the receiver on the same bus. Returns false if the receiver could not be
+// set up, see 'TVanPacketRxQueue::Setup(...)'.
+bool TVanPacketTxQueue::Setup(uint8_t theRxPin, uint8_t theTxPin)
 {
     txPin = theTxPin;
 
     pinMode(theTxPin, OUTPUT);
     digitalWrite(theTxPin, VAN_BIT_RECESSIVE);  // Set bus state to 'recessive'; CANH and CANL: not driven)
 
-    VanBusRx.Setup(theRxPin);
-    VanBusRx.RegisterTxTimerTicks(VAN_BIT_TIMER_TICKS);
+    if (! rxQueue->Setup(theRxPin)) return false;
+    rxQueue->txQueue = this;
+
+    return true;
 } // TVanPacketTxQueue::Setup
 
 // Send data as a packet on the VAN bus
@@ -140,13 +384,39 @@ void TVanPacketTxDesc::PreparePacket(uint16_t iden, uint8_t cmdFlags, const uint
 {
     Init();
 
-    n = VanBusTx.GetCount();
+    this->iden = iden & 0xFFF;
 
     // Send at most VAN_MAX_DATA_BYTES data
     if (dataLen > VAN_MAX_DATA_BYTES) dataLen = VAN_MAX_DATA_BYTES;
 
     // Prepare full packet data
     uint8_t bytes[VAN_MAX_PACKET_SIZE];
+    ComposeBytes(bytes, iden, cmdFlags, data, dataLen);
+
+    StuffBytes(bytes, dataLen + 5);
+} // TVanPacketTxDesc::PreparePacket
+
+// Stuffs a complete packet, SOF up to and including CRC, with Manchester bits, and adds EOD, ACK and EOF
+void TVanPacketTxDesc::StuffBytes(const uint8_t* bytes, size_t nBytes)
+{
+    for (int i = 0; i < nBytes; i++) stuffedBytes[i] = StuffByte(bytes[i]);
+
+    // The last bit is always 0 (CRC has been shifted left 1 bit), and the last Manchester bit is also always 0,
+    // to indicate EOD
+    stuffedBytes[nBytes - 1] &= 0xFFFC;
+    eodAt = nBytes;
+    p_eod = stuffedBytes + nBytes;
+
+    // End with 10 VAN_LOGICAL_HIGH-bits: 2 bits for the (optional) ACK, then 8 bits for EOF
+    stuffedBytes[nBytes] = 0xFFFF;
+    size = nBytes + 1;  // Adding 1 for the last 10 VAN_LOGICAL_HIGH-bits
+    p_last = stuffedBytes + nBytes + 1;
+
+    state = VAN_TX_WAITING;
+} // TVanPacketTxDesc::StuffBytes
+
+void TVanPacketTxDesc::ComposeBytes(uint8_t* bytes, uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen)
+{
     bytes[0] = 0x0E;  // SOF
     bytes[1] = iden >> 4 & 0xFF;  // IDEN (MSB 8 bits)
     bytes[2] = iden << 4 | 0x08 | cmdFlags & 0x07;  // IDEN (LSB 4 bits), fixed-1 (1 bit), COM (3 bits)
@@ -154,140 +424,617 @@ void TVanPacketTxDesc::PreparePacket(uint16_t iden, uint8_t cmdFlags, const uint
     uint16_t crc = _crc(bytes, dataLen + 5);
     bytes[dataLen + 3] = crc >> 8;
     bytes[dataLen + 4] = crc & 0xFF;
+} // TVanPacketTxDesc::ComposeBytes
 
-    // Stuff with Manchester bits
-    for (int i = 0; i < dataLen + 5; i++)
-    {
-        uint8_t byte = bytes[i];
-        stuffedBytes[i] = (byte & 0xF0) << 2 | (~ byte & 0x10) << 1 | (byte & 0x0F) << 1 | ~ byte & 0x01;
-    } // for
+void TVanPacketTxDesc::CopyFrom(const TVanPacketTxDesc& image)
+{
+    Init();
 
-    // The last bit is always 0 (CRC has been shifted left 1 bit), and the last Manchester bit is also always 0,
-    // to indicate EOD
-    stuffedBytes[dataLen + 4] &= 0xFFFC;
-    eodAt = dataLen + 5;
-    p_eod = stuffedBytes + dataLen + 5;
+    memcpy(stuffedBytes, image.stuffedBytes, image.size * sizeof(stuffedBytes[0]));
+    iden = image.iden;
+    size = image.size;
+    eodAt = image.eodAt;
 
-    // End with 10 VAN_LOGICAL_HIGH-bits: 2 bits for the (optional) ACK, then 8 bits for EOF
-    stuffedBytes[dataLen + 5] = 0xFFFF;
-    size = dataLen + 5 + 1;  // Adding 1 for the last 10 VAN_LOGICAL_HIGH-bits
-    p_last = stuffedBytes + dataLen + 5 + 1;
+    // Point into the own buffer, not into that of 'image'
+    p_eod = stuffedBytes + eodAt;
+    p_last = stuffedBytes + size;
 
     state = VAN_TX_WAITING;
-} // TVanPacketTxDesc::PreparePacket
+} // TVanPacketTxDesc::CopyFrom
 
-// Print information about a transmitted package
-void TVanPacketTxDesc::Dump() const
+// Prepares an in-frame response, to be registered with 'TVanPacketRxQueue::SetInFrameResponse(...)'
+void TVanPacketTxDesc::PrepareInFrameResponse(uint16_t iden, const uint8_t* data, size_t dataLen)
 {
-    // Only for transmitted packets
-    if (state != VAN_TX_DONE) return;
+    // The COM field as it will be on the bus: R/W set, and RTR cleared by the responder. RAK is as chosen by the
+    // requester, so prepare for both.
+    for (int rak = 0; rak <= 1; rak++)
+    {
+        PreparePacket(iden, rak << 2 | 0x02, data, dataLen);
+        stuffedCrc[rak][0] = stuffedBytes[eodAt - 2];
+        stuffedCrc[rak][1] = stuffedBytes[eodAt - 1];
+    } // for
 
-    // Only if there is something interesting to print
-    if (! busOccupied && bitOk && nCollisions == 0 && ! bitError) return;
+    // Not queued: 'InFrameResponseIsr' sends it
+    state = VAN_TX_DONE;
+} // TVanPacketTxDesc::PrepareInFrameResponse
+
+void TVanPacketTxQueue::StartBitSendTimer()
+{
+    ISR_SAFE_BEGIN();
+    if (txSending != this && ! VanBusTimer._IsArmed(VAN_TIMER_TX_SLOT(rxQueue->busIdx)))
+    {
+        // Transmitting a packet is done completely by interrupt-servicing. Preference is to not have the timer1
+        // interrupt handler being called while a packet is being received, so wake up only when the bus may be
+        // free. From there, 'SendBit' switches to the bit timer, once every bit time.
+        uint32_t now = ESP.getCycleCount();
+        _ArmStartTimer(now, now - rxQueue->GetLastMediaAccessAt());  // Arithmetic has safe roll-over
+    } // if
+    ISR_SAFE_END();
+} // void TVanPacketTxQueue::StartBitSendTimer
 
-    uint32_t ifsBits = interFrameCpuCycles / CPU_F_FACTOR / VAN_BIT_TIMER_TICKS / 16;
-    Serial.printf("#%lu, ifsBits=%lu%s", n, ifsBits, busOccupied ? ", busOccupied" : "");
+// Reserves a free descriptor to prepare a packet in: the one that was used longest ago, so that the status of the
+// more recent packets is kept. Returns NULL if there is none.
+// Reserving, and then queueing ("committing") with 'Queue(...)', are both atomic, so that packets can be sent from
+// several contexts, e.g. a web socket handler and a periodic task. For a single sender, there is always a free
+// descriptor, since the pool has one spare.
+// A descriptor of which the completion is not yet reported to the Tx callback is not re-used. If there is no other,
+// the pending completions are reported right here.
+TVanPacketTxDesc* TVanPacketTxQueue::ReserveSlot()
+{
+    TVanPacketTxDesc* txDesc = TryReserveSlot();
 
-    if (nCollisions > 0) Serial.printf(", nCollisions=%lu, firstCollisionAtBit=%lu", nCollisions, firstCollisionAtBit);
+    // Not allowed from within a transmit callback
+    if (txDesc == NULL && ! deliveringTxCompletions)
+    {
+        DeliverTxCompletions();
+        txDesc = TryReserveSlot();
+    } // if
 
-    Serial.printf("%s%s\n", bitOk ? "" : ", NO bitOk", bitError ? ", bitError" : "");
-} // TVanPacketTxDesc::DumpStats
+    return txDesc;
+} // TVanPacketTxQueue::ReserveSlot
 
-void TVanPacketTxQueue::StartBitSendTimer()
+// As 'ReserveSlot()', but does not report any pending completions to make a descriptor free
+TVanPacketTxDesc* TVanPacketTxQueue::TryReserveSlot()
 {
-    VanBusRx.RegisterTxIsr(SendBitIsr);
+    uint32_t nQueued = GetCount();
+    TVanPacketTxDesc* oldest = NULL;
 
-    // TODO - wait here until:
-    // nCycles >= (8 /* EOF */ + 5 /* IFS */) * (VAN_BIT_TIMER_TICKS * 16) * CPU_F_FACTOR
-    // If we start the SendBitIsr now, we might introduce extra wobbling in the RxPinChangeIsr, causing CRC errors
-    // Preference is to not have the timer1 interrupt handler being called while a packet is being received.
+    ISR_SAFE_BEGIN();
 
-    uint32_t curr = ESP.getCycleCount();
-    uint32_t nCycles = curr - VanBusRx.GetLastMediaAccessAt();  // Arithmetic has safe roll-over
-    //if (nCycles < (8 /* EOF */ + 5 /* IFS */) * (VAN_BIT_TIMER_TICKS * 16) * CPU_F_FACTOR) return;
+    for (int i = 0; i < VAN_TX_QUEUE_SIZE + 1; i++)
+    {
+        TVanPacketTxDesc* txDesc = pool + i;
+        if (txDesc->state != VAN_TX_DONE || txDesc->reportPending) continue;
 
-    noInterrupts();
-    if (! timer1_enabled())
+        // Arithmetic has safe roll-over. Note: a never queued descriptor ('n' == UINT32_MAX) comes out oldest.
+        if (oldest == NULL || nQueued - txDesc->n > nQueued - oldest->n) oldest = txDesc;
+    } // for
+
+    // No longer VAN_TX_DONE, so no other sender can take it. The status of its previous packet is gone.
+    if (oldest != NULL)
     {
-        // Transmitting a packet is done completely by interrupt-servicing
+        oldest->state = VAN_TX_WAITING;
+        oldest->n = UINT32_MAX;
+    } // if
+
+    ISR_SAFE_END();
+
+    return oldest;
+} // TVanPacketTxQueue::TryReserveSlot
+
+// Returns the descriptor of the packet identified by 'ticket', or NULL if its descriptor has been re-used
+const TVanPacketTxDesc* TVanPacketTxQueue::FindTicket(TVanTxTicket ticket) const
+{
+    // Not yet issued? Arithmetic has safe roll-over.
+    if (ticket - GetCount() < 0x80000000UL) return NULL;
+
+    for (int i = 0; i < VAN_TX_QUEUE_SIZE + 1; i++) if (pool[i].n == ticket) return pool + i;
+
+    return NULL;
+} // TVanPacketTxQueue::FindTicket
+
+// Queues a prepared packet, in the order as set with 'SetQueueOrder(...)'. With coalescing enabled, a queued packet
+// with the same IDEN and command flags that is not yet being sent, is replaced. Returns false if the queue is full.
+bool TVanPacketTxQueue::Queue(TVanPacketTxDesc* txDesc)
+{
+    uint8_t slot = txDesc - pool;
 
-        // Set a repetitive timer
-        timer1_disable();
-        timer1_attachInterrupt(SendBitIsr);
+    ISR_SAFE_BEGIN();
 
-        // Clock to timer (prescaler) is always 80MHz, even F_CPU is 160 MHz
-        timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+    // The packet at the tail may already be on the bus; then it must stay in front
+    int first = _nQueued != 0 && _Tail()->state != VAN_TX_WAITING ? 1 : 0;
 
-        timer1_write(VAN_BIT_TIMER_TICKS);
+    if (coalescing)
+    {
+        for (int i = first; i < _nQueued; i++)
+        {
+            uint8_t* at = order + ((_tailIdx + i) & VAN_TX_QUEUE_MASK);
+            TVanPacketTxDesc* queued = pool + *at;
+
+            // IDEN and command flags are all in stuffed byte 2, except the 8 MSB of the IDEN
+            if (queued->iden != txDesc->iden || queued->stuffedBytes[2] != txDesc->stuffedBytes[2]) continue;
+
+            // Take its place in the queue
+            queued->replaced = true;
+            queued->state = VAN_TX_DONE;
+            *at = slot;
+            txDesc->n = count++;
+            txDesc->reportPending = txCallback != NULL;
+            nReplaced++;
+
+            ISR_SAFE_END();
+            return true;
+        } // for
+    } // if
+
+    if (_nQueued >= VAN_TX_QUEUE_SIZE)
+    {
+        ISR_SAFE_END();
+        return false;
     } // if
-    interrupts();
-} // void TVanPacketTxQueue::StartBitSendTimer
 
-// Wait until the head of the queue is available. When 'timeOutMs' is set to 0, will wait forever.
-bool TVanPacketTxQueue::WaitForHeadAvailable(unsigned int timeOutMs)
+    // When ordering on IDEN, insert after all queued packets with lower or equal IDEN
+    int i = _nQueued;
+    if (queueOrder == VAN_TX_ORDER_IDEN)
+    {
+        while (i > first && pool[order[(_tailIdx + i - 1) & VAN_TX_QUEUE_MASK]].iden > txDesc->iden)
+        {
+            order[(_tailIdx + i) & VAN_TX_QUEUE_MASK] = order[(_tailIdx + i - 1) & VAN_TX_QUEUE_MASK];
+            i--;
+        } // while
+    } // if
+
+    order[(_tailIdx + i) & VAN_TX_QUEUE_MASK] = slot;
+    _nQueued++;
+    txDesc->n = count++;
+    txDesc->reportPending = txCallback != NULL;
+
+    ISR_SAFE_END();
+    return true;
+} // TVanPacketTxQueue::Queue
+
+// Queues a prepared packet. If the queue is full, waits at most 'timeOutMs' milliseconds. When 'timeOutMs' is set to
+// 0, will wait forever.
+bool TVanPacketTxQueue::WaitToQueue(TVanPacketTxDesc* txDesc, unsigned int timeOutMs)
 {
     unsigned int waitPoll = timeOutMs;
 
     // Relying on short-circuit boolean evaluation
-    while (! SlotAvailable() && (timeOutMs == 0 || --waitPoll > 0)) delay(1);
+    while (! Queue(txDesc))
+    {
+        if (timeOutMs != 0 && --waitPoll == 0)
+        {
+            // Free the descriptor again
+            txDesc->state = VAN_TX_DONE;
+            ++nDropped;
+            return false;
+        } // if
+
+        delay(1);
+    } // while
 
-    return SlotAvailable();
-} // TVanPacketTxQueue::WaitForHeadAvailable
+    StartBitSendTimer();
+
+    return true;
+} // TVanPacketTxQueue::WaitToQueue
+
+// Waits until the packet has been transmitted (or replaced). When 'timeOutMs' is set to 0, will wait forever.
+bool TVanPacketTxQueue::WaitForDone(const TVanPacketTxDesc* txDesc, unsigned int timeOutMs)
+{
+    unsigned int waitPoll = timeOutMs;
+
+    // Relying on short-circuit boolean evaluation
+    while (txDesc->state != VAN_TX_DONE && (timeOutMs == 0 || --waitPoll > 0)) delay(1);
+
+    return txDesc->state == VAN_TX_DONE;
+} // TVanPacketTxQueue::WaitForDone
 
 // Synchronous packet send: returns as soon as the packet was transmitted.
 // Will wait at most 'timeOutMs' milliseconds. When 'timeOutMs' is set to 0, will wait forever
 bool TVanPacketTxQueue::SyncSendPacket(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, unsigned int timeOutMs)
 {
-    // If the Tx queue is full, wait a bit
-    if (! WaitForHeadAvailable())
+    TVanPacketTxDesc* txDesc = ReserveSlot();
+    if (txDesc == NULL)
     {
         ++nDropped;
         return false;
     } // if
 
-    _head->PreparePacket(iden, cmdFlags, data, dataLen);
-    StartBitSendTimer();
-
-    // Wait here for the packet transmission to be finished
-    if (! WaitForHeadAvailable()) return false;
-
-    // TODO - remove
-    _head->Dump();
+    txDesc->PreparePacket(iden, cmdFlags, data, dataLen);
 
-    AdvanceHead();
+    // If the Tx queue is full, wait a bit
+    if (! WaitToQueue(txDesc, 10)) return false;
 
-    return true;
+    // Wait here for the packet transmission to be finished
+    return WaitForDone(txDesc, timeOutMs);
 } // TVanPacketTxQueue::SyncSendPacket
 
 // Asynchronous packet send: queues the packet to be transmitted then returns.
 // If the TX queue is full, will wait at most 'timeOutMs' milliseconds. When 'timeOutMs' is set to 0, will wait forever.
 bool TVanPacketTxQueue::SendPacket(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, unsigned int timeOutMs)
 {
+    TVanPacketTxDesc* txDesc = ReserveSlot();
+    if (txDesc == NULL)
+    {
+        ++nDropped;
+        return false;
+    } // if
+
+    txDesc->PreparePacket(iden, cmdFlags, data, dataLen);
+
     // If the Tx queue is full, wait a bit
-    if (! WaitForHeadAvailable())
+    return WaitToQueue(txDesc, timeOutMs);
+} // TVanPacketTxQueue::SendPacket
+
+// Non-blocking packet send: queues the packet to be transmitted then returns, without any waiting. Returns false if
+// the Tx queue is full. If a valid pointer is passed to 'ticket', will store a ticket into it that can be used to
+// follow the status of the transmission with 'GetTxStatus(...)'.
+bool TVanPacketTxQueue::SendPacketAsync(
+    uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, TVanTxTicket* ticket)
+{
+    TVanPacketTxDesc* txDesc = ReserveSlot();
+    if (txDesc == NULL)
     {
         ++nDropped;
         return false;
     } // if
 
-    _head->PreparePacket(iden, cmdFlags, data, dataLen);
+    txDesc->PreparePacket(iden, cmdFlags, data, dataLen);
+
+    if (! Queue(txDesc))
+    {
+        txDesc->state = VAN_TX_DONE;
+        ++nDropped;
+        return false;
+    } // if
+
+    if (ticket) *ticket = txDesc->n;
+
     StartBitSendTimer();
 
-    AdvanceHead();
+    return true;
+} // TVanPacketTxQueue::SendPacketAsync
+
+// Non-blocking: queues a received packet, e.g. from another bus, to be transmitted as is. The received bytes are
+// stuffed directly from the Rx queue slot, CRC included, so the packet is not composed again and the CRC is not
+// calculated again. The packet must have been received without error, and with a correct CRC. Returns false if the
+// Tx queue is full. See also 'TVanPacketRxQueue::SetGateway(...)'.
+bool TVanPacketTxQueue::ForwardPacket(const TVanPacketRxDesc& pkt, TVanTxTicket* ticket)
+{
+    // At least SOF, IDEN, COM and CRC
+    if (pkt.size < 5 || pkt.size > VAN_MAX_PACKET_SIZE) return false;
+
+    TVanPacketTxDesc* txDesc = ReserveSlot();
+    if (txDesc == NULL)
+    {
+        ++nDropped;
+        return false;
+    } // if
+
+    txDesc->Init();
+    txDesc->iden = pkt.Iden();
+    txDesc->StuffBytes(pkt.bytes, pkt.size);
+
+    if (! Queue(txDesc))
+    {
+        txDesc->state = VAN_TX_DONE;
+        ++nDropped;
+        return false;
+    } // if
+
+    if (ticket) *ticket = txDesc->n;
+
+    StartBitSendTimer();
 
     return true;
-} // TVanPacketTxQueue::SendPacket
+} // TVanPacketTxQueue::ForwardPacket
+
+// Registers a packet to be queued every 'periodMs' milliseconds, starting right away. If a periodic packet with the
+// same IDEN value was already registered, it is replaced. Pass 'periodMs' 0 to stop. Returns false if
+// VAN_MAX_PERIODIC_PACKETS IDENs are already registered.
+// Note: the packet is queued by the ESP8266 core scheduler, i.e. between two 'loop()' iterations or inside 'delay()'
+// and 'yield()'. A long-running 'loop()' iteration shows up as jitter in 'DumpStats(...)'.
+bool TVanPacketTxQueue::SetPeriodicPacket(
+    uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, unsigned int periodMs)
+{
+    iden &= 0xFFF;
+    TVanPeriodicPacket* p = FindPeriodic(iden);
+
+    if (periodMs == 0)
+    {
+        if (p != NULL) *p = periodic[--nPeriodic];  // Move the last entry into this spot
+        return true;
+    } // if
+
+    if (p == NULL)
+    {
+        if (nPeriodic >= VAN_MAX_PERIODIC_PACKETS) return false;
+        p = periodic + nPeriodic++;
+    } // if
+
+    if (dataLen > VAN_MAX_DATA_BYTES) dataLen = VAN_MAX_DATA_BYTES;
+
+    p->image.PreparePacket(iden, cmdFlags, data, dataLen);
+    TVanPacketTxDesc::ComposeBytes(p->bytes, iden, cmdFlags, data, dataLen);
+    p->dataLen = dataLen;
+    p->periodUs = periodMs * 1000UL;
+    p->dueAt = micros();
+    p->nQueued = 0;
+    p->nSkipped = 0;
+    p->sumJitterUs = 0;
+    p->maxJitterUs = 0;
+
+    if (! periodicScheduled)
+    {
+        schedule_recurrent_function_us([this]() { QueuePeriodicPackets(); return true; }, VAN_TX_PERIODIC_INTERVAL_US);
+        periodicScheduled = true;
+    } // if
+
+    return true;
+} // TVanPacketTxQueue::SetPeriodicPacket
+
+// Changes the data of a periodic packet. Only the data bytes that changed, and then the CRC, are stuffed again.
+// Returns false if no periodic packet is registered with the specified IDEN value.
+bool TVanPacketTxQueue::UpdatePeriodicPacket(uint16_t iden, const uint8_t* data, size_t dataLen)
+{
+    TVanPeriodicPacket* p = FindPeriodic(iden & 0xFFF);
+    if (p == NULL) return false;
+
+    if (dataLen > VAN_MAX_DATA_BYTES) dataLen = VAN_MAX_DATA_BYTES;
+
+    uint16_t* stuffedBytes = p->image.stuffedBytes;
+
+    // Different length: EOD, ACK and EOF move as well, so prepare from scratch
+    if (dataLen != p->dataLen)
+    {
+        uint8_t cmdFlags = p->bytes[2] & 0x07;
+        p->image.PreparePacket(iden, cmdFlags, data, dataLen);
+        TVanPacketTxDesc::ComposeBytes(p->bytes, iden, cmdFlags, data, dataLen);
+        p->dataLen = dataLen;
+        return true;
+    } // if
+
+    bool changed = false;
+    for (size_t i = 0; i < dataLen; i++)
+    {
+        if (p->bytes[3 + i] == data[i]) continue;
+
+        p->bytes[3 + i] = data[i];
+        stuffedBytes[3 + i] = StuffByte(data[i]);
+        changed = true;
+    } // for
+
+    if (! changed) return true;
+
+    uint16_t crc = _crc(p->bytes, dataLen + 5);
+    p->bytes[dataLen + 3] = crc >> 8;
+    p->bytes[dataLen + 4] = crc & 0xFF;
+    stuffedBytes[dataLen + 3] = StuffByte(crc >> 8);
+    stuffedBytes[dataLen + 4] = StuffByte(crc & 0xFF) & 0xFFFC;  // EOD, see 'PreparePacket(...)'
+
+    return true;
+} // TVanPacketTxQueue::UpdatePeriodicPacket
+
+TVanPeriodicPacket* TVanPacketTxQueue::FindPeriodic(uint16_t iden)
+{
+    for (int i = 0; i < nPeriodic; i++) if (periodic[i].image.iden == iden) return periodic + i;
+    return NULL;
+} // TVanPacketTxQueue::FindPeriodic
+
+// Queues the periodic packets that are due. Called by the ESP8266 core scheduler, every VAN_TX_PERIODIC_INTERVAL_US
+// microseconds.
+void TVanPacketTxQueue::QueuePeriodicPackets()
+{
+    uint32_t now = micros();
+    bool queued = false;
+
+    for (int i = 0; i < nPeriodic; i++)
+    {
+        TVanPeriodicPacket* p = periodic + i;
+
+        uint32_t jitter = now - p->dueAt;  // Arithmetic has safe roll-over
+        if (jitter >= 0x80000000UL) continue;  // Not yet due
+
+        // Missed one or more complete periods? Then skip those, and stay in phase with 'now'.
+        if (jitter >= p->periodUs)
+        {
+            p->nSkipped += jitter / p->periodUs;
+            p->dueAt = now + p->periodUs;
+        }
+        else
+        {
+            p->dueAt += p->periodUs;
+        } // if
+
+        TVanPacketTxDesc* txDesc = ReserveSlot();
+        if (txDesc != NULL) txDesc->CopyFrom(p->image);
+
+        if (txDesc == NULL || ! Queue(txDesc))
+        {
+            if (txDesc != NULL) txDesc->state = VAN_TX_DONE;
+            p->nSkipped++;
+            continue;
+        } // if
+
+        p->nQueued++;
+        p->sumJitterUs += jitter;
+        if (jitter > p->maxJitterUs) p->maxJitterUs = jitter;
+        queued = true;
+    } // for
+
+    if (queued) StartBitSendTimer();
+} // TVanPacketTxQueue::QueuePeriodicPackets
+
+// Returns the status of the packet identified by 'ticket'. If a valid pointer is passed to 'result', will also
+// report the details.
+// Note: the status is kept in the packet's descriptor. After at least VAN_TX_QUEUE_SIZE newer packets were queued,
+// the descriptor may have been re-used; then VAN_TX_STATUS_UNKNOWN is returned.
+VanPacketTxStatus_t TVanPacketTxQueue::GetTxStatus(TVanTxTicket ticket, TVanPacketTxResult* result) const
+{
+    const TVanPacketTxDesc* txDesc = FindTicket(ticket);
+
+    ISR_SAFE_BEGIN();
+    VanPacketTxStatus_t status =
+        txDesc == NULL ? VAN_TX_STATUS_UNKNOWN :
+        txDesc->state == VAN_TX_DONE ? (txDesc->replaced ? VAN_TX_STATUS_REPLACED : VAN_TX_STATUS_DONE) :
+        txDesc->state == VAN_TX_SENDING ? VAN_TX_STATUS_SENDING :
+        VAN_TX_STATUS_QUEUED;
+
+    if (result)
+    {
+        result->ticket = ticket;
+        result->status = status;
+    } // if
+
+    if (result && txDesc)
+    {
+        result->nCollisions = txDesc->nCollisions;
+        result->ack = txDesc->ackSeen;
+        result->bitError = txDesc->bitError;
+        result->inFrameResponse = txDesc->inFrameResponse;
+    } // if
+    ISR_SAFE_END();
+
+    return status;
+} // TVanPacketTxQueue::GetTxStatus
+
+// Sets the function to call when a packet has been transmitted. The callback is scheduled from the transmitter ISR,
+// and runs as soon as the current 'loop()' iteration returns. Pass NULL to stop.
+void TVanPacketTxQueue::SetTxCallback(TVanPacketTxCallback callback)
+{
+    ISR_ATOMIC_SET(txCallback, callback);
+
+    // Nothing will be reported any more, so all descriptors can be re-used
+    if (callback == NULL) for (int i = 0; i < VAN_TX_QUEUE_SIZE + 1; i++) pool[i].reportPending = false;
+} // TVanPacketTxQueue::SetTxCallback
+
+// Reports the packets that have been transmitted (or replaced) since the last report, oldest ticket first. A packet
+// that is still queued does not hold up the packets that are done, e.g. a high IDEN value that keeps losing from
+// lower IDEN values with VAN_TX_ORDER_IDEN; it is reported when it is done.
+void TVanPacketTxQueue::DeliverTxCompletions()
+{
+    // Called from within a callback?
+    if (deliveringTxCompletions) return;
+    deliveringTxCompletions = true;
+
+    while (txCallback != NULL)
+    {
+        uint32_t nQueued = GetCount();
+        TVanPacketTxDesc* oldest = NULL;
+
+        ISR_SAFE_BEGIN();
+        for (int i = 0; i < VAN_TX_QUEUE_SIZE + 1; i++)
+        {
+            TVanPacketTxDesc* txDesc = pool + i;
+            if (txDesc->state != VAN_TX_DONE || ! txDesc->reportPending) continue;
+
+            // Arithmetic has safe roll-over
+            if (oldest == NULL || nQueued - txDesc->n > nQueued - oldest->n) oldest = txDesc;
+        } // for
+        ISR_SAFE_END();
+
+        if (oldest == NULL) break;
+
+        TVanPacketTxResult result;
+        GetTxStatus(oldest->n, &result);
+
+        // From here on, the descriptor can be re-used
+        oldest->reportPending = false;
+        txCallback(result);
+    } // while
+
+    deliveringTxCompletions = false;
+} // TVanPacketTxQueue::DeliverTxCompletions
 
 // Dumps packet statistics
 void TVanPacketTxQueue::DumpStats(Stream& s) const
 {
     s.printf_P(
-        PSTR("transmitted pkts: %lu, single collisions: %lu, multiple collisions: %lu, dropped: %lu\n"),
+        PSTR("queued pkts: %lu, transmitted pkts: %lu, single collisions: %lu, multiple collisions: %lu, dropped: %lu"),
         GetCount(),
+        nTransmitted,
         nSingleCollisions,
         nMultipleCollisions,
         nDropped
     );
+
+    if (coalescing) s.printf_P(PSTR(", replaced: %lu"), nReplaced);
+    s.printf_P(PSTR(", wasted timer wakeups: %lu"), nWastedTimerWakeups);
+    if (nInFrameResponses != 0) s.printf_P(PSTR(", in-frame responses: %lu"), nInFrameResponses);
+
+    s.printf_P(PSTR("\n"));
+
+    TVanTxStats stats;
+    GetStats(stats);
+
+    if (stats.bitIsrCycles.Count() != 0)
+    {
+        s.printf_P(PSTR("Tx bit ISR: avg %lu, max %lu CPU cycles ("), stats.avgBitIsrCycles, stats.bitIsrCycles.max);
+        stats.bitIsrCycles.Dump(s);
+        s.printf_P(PSTR(")\n"));
+    } // if
+
+    if (stats.ifsBits.Count() != 0)
+    {
+        s.printf_P(PSTR("Tx bus idle bits before packet: "));
+        stats.ifsBits.Dump(s);
+        s.printf_P(PSTR("\n"));
+    } // if
+
+    for (int i = 0; i < nPeriodic; i++)
+    {
+        const TVanPeriodicPacket* p = periodic + i;
+        s.printf_P(
+            PSTR("periodic 0x%03X every %lu ms: queued: %lu, skipped: %lu, jitter avg: %lu us, max: %lu us\n"),
+            p->image.iden,
+            p->periodUs / 1000,
+            p->nQueued,
+            p->nSkipped,
+            p->nQueued == 0 ? 0 : p->sumJitterUs / p->nQueued,
+            p->maxJitterUs
+        );
+    } // for
 } // TVanPacketTxQueue::DumpStats
 
+// Fills 'stats' with a snapshot of the transmitter statistics
+void TVanPacketTxQueue::GetStats(TVanTxStats& stats) const
+{
+    stats.nTransmitted = nTransmitted;
+    stats.nSingleCollisions = nSingleCollisions;
+    stats.nMultipleCollisions = nMultipleCollisions;
+    stats.nMaxCollisionErrors = nMaxCollisionErrors;
+    stats.nDropped = nDropped;
+    stats.nReplaced = nReplaced;
+    stats.nInFrameResponses = nInFrameResponses;
+    stats.nWastedTimerWakeups = nWastedTimerWakeups;
+
+    // Copy each group of values that belong together with interrupts disabled, but keep each such period short
+    noInterrupts();
+    uint64_t nCalls = nBitIsrCalls;
+    uint64_t nCycles = nBitIsrCycles;
+    interrupts();
+
+    stats.avgBitIsrCycles = nCalls == 0 ? 0 : nCycles / nCalls;
+
+    noInterrupts();
+    stats.bitIsrCycles = bitIsrCycles;
+    interrupts();
+
+    noInterrupts();
+    stats.ifsBits = ifsBits;
+    interrupts();
+} // TVanPacketTxQueue::GetStats
+
+// Restarts the histograms
+void TVanPacketTxQueue::ResetStats()
+{
+    noInterrupts();
+    bitIsrCycles.Clear();
+    interrupts();
+
+    noInterrupts();
+    ifsBits.Clear();
+    interrupts();
+} // TVanPacketTxQueue::ResetStats
+
 TVanPacketTxQueue VanBusTx;
@@ -31,17 +31,50 @@
 
 enum PacketWriteState_t { VAN_TX_WAITING, VAN_TX_SENDING, VAN_TX_DONE };
 
+// Identifies a packet queued with 'SendPacketAsync(...)'
+typedef uint32_t TVanTxTicket;
+
+enum VanPacketTxStatus_t
+{
+    VAN_TX_STATUS_QUEUED,  // Waiting for the bus to become available
+    VAN_TX_STATUS_SENDING,
+    VAN_TX_STATUS_DONE,
+    VAN_TX_STATUS_REPLACED,  // Not sent: replaced by a newer packet with the same IDEN, see 'SetCoalescing(...)'
+    VAN_TX_STATUS_UNKNOWN  // Not (yet) queued, or so long ago that its slot in the Tx queue has been re-used
+}; // enum VanPacketTxStatus_t
+
+// Order in which queued packets are transmitted
+enum VanTxQueueOrder_t
+{
+    VAN_TX_ORDER_FIFO,  // In order of queueing
+    VAN_TX_ORDER_IDEN  // Lowest IDEN value first, like bus arbitration does; in order of queueing for equal IDENs
+}; // enum VanTxQueueOrder_t
+
+struct TVanPacketTxResult
+{
+    TVanTxTicket ticket;
+    VanPacketTxStatus_t status;
+    uint32_t nCollisions;
+    bool ack;  // Acknowledged by at least one receiver; only valid if status is VAN_TX_STATUS_DONE
+    bool bitError;
+    bool inFrameResponse;  // "Read" packet got an in-frame response; the complete frame is in the Rx queue
+}; // struct TVanPacketTxResult
+
+// Transmit completion callback. Is not called from ISR, so it may do anything a normal function can.
+typedef void (*TVanPacketTxCallback)(const TVanPacketTxResult& result);
+
 // VAN packet Tx descriptor
 class TVanPacketTxDesc
 {
   public:
-    TVanPacketTxDesc() { Init(); }
+    TVanPacketTxDesc() : n(UINT32_MAX), state(VAN_TX_DONE) { Init(); }  // 'n': never queued
     void PreparePacket(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen);
-    void Dump() const;
+    void PrepareInFrameResponse(uint16_t iden, const uint8_t* data, size_t dataLen);
 
   private:
 
     uint16_t stuffedBytes[VAN_MAX_PACKET_SIZE + 1];  // 1 extra "byte": 2 ACK bits and 8 EOF bits
+    uint16_t iden;
     uint16_t* p_eod;
     uint16_t* p_last;
     uint32_t n;
@@ -56,85 +89,252 @@ class TVanPacketTxDesc
     bool bitError;
     bool bitOk;
     bool busOccupied;
+    bool ackSeen;
+    bool inFrameResponse;
+    bool replaced;
+    bool reportPending;  // Done, but not yet reported to the Tx callback; the descriptor may not be re-used yet
     uint32_t interFrameCpuCycles;  // Inter-Frame Spacing (IFS) after last received packet, counted in CPU cycles
 
     void Init()
     {
         size = 0;
         eodAt = 0;
-        state = VAN_TX_DONE;
         nCollisions = 0;
         firstCollisionAtBit = 0;
         bitError = false;
         bitOk = false;
         busOccupied = false;
+        ackSeen = false;
+        inFrameResponse = false;
+        replaced = false;
+        reportPending = false;
     } // Init
 
-    friend void FinishPacketTransmission(TVanPacketTxDesc* txDesc);
-    friend void SendBitIsr();
+    // In-frame response only: the stuffed CRC bytes, for the RAK bit cleared and set. The CRC also covers the COM
+    // field, in which the RAK bit is chosen by the requester.
+    uint16_t stuffedCrc[2][2];
+
+    // Fills 'bytes' with the complete packet, SOF up to and including CRC, not yet stuffed
+    static void ComposeBytes(uint8_t* bytes, uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen);
+
+    // Fills 'stuffedBytes' from the complete packet in 'bytes', as composed by 'ComposeBytes(...)' or as received
+    void StuffBytes(const uint8_t* bytes, size_t nBytes);
+
+    // Copies a prepared packet, e.g. the image of a periodic packet, ready to be queued
+    void CopyFrom(const TVanPacketTxDesc& image);
+
+    // Only a "read" packet with the RTR bit set can get an in-frame response
+    bool IsInFrameRequest() const { return (stuffedBytes[2] & 0x0006) == 0x0006; }  // R/W and RTR, stuffed
+
+    friend void FinishPacketTransmission(TVanPacketTxQueue& tx, TVanPacketTxDesc* txDesc);
+    friend void SendBit(TVanPacketTxQueue& tx, uint32_t curr);
+    friend void InFrameResponseIsr(void* context);
+    friend void SendResponseBitIsr();
     friend class TVanPacketTxQueue;
 }; // class TVanPacketTxDesc
 
+// Number of slots in the Tx queue. Must be a power of 2.
+// To override, define as a build flag (e.g. '-DVAN_TX_QUEUE_SIZE=16'), so that it is the same for all compile units:
+// the library sources as well as the sketch. Just placing a '#define' in the sketch is not enough.
+#ifndef VAN_TX_QUEUE_SIZE
+#define VAN_TX_QUEUE_SIZE 8
+#endif // VAN_TX_QUEUE_SIZE
+
+#if VAN_TX_QUEUE_SIZE < 2 || VAN_TX_QUEUE_SIZE > 128 || (VAN_TX_QUEUE_SIZE & (VAN_TX_QUEUE_SIZE - 1)) != 0
+#error "VAN_TX_QUEUE_SIZE must be a power of 2, at most 128"
+#endif
+
+#define VAN_TX_QUEUE_MASK (VAN_TX_QUEUE_SIZE - 1)
+
+// Maximum number of periodic packets, see 'TVanPacketTxQueue::SetPeriodicPacket(...)'
+#ifndef VAN_MAX_PERIODIC_PACKETS
+#define VAN_MAX_PERIODIC_PACKETS 4
+#endif // VAN_MAX_PERIODIC_PACKETS
+
+// Interval at which the ESP8266 core scheduler checks if a periodic packet is due, in microseconds
+#ifndef VAN_TX_PERIODIC_INTERVAL_US
+#define VAN_TX_PERIODIC_INTERVAL_US 1000
+#endif // VAN_TX_PERIODIC_INTERVAL_US
+
+// A packet that is queued for transmission every period
+struct TVanPeriodicPacket
+{
+    TVanPacketTxDesc image;  // Prepared once; copied into the Tx queue every period
+    uint8_t bytes[VAN_MAX_PACKET_SIZE];  // Not stuffed; to find the data bytes that changed
+    size_t dataLen;
+    uint32_t periodUs;
+    uint32_t dueAt;  // Value of 'micros()'
+
+    // Some statistics. Numbers can roll over. Jitter is the time between being due and being queued.
+    uint32_t nQueued;
+    uint32_t nSkipped;  // Tx queue was full, or a complete period was missed
+    uint32_t sumJitterUs;
+    uint32_t maxJitterUs;
+}; // struct TVanPeriodicPacket
+
+// Snapshot of the transmitter statistics, as filled by 'TVanPacketTxQueue::GetStats(...)'. Numbers can roll over.
+struct TVanTxStats
+{
+    uint32_t nTransmitted;
+    uint32_t nSingleCollisions;
+    uint32_t nMultipleCollisions;
+    uint32_t nMaxCollisionErrors;
+    uint32_t nDropped;
+    uint32_t nReplaced;  // Only if coalescing is enabled
+    uint32_t nInFrameResponses;  // Sent by us, as responder
+    uint32_t nWastedTimerWakeups;
+
+    // Execution time of 'SendBitIsr', in CPU cycles
+    uint32_t avgBitIsrCycles;
+    TVanHistogram bitIsrCycles;
+
+    // Bus idle time (EOF + IFS) before each transmitted packet, in bit times
+    TVanHistogram ifsBits;
+}; // struct TVanTxStats
+
 // Circular buffer of VAN packet Tx descriptors
 class TVanPacketTxQueue
 {
   public:
 
-    #define VAN_TX_QUEUE_SIZE 5
-
-    // Constructor
-    TVanPacketTxQueue()
+    // Constructor. Each bus has its own transmitter, that shares the pin level sensing of the receiver on that bus.
+    TVanPacketTxQueue(TVanPacketRxQueue& theRxQueue = VanBusRx)
         : txPin(VAN_NO_PIN_ASSIGNED)
-        , _head(pool)
-        , _tail(pool)
-        , end(pool + VAN_TX_QUEUE_SIZE)
+        , rxQueue(&theRxQueue)
+        , _tailIdx(0)
+        , _nQueued(0)
+        , queueOrder(VAN_TX_ORDER_FIFO)
+        , coalescing(false)
         , count(0)
+        , nTransmitted(0)
         , nDropped(0)
+        , nReplaced(0)
         , nSingleCollisions(0)
         , nMultipleCollisions(0)
         , nMaxCollisionErrors(0)
+        , nInFrameResponses(0)
+        , nWastedTimerWakeups(0)
+        , nBitIsrCalls(0)
+        , nBitIsrCycles(0)
+        , bitIsrCycles(CPU_F_FACTOR == 1 ? 5 : 6)  // Buckets of 0.4 usec
+        , ifsBits(1)
+        , txCallback(NULL)
+        , deliveringTxCompletions(false)
+        , loopback(false)
+        , nPeriodic(0)
+        , periodicScheduled(false)
     { }
 
-    void Setup(uint8_t theRxPin, uint8_t theTxPin);
+    bool Setup(uint8_t theRxPin, uint8_t theTxPin);
     bool SyncSendPacket(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, unsigned int timeOutMs = 10);
     bool SendPacket(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, unsigned int timeOutMs = 10);
-    uint32_t GetCount() const { ISR_SAFE_GET(uint32_t, count); }
+
+    // Non-blocking: never waits. Returns false if the Tx queue is full.
+    bool SendPacketAsync(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, TVanTxTicket* ticket = NULL);
+
+    // Non-blocking: queues a received packet as is, CRC included, e.g. to forward it to another bus
+    bool ForwardPacket(const TVanPacketRxDesc& pkt, TVanTxTicket* ticket = NULL);
+    VanPacketTxStatus_t GetTxStatus(TVanTxTicket ticket, TVanPacketTxResult* result = NULL) const;
+    void SetTxCallback(TVanPacketTxCallback callback);
+
+    // Transmit order, and coalescing: a newly queued packet replaces a queued packet with the same IDEN that is not
+    // yet being sent, so that only the latest data is transmitted
+    void SetQueueOrder(VanTxQueueOrder_t order) { queueOrder = order; }
+    void SetCoalescing(bool enable) { coalescing = enable; }
+
+    // Periodic transmission: the packet is queued every 'periodMs' milliseconds, without the application having to
+    // call 'SendPacket(...)'. Set 'periodMs' to 0 to stop. 'UpdatePeriodicPacket(...)' changes the data.
+    bool SetPeriodicPacket(uint16_t iden, uint8_t cmdFlags, const uint8_t* data, size_t dataLen, unsigned int periodMs);
+    bool UpdatePeriodicPacket(uint16_t iden, const uint8_t* data, size_t dataLen);
+
+    // Loopback: keep on receiving while transmitting, so that the own packets, and any packet that wins arbitration,
+    // are received as well
+    void SetLoopback(bool enable) { loopback = enable; }
+    uint32_t GetCount() const { ISR_ATOMIC_GET(uint32_t, count); }
     void DumpStats(Stream& s) const;
 
+    // Statistics as a struct, e.g. to pass on to a monitoring system. 'ResetStats()' restarts the histograms.
+    void GetStats(TVanTxStats& stats) const;
+    void ResetStats();
+
   private:
 
     uint8_t txPin;
-    TVanPacketTxDesc pool[VAN_TX_QUEUE_SIZE];
-    TVanPacketTxDesc* volatile _head;
-    TVanPacketTxDesc* volatile _tail;
-    TVanPacketTxDesc* end;
+    TVanPacketRxQueue* rxQueue;  // The receiver on the same bus
+
+    // One spare descriptor, so that a packet can be prepared while the queue is full
+    TVanPacketTxDesc pool[VAN_TX_QUEUE_SIZE + 1];
+
+    // The queue: a circular buffer of indices into 'pool', in order of transmission. Reordering and replacing
+    // packets is then just moving bytes around.
+    uint8_t order[VAN_TX_QUEUE_SIZE];
+    volatile uint8_t _tailIdx;  // Index into 'order'
+    volatile uint8_t _nQueued;
+
+    volatile VanTxQueueOrder_t queueOrder;
+    volatile bool coalescing;
 
     // Some statistics. Numbers can roll over.
-    uint32_t count;
+    uint32_t count;  // Queued
+    uint32_t nTransmitted;  // Finished transmission; lags behind 'count' by the packets still in the Tx queue
     uint32_t nDropped;
+    uint32_t nReplaced;
     uint32_t nSingleCollisions;
     uint32_t nMultipleCollisions;
     uint32_t nMaxCollisionErrors;
+    uint32_t nInFrameResponses;  // Sent by us, as responder
+    uint32_t nWastedTimerWakeups;  // 'SendBitIsr' called, but the bus was not yet free
+
+    // CPU cycles spent inside 'SendBitIsr'. 64 bits wide, since that ISR is called about 122,000 times per second.
+    uint64_t nBitIsrCalls;
+    uint64_t nBitIsrCycles;
+    TVanHistogram bitIsrCycles;
+
+    TVanHistogram ifsBits;  // See 'TVanTxStats'
+
+    // Transmit completion reporting
+    TVanPacketTxCallback txCallback;
+    bool deliveringTxCompletions;
+
+    volatile bool loopback;
+
+    TVanPeriodicPacket periodic[VAN_MAX_PERIODIC_PACKETS];
+    int nPeriodic;
+    bool periodicScheduled;
+
+    TVanPeriodicPacket* FindPeriodic(uint16_t iden);
+    void QueuePeriodicPackets();
 
-    bool SlotAvailable() const { ISR_SAFE_GET(bool, _head->state == VAN_TX_DONE); }
-    static void StartBitSendTimer();
-    bool WaitForHeadAvailable(unsigned int timeOutMs = 10);
+    void DeliverTxCompletions();
+
+    TVanPacketTxDesc* ReserveSlot();
+    TVanPacketTxDesc* TryReserveSlot();
+    const TVanPacketTxDesc* FindTicket(TVanTxTicket ticket) const;
+    bool Queue(TVanPacketTxDesc* txDesc);
+    bool WaitToQueue(TVanPacketTxDesc* txDesc, unsigned int timeOutMs);
+    bool WaitForDone(const TVanPacketTxDesc* txDesc, unsigned int timeOutMs);
+    void StartBitSendTimer();
+
+    // Only to be called from ISR, or with interrupts disabled
+    void ICACHE_RAM_ATTR _ArmStartTimer(uint32_t curr, uint32_t nIdleCycles);
+
+    // Only to be called from ISR, unsafe otherwise
+    TVanPacketTxDesc* ICACHE_RAM_ATTR _Tail() { return pool + order[_tailIdx]; }
 
     // Only to be called from ISR, unsafe otherwise
     void ICACHE_RAM_ATTR _AdvanceTail()
     {
-        _tail->state = VAN_TX_DONE;
-        if (++_tail == end) _tail = pool;  // roll over if needed
+        _Tail()->state = VAN_TX_DONE;
+        _tailIdx = (_tailIdx + 1) & VAN_TX_QUEUE_MASK;  // roll over if needed
+        _nQueued--;
     } // _AdvanceTail
 
-    void AdvanceHead()
-    {
-        if (++_head == end) _head = pool;  // roll over if needed
-        count++;
-    } // AdvanceHead
-
-    friend void FinishPacketTransmission(TVanPacketTxDesc* txDesc);
-    friend void SendBitIsr();
+    friend void FinishPacketTransmission(TVanPacketTxQueue& tx, TVanPacketTxDesc* txDesc);
+    friend void SendBit(TVanPacketTxQueue& tx, uint32_t curr);
+    friend void CountBitIsrCycles(TVanPacketTxQueue& tx, uint32_t curr);
+    friend void InFrameResponseIsr(void* context);
+    friend void SendResponseBitIsr();
+    friend void DeliverTxCompletionsScheduled();
     friend class TVanPacketTxDesc;
 }; // class TVanPacketTxQueue
 
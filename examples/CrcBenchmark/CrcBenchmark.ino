@@ -0,0 +1,124 @@
+/*
+ * VanBus: CrcBenchmark - measure the CPU time of the CRC calculation, on the target.
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ *
+ * -----
+ * Usage
+ *
+ * No VAN bus is needed: the sketch composes a few packets of different sizes and times 'TVanPacketRxDesc::CheckCrc()'
+ * and '_crc(...)' on them, using the CPU cycle counter ('ESP.getCycleCount()'). Run it once with "CPU Frequency" set
+ * to 80 MHz, and once with 160 MHz (Arduino IDE: Tools menu), to compare.
+ *
+ * -----
+ * Output
+ *
+ * A header, followed by one line per packet size:
+ *
+ * CPU frequency: 80 MHz
+ * 'CheckCrc()' and '_crc(...)', in CPU cycles per packet (best of 1000):
+ * packet size  5 bytes: CheckCrc() <cycles>, _crc(...) <cycles>
+ * packet size 16 bytes: CheckCrc() <cycles>, _crc(...) <cycles>
+ * packet size 33 bytes: CheckCrc() <cycles>, _crc(...) <cycles>
+ *
+ * The time to load the packet into the Rx descriptor (which is needed to make 'CheckCrc()' calculate the CRC again
+ * for each run) is measured separately and subtracted.
+ */
+
+#include <VanBusRx.h>
+
+#define N_RUNS 1000
+
+// Data bytes for the test packets: those of a "4D4" (audio settings) packet, padded with random bytes up to the
+// maximum packet size
+const uint8_t data[VAN_MAX_DATA_BYTES] =
+{
+    0x82, 0x0C, 0x01, 0x00, 0x11, 0x00, 0x3F, 0x3F, 0x3F, 0x3F, 0x82, 0x5A, 0xC3, 0x19,
+    0x7E, 0x21, 0xB0, 0x44, 0xE7, 0x08, 0x93, 0xD5, 0x6C, 0x2F, 0xA1, 0x0B, 0x78, 0xF4
+};
+
+const int dataLens[] = { 0, 11, VAN_MAX_DATA_BYTES };
+
+// Composes a packet with IDEN 0x4D4 and 'dataLen' data bytes, including a correct CRC
+void ComposePacket(TVanPacketRecord& record, int dataLen)
+{
+    int size = dataLen + 5;  // SOF, IDEN, COM and CRC
+
+    record.timestamp = 0;
+    record.seqNo = 0;
+    record.size = size;
+    record.flags = VAN_RX_PACKET_OK;
+
+    record.bytes[0] = 0x0E;  // SOF
+    record.bytes[1] = 0x4D;  // IDEN
+    record.bytes[2] = 0x40 | 0x08;  // IDEN, COM
+    memcpy(record.bytes + 3, data, dataLen);
+
+    uint16_t crc = _crc(record.bytes, size);
+    record.bytes[size - 2] = crc >> 8;
+    record.bytes[size - 1] = crc & 0xFF;
+} // ComposePacket
+
+volatile bool crcOk;
+volatile uint16_t crcValue;
+
+void BenchmarkPacket(int dataLen)
+{
+    TVanPacketRecord record;
+    ComposePacket(record, dataLen);
+
+    TVanPacketRxDesc pkt;
+    uint32_t minLoad = UINT32_MAX;
+    uint32_t minLoadAndCheck = UINT32_MAX;
+    uint32_t minCrc = UINT32_MAX;
+
+    // Take the best of many runs, to leave out the runs that were interrupted
+    for (int i = 0; i < N_RUNS; i++)
+    {
+        uint32_t start = ESP.getCycleCount();
+        pkt.Load(record);
+        uint32_t cycles = ESP.getCycleCount() - start;  // Arithmetic has safe roll-over
+        if (cycles < minLoad) minLoad = cycles;
+
+        start = ESP.getCycleCount();
+        pkt.Load(record);
+        crcOk = pkt.CheckCrc();
+        cycles = ESP.getCycleCount() - start;
+        if (cycles < minLoadAndCheck) minLoadAndCheck = cycles;
+
+        start = ESP.getCycleCount();
+        crcValue = _crc(record.bytes, record.size);
+        cycles = ESP.getCycleCount() - start;
+        if (cycles < minCrc) minCrc = cycles;
+
+        yield();
+    } // for
+
+    Serial.printf_P(
+        PSTR("packet size %2u bytes: CheckCrc() %4lu, _crc(...) %4lu%s\n"),
+        record.size,
+        minLoadAndCheck - minLoad,
+        minCrc,
+        crcOk ? "" : " (CRC ERROR!)"
+    );
+} // BenchmarkPacket
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(115200);
+    Serial.println();
+
+    Serial.printf_P(PSTR("CPU frequency: %u MHz\n"), ESP.getCpuFreqMHz());
+    Serial.printf_P(PSTR("'CheckCrc()' and '_crc(...)', in CPU cycles per packet (best of %d):\n"), N_RUNS);
+
+    for (size_t i = 0; i < sizeof(dataLens) / sizeof(dataLens[0]); i++) BenchmarkPacket(dataLens[i]);
+} // setup
+
+void loop()
+{
+} // loop
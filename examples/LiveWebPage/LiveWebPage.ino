@@ -45,6 +45,9 @@
 #include <ESP8266WebServer.h>
 #include <WebSocketsServer.h>
 #include <VanBusRx.h>
+#include <VanBusDispatcher.h>
+#include <VanBusJson.h>
+#include <VanBusSpool.h>
 
 #if defined ARDUINO_ESP8266_GENERIC || defined ARDUINO_ESP8266_ESP01
 // For ESP-01 board we use GPIO 2 (internal pull-up, keep disconnected or high at boot time)
@@ -56,6 +59,103 @@ int RX_PIN = D2; // Set to GPIO pin connected to VAN bus transceiver output
 ESP8266WebServer webServer;
 WebSocketsServer webSocket = WebSocketsServer(81);
 
+// Received packets are drained from the Rx queue into a larger spool, also while the web server is busy sending the
+// web page or while a websocket client is slow. Then, 'loop()' takes them out at its own pace.
+TVanPacketSpool<64> spool;
+
+// Maximum number of packets handled in one 'loop()' while the spool is congested
+#define SPOOL_BURST 8
+
+// Interval at which the statistics of each stage are printed
+#define STATS_INTERVAL_MS 60000
+
+// JSON updates are collected into a batch: a JSON array, sent as one websocket frame at most every
+// WEBSOCKET_BATCH_INTERVAL_MS milliseconds, in stead of one frame per packet. Set to 0 to send every update directly.
+#define WEBSOCKET_BATCH_INTERVAL_MS 100
+#define WEBSOCKET_BATCH_SIZE 4096
+
+char webSocketBatch[WEBSOCKET_BATCH_SIZE];
+size_t webSocketBatchLen = 0;
+int webSocketBatchCount = 0;  // Number of JSON updates in the batch
+unsigned long webSocketBatchStart = 0;  // Value of 'millis()' when the first JSON update was added to the batch
+
+// Websocket statistics
+uint32_t nWebSocketFrames = 0;
+uint32_t nWebSocketUpdates = 0;
+uint32_t nWebSocketBytes = 0;
+unsigned long maxBroadcastMs = 0;
+
+void BroadcastJson(const char* json, size_t len, int count)
+{
+    unsigned long start = millis();
+    webSocket.broadcastTXT(json, len);
+    unsigned long duration = millis() - start;
+
+    nWebSocketFrames++;
+    nWebSocketUpdates += count;
+    nWebSocketBytes += len;
+    if (duration > maxBroadcastMs) maxBroadcastMs = duration;
+
+    Serial.printf_P(
+        PSTR("Sending %zu JSON bytes (%d updates) via 'webSocket.broadcastTXT' took: %lu msec\n"),
+        len,
+        count,
+        duration);
+} // BroadcastJson
+
+void PrintStats()
+{
+    VanBusRx.DumpStats(Serial);
+    spool.DumpStats(Serial);
+    Serial.printf_P(
+        PSTR("websocket frames: %lu, updates: %lu, bytes: %lu, slowest broadcast: %lu msec\n"),
+        nWebSocketFrames,
+        nWebSocketUpdates,
+        nWebSocketBytes,
+        maxBroadcastMs);
+} // PrintStats
+
+void FlushWebSocketBatch()
+{
+    if (webSocketBatchCount == 0) return;
+
+    // There is always room for the closing bracket; see 'AddToWebSocketBatch(...)'
+    webSocketBatch[webSocketBatchLen++] = ']';
+    BroadcastJson(webSocketBatch, webSocketBatchLen, webSocketBatchCount);
+
+    webSocketBatchLen = 0;
+    webSocketBatchCount = 0;
+} // FlushWebSocketBatch
+
+void AddToWebSocketBatch(const char* json, size_t len)
+{
+    // Keep room for the separating comma (or opening bracket) and the closing bracket
+    if (webSocketBatchLen + 1 + len + 1 > WEBSOCKET_BATCH_SIZE) FlushWebSocketBatch();
+
+    // Too large for a batch, or no batching?
+    if (1 + len + 1 > WEBSOCKET_BATCH_SIZE || WEBSOCKET_BATCH_INTERVAL_MS == 0)
+    {
+        BroadcastJson(json, len, 1);
+        return;
+    } // if
+
+    if (webSocketBatchCount == 0) webSocketBatchStart = millis();
+
+    webSocketBatch[webSocketBatchLen++] = webSocketBatchCount == 0 ? '[' : ',';
+    memcpy(webSocketBatch + webSocketBatchLen, json, len);
+    webSocketBatchLen += len;
+    webSocketBatchCount++;
+} // AddToWebSocketBatch
+
+// Defined in PacketToJson.ino
+void RequestFullJsonUpdates();
+
+void WebSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length)
+{
+    // A new browser needs all fields, not only the ones that change
+    if (type == WStype_CONNECTED) RequestFullJsonUpdates();
+} // WebSocketEvent
+
 char webpage[] PROGMEM = R"=====(
 <!DOCTYPE html>
 <html lang='en'>
@@ -80,7 +180,16 @@ char webpage[] PROGMEM = R"=====(
           conn.onmessage = function(evt)
           {
               var json = JSON.parse(evt.data)
-              dispatch(json.event, json.data)
+
+              // Multiple updates can be batched into an array
+              if (Array.isArray(json))
+              {
+                  for (var i = 0; i < json.length; i++) dispatch(json[i].event, json[i].data)
+              }
+              else
+              {
+                  dispatch(json.event, json.data)
+              } // if
           };
 
           conn.onclose = function(){dispatch('close',null)}
@@ -719,6 +828,9 @@ char webpage[] PROGMEM = R"=====(
 // Defined in Wifi.ino
 void setupWifi();
 
+// Defined in PacketToJson.ino
+void SetupVanPacketHandlers();
+
 void setup()
 {
     delay(1000);
@@ -734,11 +846,15 @@ void setup()
     });
     webServer.begin();
     webSocket.begin();
+    webSocket.onEvent(WebSocketEvent);
 
     Serial.print(F("Please surf to: http://"));
     Serial.println(WiFi.localIP());
 
     VanBusRx.Setup(RX_PIN);
+    SetupVanPacketHandlers();
+
+    if (! spool.Start()) Serial.print(F("Failed to start the packet spool; draining only from loop()\n"));
 } // setup
 
 // Defined in PacketToJson.ino
@@ -747,26 +863,50 @@ const char* ParseVanPacketToJson(TVanPacketRxDesc& pkt);
 void loop()
 {
     webSocket.loop();
-    webServer.handleClient();
 
-    TVanPacketRxDesc pkt;
-    bool isQueueOverrun = false;
+    // Backpressure: while the spool is congested, catch up on the received packets first, and leave web page requests
+    // waiting
+    bool isCongested = spool.IsCongested();
+    if (! isCongested) webServer.handleClient();
 
-    if (VanBusRx.Receive(pkt, &isQueueOverrun))
+    // Also drained by the scheduler, but that may not have run since the last 'loop()'
+    spool.Fill();
+
+    TVanPacketRxDesc pkt;
+    int n = isCongested ? SPOOL_BURST : 1;
+    while (n-- > 0 && spool.Receive(pkt))
     {
         const char* json = ParseVanPacketToJson(pkt);
-        if (strlen(json) > 0)
-        {
-            unsigned long start = millis();
-            webSocket.broadcastTXT(json);
-            Serial.printf_P(
-                PSTR("Sending %zu JSON bytes via 'webSocket.broadcastTXT' took: %lu msec\n"),
-                strlen(json),
-                millis() - start);
-        } // if
+
+        size_t jsonLen = strlen(json);
+        if (jsonLen > 0) AddToWebSocketBatch(json, jsonLen);
+    } // while
+
+    // Arithmetic has safe roll-over
+    if (webSocketBatchCount > 0 && millis() - webSocketBatchStart >= WEBSOCKET_BATCH_INTERVAL_MS)
+    {
+        FlushWebSocketBatch();
     } // if
 
-    if (isQueueOverrun) Serial.print(F("QUEUE OVERRUN!\n"));
+    // Packets can also be dropped while broadcasting, when the scheduler fills the spool
+    static uint32_t nReportedDropped = 0;
+    static uint32_t nReportedRxOverruns = 0;
+    if (nReportedDropped != spool.GetDropCount() || nReportedRxOverruns != spool.GetRxOverrunCount())
+    {
+        Serial.printf_P(
+            PSTR("QUEUE OVERRUN! Spool dropped %lu packets; Rx queue overrun %lu times\n"),
+            spool.GetDropCount() - nReportedDropped,
+            spool.GetRxOverrunCount() - nReportedRxOverruns);
+        nReportedDropped = spool.GetDropCount();
+        nReportedRxOverruns = spool.GetRxOverrunCount();
+    } // if
+
+    static unsigned long lastStatsAt = 0;
+    if (millis() - lastStatsAt >= STATS_INTERVAL_MS)
+    {
+        lastStatsAt = millis();
+        PrintStats();
+    } // if
 
     delay(1); // Give some time to system to process other things?
 } // loop
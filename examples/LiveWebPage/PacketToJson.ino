@@ -17,6 +17,26 @@
 #define JSON_BUFFER_SIZE 4096
 char jsonBuffer[JSON_BUFFER_SIZE];
 
+// Uncomment to send, for packets with a parser that supports it, only the JSON fields whose source bytes changed. By
+// default, the full JSON object for a packet type is sent whenever any of its bytes changes.
+//#define JSON_DELTA_UPDATES
+
+// With JSON_DELTA_UPDATES: interval at which the full JSON object for a packet type is sent anyway, even if nothing
+// changed, so that e.g. a newly connected browser gets all fields. 0 = never.
+#define JSON_FULL_SNAPSHOT_INTERVAL_MS 10000
+
+// Data bytes of the packet being parsed, that differ from the previous packet with the same IDEN: bit 'i' is set if
+// data byte 'i' has changed. All bits are set if the full JSON object must be sent.
+uint32_t changedBytes = 0xFFFFFFFF;
+#define DATA_BYTE(i) (1UL << (i))
+#define DATA_BYTES(from, to) ((DATA_BYTE((to) + 1) - 1) & ~(DATA_BYTE(from) - 1))
+
+// Returns true if any of the data bytes in 'mask' (use 'DATA_BYTE(...)' or 'DATA_BYTES(...)') has changed
+inline bool IsChanged(uint32_t mask)
+{
+    return (changedBytes & mask) != 0;
+} // IsChanged
+
 enum VanPacketParseResult_t
 {
     VAN_PACKET_NO_CONTENT  = 2, // Packet is OK but contains no useful content
@@ -38,6 +58,8 @@ struct IdenHandler_t
     int dataLen;
     TPacketParser parser;
     uint8_t* prevData;
+    unsigned long lastFullUpdate;  // Value of 'millis()' when the full JSON object was last sent
+    bool fullUpdateRequested;  // Send the full JSON object for the next packet
 }; // struct IdenHandler_t
 
 // Often used string constants
@@ -376,6 +398,79 @@ const char* SatNavRequestStr(uint8_t data)
         ToHexStr(data);
 } // SatNavRequestStr
 
+// Length of the JSON text when the "data" object was opened
+static int displayEventDataAt;
+
+// Starts the JSON object for a "display" event. The parser then adds the members of its "data" object.
+void BeginDisplayEvent(TVanJsonWriter& json)
+{
+    json.BeginObject();
+    json.AddStrP(PSTR("event"), PSTR("display"));
+    json.BeginObject(PSTR("data"));
+    displayEventDataAt = json.Length();
+} // BeginDisplayEvent
+
+// Ends the JSON object started with 'BeginDisplayEvent(...)'
+VanPacketParseResult_t EndDisplayEvent(TVanJsonWriter& json)
+{
+    // With JSON_DELTA_UPDATES, only bytes may have changed that are not used for any field
+    if (json.Length() == displayEventDataAt) return VAN_PACKET_NO_CONTENT;
+
+    json.EndObject();
+    json.EndObject();
+
+    // JSON buffer overflow?
+    if (json.IsOverflow()) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+
+    return VAN_PACKET_PARSE_OK;
+} // EndDisplayEvent
+
+// Adds a member that sets the horizontal scale of a bar, e.g.:
+//   "water_temp_perc": { "style": { "transform": "scaleX(0.65)" } }
+// 'hundredths' is the scale, in units of 0.01 .
+void AddScaleX(TVanJsonWriter& json, const char* key, long hundredths)
+{
+    json.BeginObject(key);
+    json.BeginObject(PSTR("style"));
+    json.BeginValue(PSTR("transform")).StrP(PSTR("scaleX(")).Fixed(hundredths, 2).Char(')').EndValue();
+    json.EndObject();
+    json.EndObject();
+} // AddScaleX
+
+// Returns 'num / den', rounded to the nearest integer (halves away from zero)
+inline long RoundedDiv(long num, long den)
+{
+    return (num + (num < 0 ? - den / 2 : den / 2)) / den;
+} // RoundedDiv
+
+// Adds a member with a signed integer value that always has a sign, like printf format "%+d"
+void AddSignedInt(TVanJsonWriter& json, const char* key, int value)
+{
+    json.BeginValue(key).Char(value < 0 ? '-' : '+').UInt(value < 0 ? - value : value).EndValue();
+} // AddSignedInt
+
+// Adds a member that sets the rotation of an element, e.g.:
+//   "satnav_curr_heading": { "style": { "transform": "rotate(270deg)" } }
+void AddRotate(TVanJsonWriter& json, const char* key, long degrees, int decimals = 0)
+{
+    json.BeginObject(key);
+    json.BeginObject(PSTR("style"));
+    json.BeginValue(PSTR("transform")).StrP(PSTR("rotate(")).Fixed(degrees, decimals).StrP(PSTR("deg)")).EndValue();
+    json.EndObject();
+    json.EndObject();
+} // AddRotate
+
+// Adds a member that shows or hides an element, e.g.:
+//   "satnav_not_on_map_icon": { "style": { "display": "none" } }
+void AddStyleDisplay(TVanJsonWriter& json, const char* key, bool visible)
+{
+    json.BeginObject(key);
+    json.BeginObject(PSTR("style"));
+    json.AddStrP(PSTR("display"), visible ? styleDisplayBlockStr : styleDisplayNoneStr);
+    json.EndObject();
+    json.EndObject();
+} // AddStyleDisplay
+
 // Convert SatNav guidance instruction icon details to JSON
 //
 // A detailed SatNav guidance instruction consists of 8 bytes:
@@ -391,21 +486,19 @@ const char* SatNavRequestStr(uint8_t data)
 // * 6   : always 0x00 ??
 // * 7   : always 0x00 ??
 //
-void GuidanceInstructionIconJson(const char* iconName, const uint8_t data[8], char* buf, int& at, int n)
+void GuidanceInstructionIconJson(TVanJsonWriter& json, const char* iconName, const uint8_t data[8])
 {
+    // Note: on the ESP8266, a function that reads a PROGMEM string can also read a string in RAM, like 'key'
+    char key[40];
+
     // Show all the legs in the junction
 
     uint16_t legBits = (uint16_t)data[2] << 8 | data[3];
     for (int legBit = 1; legBit < 16; legBit++)
     {
         uint16_t degrees10 = legBit * 225;
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"%S_leg_%u_%u\": \"%S\""),
-                iconName,
-                degrees10 / 10,
-                degrees10 % 10,
-                legBits & 1 >> legBit ? onStr : offStr
-            );
+        sprintf_P(key, PSTR("%S_leg_%u_%u"), iconName, degrees10 / 10, degrees10 % 10);
+        json.AddStrP(key, legBits & 1 >> legBit ? onStr : offStr);
     } // for
 
     // Show all the "no-entry" legs in the junction
@@ -414,99 +507,52 @@ void GuidanceInstructionIconJson(const char* iconName, const uint8_t data[8], ch
     for (int noEntryBit = 1; noEntryBit < 16; noEntryBit++)
     {
         uint16_t degrees10 = noEntryBit * 225;
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"%S_no_entry_%u_%u\": \"%S\""),
-                iconName,
-                degrees10 / 10,
-                degrees10 % 10,
-                noEntryBits & 1 >> noEntryBit ? onStr : offStr
-            );
+        sprintf_P(key, PSTR("%S_no_entry_%u_%u"), iconName, degrees10 / 10, degrees10 % 10);
+        json.AddStrP(key, noEntryBits & 1 >> noEntryBit ? onStr : offStr);
     } // for
 
     // Show the direction to go
 
     uint16_t direction = data[0] * 225;
 
-    const static char jsonFormatter[] PROGMEM =
-        ",\n"
-        "\"%S_direction_as_text\": \"%u.%u deg\",\n"
-        "\"%S_direction\":\n"
-        "{\n"
-            "\"style\":\n"
-            "{\n"
-                "\"transform\": \"rotate(%u.%udeg)\"\n"
-            "}\n"
-        "}";
-
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, jsonFormatter,
-            iconName,
-            direction / 10,
-            direction % 10,
-            iconName,
-            direction / 10,
-            direction % 10
-        );
-} // GuidanceInstructionIconJson
-
-#if 0
-
-#include <PrintEx.h>
-
-const char* PacketRawToStr(TVanPacketRxDesc& pkt)
-{
-    static char dumpBuffer[MAX_DUMP_RAW_SIZE];
-
-    // Dump to a string-stream
-    GString str(dumpBuffer);
-    PrintAdapter streamer(str);
-    pkt.DumpRaw(streamer, '\0');
+    sprintf_P(key, PSTR("%S_direction_as_text"), iconName);
+    json.BeginValue(key).Fixed(direction, 1).StrP(PSTR(" deg")).EndValue();
 
-    return dumpBuffer;
-} // PacketRawToStr
+    sprintf_P(key, PSTR("%S_direction"), iconName);
+    AddRotate(json, key, direction, 1);
+} // GuidanceInstructionIconJson
 
 // Dump the raw packet data into a JSON object
 VanPacketParseResult_t DefaultPacketParser(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
 {
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"%s\": \"%s\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter, idenStr, PacketRawToStr(pkt));
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    char raw[VAN_MAX_DUMP_RAW_SIZE];
+    pkt.FormatRaw(raw, sizeof(raw), '\0');
+
+    // Note: on the ESP8266, a function that reads a PROGMEM string can also read a string in RAM, like 'idenStr'
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+    json.AddStr(idenStr, raw);
+    return EndDisplayEvent(json);
 } // DefaultPacketParser
 
-#endif
-
 VanPacketParseResult_t ParseVinPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
 {
     // http://graham.auld.me.uk/projects/vanbus/packets.html#E24
     // http://pinterpeti.hu/psavanbus/PSA-VAN.html#E24
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"vin\": \"%-17.17s\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter, pkt.Data());
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    const uint8_t* data = pkt.Data();
 
-    return VAN_PACKET_PARSE_OK;
+    // Same as printf format "%-17.17s"
+    char vin[18];
+    int i = 0;
+    for (; i < 17 && data[i] != '\0'; i++) vin[i] = data[i];
+    for (; i < 17; i++) vin[i] = ' ';
+    vin[17] = '\0';
+
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+    json.AddStr(PSTR("vin"), vin);
+    return EndDisplayEvent(json);
 } // ParseVinPkt
 
 VanPacketParseResult_t ParseEnginePkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -517,64 +563,57 @@ VanPacketParseResult_t ParseEnginePkt(const char* idenStr, TVanPacketRxDesc& pkt
     const uint8_t* data = pkt.Data();
     sint16_t waterTemp = (uint16_t)data[2] - 39;  // TODO - or: data[2] / 2
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"dash_light\": \"%S\",\n"
-            "\"dash_actual_brightness\": \"%u\",\n"
-            "\"contact_key_position\": \"%S\",\n"
-            "\"engine_running\": \"%S\",\n"
-            "\"economy_mode\": \"%S\",\n"
-            "\"in_reverse\": \"%S\",\n"
-            "\"trailer\": \"%S\",\n"
-            "\"water_temp\": \"%S\",\n"
-            "\"water_temp_perc\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"transform\": \"scaleX(%S)\"\n"
-                "}\n"
-            "},\n"
-            "\"odometer_1\": \"%s\",\n"
-            "\"exterior_temperature\": \"%s &deg;C\"\n"
-        "}\n"
-    "}\n";
-
-    char floatBuf[4][MAX_FLOAT_SIZE];
-    int at = snprintf_P(buf, n, jsonFormatter,
-
-        data[0] & 0x80 ? PSTR("FULL") : PSTR("DIMMED (LIGHTS ON)"),
-        data[0] & 0x0F,
-
-        (data[1] & 0x03) == 0x00 ? offStr :
-        (data[1] & 0x03) == 0x01 ? PSTR("ACC") :
-        (data[1] & 0x03) == 0x03 ? onStr :
-        (data[1] & 0x03) == 0x02 ? PSTR("START") :
-        ToHexStr((uint8_t)(data[1] & 0x03)),
-
-        data[1] & 0x04 ? yesStr : noStr,
-        data[1] & 0x10 ? onStr : offStr,
-        data[1] & 0x20 ? yesStr : noStr,
-        data[1] & 0x40 ? presentStr : notPresentStr,
-        data[2] == 0xFF ? notApplicable3Str : FloatToStr(floatBuf[0], waterTemp, 0),
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+
+    if (IsChanged(DATA_BYTE(0)))
+    {
+        json.AddStrP(PSTR("dash_light"), data[0] & 0x80 ? PSTR("FULL") : PSTR("DIMMED (LIGHTS ON)"));
+        json.AddUInt(PSTR("dash_actual_brightness"), data[0] & 0x0F);
+    } // if
+
+    if (IsChanged(DATA_BYTE(1)))
+    {
+        json.BeginValue(PSTR("contact_key_position"));
+        if ((data[1] & 0x03) == 0x00) json.StrP(offStr);
+        else if ((data[1] & 0x03) == 0x01) json.StrP(PSTR("ACC"));
+        else if ((data[1] & 0x03) == 0x03) json.StrP(onStr);
+        else json.StrP(PSTR("START"));
+        json.EndValue();
+
+        json.AddStrP(PSTR("engine_running"), data[1] & 0x04 ? yesStr : noStr);
+        json.AddStrP(PSTR("economy_mode"), data[1] & 0x10 ? onStr : offStr);
+        json.AddStrP(PSTR("in_reverse"), data[1] & 0x20 ? yesStr : noStr);
+        json.AddStrP(PSTR("trailer"), data[1] & 0x40 ? presentStr : notPresentStr);
+    } // if
+
+    if (IsChanged(DATA_BYTE(2)))
+    {
+        if (data[2] == 0xFF) json.AddStrP(PSTR("water_temp"), notApplicable3Str);
+        else json.AddInt(PSTR("water_temp"), waterTemp);
 
         // TODO - hard coded value 130 degrees Celsius for 100%
         #define MAX_COOLANT_TEMP (130)
-        data[2] == 0xFF ?
-            PSTR("0") :
-            waterTemp >= MAX_COOLANT_TEMP ? PSTR("1") :
-                FloatToStr(floatBuf[1], (float)waterTemp / MAX_COOLANT_TEMP, 2),
+        AddScaleX(json, PSTR("water_temp_perc"),
+            data[2] == 0xFF ? 0 :
+            waterTemp >= MAX_COOLANT_TEMP ? 100 :
+            RoundedDiv(waterTemp * 100L, MAX_COOLANT_TEMP));
+    } // if
 
-        FloatToStr(floatBuf[2], ((uint32_t)data[3] << 16 | (uint32_t)data[4] << 8 | data[5]) / 10.0, 1),
-        FloatToStr(floatBuf[3], (data[6] - 0x50) / 2.0, 1)
-    );
+    if (IsChanged(DATA_BYTES(3, 5)))
+    {
+        json.AddFixed(PSTR("odometer_1"), (uint32_t)data[3] << 16 | (uint32_t)data[4] << 8 | data[5], 1);
+    } // if
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    if (IsChanged(DATA_BYTE(6)))
+    {
+        json.BeginValue(PSTR("exterior_temperature"))
+            .Fixed(((int)data[6] - 0x50) * 5, 1)
+            .StrP(PSTR(" &deg;C"))
+            .EndValue();
+    } // if
 
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseEnginePkt
 
 VanPacketParseResult_t ParseHeadUnitStalkPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -584,33 +623,24 @@ VanPacketParseResult_t ParseHeadUnitStalkPkt(const char* idenStr, TVanPacketRxDe
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"head_unit_stalk_buttons\": \"%S %S %S %S %S\",\n"
-            "\"head_unit_stalk_wheel\": \"%d\",\n"
-            "\"head_unit_stalk_wheel_rollover\": \"%u\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-
-        data[0] & 0x80 ? PSTR("NEXT") : emptyStr,
-        data[0] & 0x40 ? PSTR("PREV") : emptyStr,
-        data[0] & 0x08 ? PSTR("VOL_UP") : emptyStr,
-        data[0] & 0x04 ? PSTR("VOL_DOWN") : emptyStr,
-        data[0] & 0x02 ? PSTR("SOURCE") : emptyStr,
-
-        data[1] - 0x80,
-        data[0] >> 4 & 0x03
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    if (IsChanged(DATA_BYTE(0)))
+    {
+        json.BeginValue(PSTR("head_unit_stalk_buttons"))
+            .StrP(data[0] & 0x80 ? PSTR("NEXT") : emptyStr).Char(' ')
+            .StrP(data[0] & 0x40 ? PSTR("PREV") : emptyStr).Char(' ')
+            .StrP(data[0] & 0x08 ? PSTR("VOL_UP") : emptyStr).Char(' ')
+            .StrP(data[0] & 0x04 ? PSTR("VOL_DOWN") : emptyStr).Char(' ')
+            .StrP(data[0] & 0x02 ? PSTR("SOURCE") : emptyStr)
+            .EndValue();
+    } // if
 
-    return VAN_PACKET_PARSE_OK;
+    if (IsChanged(DATA_BYTE(1))) json.AddInt(PSTR("head_unit_stalk_wheel"), data[1] - 0x80);
+    if (IsChanged(DATA_BYTE(0))) json.AddUInt(PSTR("head_unit_stalk_wheel_rollover"), data[0] >> 4 & 0x03);
+
+    return EndDisplayEvent(json);
 } // ParseHeadUnitStalkPkt
 
 VanPacketParseResult_t ParseLightsStatusPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -624,44 +654,35 @@ VanPacketParseResult_t ParseLightsStatusPkt(const char* idenStr, TVanPacketRxDes
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"instrument_cluster\": \"%SENALED\",\n"
-            "\"speed_regulator_wheel\": \"%S\",\n"
-            "\"warning_led\": \"%S\",\n"
-            "\"diesel_glow_plugs\": \"%S\",\n"
-            "\"door_open\": \"%S\",\n"
-            "\"remaining_km_to_service\": \"%u\",\n"
-            "\"remaining_km_to_service_dash\": \"%u\",\n"
-            "\"lights\": \"%S%S%S%S%S%S\"";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-
-        data[0] & 0x80 ? emptyStr : PSTR("NOT "),
-        data[0] & 0x40 ? onStr : offStr,
-        data[0] & 0x20 ? onStr : offStr,
-        data[0] & 0x04 ? onStr : offStr,
-        data[1] & 0x01 ? yesStr : noStr,
-
-        ((uint16_t)data[2] << 8 | data[3]) * 20,
-        (((uint16_t)data[2] << 8 | data[3]) * 20) / 100 * 100,  // Round downwards to nearest multiple of 100 kms
-
-        data[5] & 0x80 ? PSTR("DIPPED_BEAM ") : emptyStr,
-        data[5] & 0x40 ? PSTR("HIGH_BEAM ") : emptyStr,
-        data[5] & 0x20 ? PSTR("FOG_FRONT ") : emptyStr,
-        data[5] & 0x10 ? PSTR("FOG_REAR ") : emptyStr,
-        data[5] & 0x08 ? PSTR("INDICATOR_RIGHT ") : emptyStr,
-        data[5] & 0x04 ? PSTR("INDICATOR_LEFT ") : emptyStr
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+
+    json.BeginValue(PSTR("instrument_cluster")).StrP(data[0] & 0x80 ? emptyStr : PSTR("NOT ")).StrP(PSTR("ENALED"))
+        .EndValue();
+    json.AddStrP(PSTR("speed_regulator_wheel"), data[0] & 0x40 ? onStr : offStr);
+    json.AddStrP(PSTR("warning_led"), data[0] & 0x20 ? onStr : offStr);
+    json.AddStrP(PSTR("diesel_glow_plugs"), data[0] & 0x04 ? onStr : offStr);
+    json.AddStrP(PSTR("door_open"), data[1] & 0x01 ? yesStr : noStr);
+
+    uint32_t remainingKmToService = ((uint16_t)data[2] << 8 | data[3]) * 20;
+    json.AddUInt(PSTR("remaining_km_to_service"), remainingKmToService);
+
+    // Round downwards to nearest multiple of 100 kms
+    json.AddUInt(PSTR("remaining_km_to_service_dash"), remainingKmToService / 100 * 100);
+
+    json.BeginValue(PSTR("lights"))
+        .StrP(data[5] & 0x80 ? PSTR("DIPPED_BEAM ") : emptyStr)
+        .StrP(data[5] & 0x40 ? PSTR("HIGH_BEAM ") : emptyStr)
+        .StrP(data[5] & 0x20 ? PSTR("FOG_FRONT ") : emptyStr)
+        .StrP(data[5] & 0x10 ? PSTR("FOG_REAR ") : emptyStr)
+        .StrP(data[5] & 0x08 ? PSTR("INDICATOR_RIGHT ") : emptyStr)
+        .StrP(data[5] & 0x04 ? PSTR("INDICATOR_LEFT ") : emptyStr)
+        .EndValue();
 
     if (data[5] & 0x02)
     {
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at,
-                PSTR(",\n\"auto_gearbox\": \"%S%S%S%S\""),
+        json.BeginValue(PSTR("auto_gearbox"))
+            .StrP(
                 (data[4] & 0x70) == 0x00 ? PSTR("P") :
                 (data[4] & 0x70) == 0x10 ? PSTR("R") :
                 (data[4] & 0x70) == 0x20 ? PSTR("N") :
@@ -669,72 +690,55 @@ VanPacketParseResult_t ParseLightsStatusPkt(const char* idenStr, TVanPacketRxDes
                 (data[4] & 0x70) == 0x40 ? PSTR("4") :
                 (data[4] & 0x70) == 0x50 ? PSTR("3") :
                 (data[4] & 0x70) == 0x60 ? PSTR("2") :
-                (data[4] & 0x70) == 0x70 ? PSTR("1") :
-                ToHexStr((uint8_t)(data[4] & 0x70)),
-
-                data[4] & 0x08 ? PSTR(" - Snow") : emptyStr,
-                data[4] & 0x04 ? PSTR(" - Sport") : emptyStr,
-                data[4] & 0x80 ? PSTR(" (blinking)") : emptyStr
-            );
-    } // if
-
-    if (data[6] != 0xFF)
-    {
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"oil_temperature\": \"%d\""), (int)data[6] - 40);  // Never seen this
+                PSTR("1"))
+            .StrP(data[4] & 0x08 ? PSTR(" - Snow") : emptyStr)
+            .StrP(data[4] & 0x04 ? PSTR(" - Sport") : emptyStr)
+            .StrP(data[4] & 0x80 ? PSTR(" (blinking)") : emptyStr)
+            .EndValue();
     } // if
 
-    if (data[7] != 0xFF)
-    {
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"fuel_level\": \"%u\""), data[7]);  // Never seen this
-    } // if
+    if (data[6] != 0xFF) json.AddInt(PSTR("oil_temperature"), (int)data[6] - 40);  // Never seen this
+    if (data[7] != 0xFF) json.AddUInt(PSTR("fuel_level"), data[7]);  // Never seen this
 
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, PSTR(",\n\"oil_level_raw\": \"%u\""), data[8]);
+    json.AddUInt(PSTR("oil_level_raw"), data[8]);
 
     // 0x55 = 85
     #define MAX_OIL_LEVEL (0x55)
-    char floatBuf[MAX_FLOAT_SIZE];
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at,
-            ",\n"
-            "\"oil_level_raw_perc\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"transform\": \"scaleX(%S)\"\n"
-                "}\n"
-            "}",
-            data[8] >= MAX_OIL_LEVEL ?
-                PSTR("1") :
-                FloatToStr(floatBuf, (float)data[8] / MAX_OIL_LEVEL, 2)
-        );
+    if (data[8] >= MAX_OIL_LEVEL)
+    {
+        json.BeginObject(PSTR("oil_level_raw_perc"));
+        json.BeginObject(PSTR("style"));
+        json.AddStrP(PSTR("transform"), PSTR("scaleX(1)"));
+        json.EndObject();
+        json.EndObject();
+    }
+    else
+    {
+        AddScaleX(json, PSTR("oil_level_raw_perc"), RoundedDiv(data[8] * 100L, MAX_OIL_LEVEL));
+    } // if
 
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, PSTR(",\n\"oil_level_dash\": \"%S\""),
-            data[8] <= 0x0B ? PSTR("------") :
-            data[8] <= 0x19 ? PSTR("O-----") :
-            data[8] <= 0x27 ? PSTR("OO----") :
-            data[8] <= 0x35 ? PSTR("OOO---") :
-            data[8] <= 0x43 ? PSTR("OOOO--") :
-            data[8] <= 0x51 ? PSTR("OOOOO-") :
-            PSTR("OOOOOO")
-        );
+    json.AddStrP(PSTR("oil_level_dash"),
+        data[8] <= 0x0B ? PSTR("------") :
+        data[8] <= 0x19 ? PSTR("O-----") :
+        data[8] <= 0x27 ? PSTR("OO----") :
+        data[8] <= 0x35 ? PSTR("OOO---") :
+        data[8] <= 0x43 ? PSTR("OOOO--") :
+        data[8] <= 0x51 ? PSTR("OOOOO-") :
+        PSTR("OOOOOO")
+    );
 
     if (data[10] != 0xFF)
     {
         // Never seen this; I don't have LPG
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"lpg_fuel_level\": \"%S\""),
-                data[10] <= 0x08 ? PSTR("1") :
-                data[10] <= 0x11 ? PSTR("2") :
-                data[10] <= 0x21 ? PSTR("3") :
-                data[10] <= 0x32 ? PSTR("4") :
-                data[10] <= 0x43 ? PSTR("5") :
-                data[10] <= 0x53 ? PSTR("6") :
-                PSTR("7")
-            );
+        json.AddStrP(PSTR("lpg_fuel_level"),
+            data[10] <= 0x08 ? PSTR("1") :
+            data[10] <= 0x11 ? PSTR("2") :
+            data[10] <= 0x21 ? PSTR("3") :
+            data[10] <= 0x32 ? PSTR("4") :
+            data[10] <= 0x43 ? PSTR("5") :
+            data[10] <= 0x53 ? PSTR("6") :
+            PSTR("7")
+        );
     } // if
 
     if (dataLen == 14)
@@ -743,26 +747,19 @@ VanPacketParseResult_t ParseLightsStatusPkt(const char* idenStr, TVanPacketRxDes
 
         // http://pinterpeti.hu/psavanbus/PSA-VAN.html#4FC_2
 
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"cruise_control\": \"%S\""),
-                data[11] == 0x41 ? offStr :
-                data[11] == 0x49 ? PSTR("Cruise") :
-                data[11] == 0x59 ? PSTR("Cruise - speed") :
-                data[11] == 0x81 ? PSTR("Limiter") :
-                data[11] == 0x89 ? PSTR("Limiter - speed") :
-                ToHexStr(data[11])
-            );
+        json.AddStrP(PSTR("cruise_control"),
+            data[11] == 0x41 ? offStr :
+            data[11] == 0x49 ? PSTR("Cruise") :
+            data[11] == 0x59 ? PSTR("Cruise - speed") :
+            data[11] == 0x81 ? PSTR("Limiter") :
+            data[11] == 0x89 ? PSTR("Limiter - speed") :
+            ToHexStr(data[11])
+        );
 
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"cruise_control_speed\": \"%u\""), data[12]);
+        json.AddUInt(PSTR("cruise_control_speed"), data[12]);
     } // if
 
-    at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseLightsStatusPkt
 
 VanPacketParseResult_t ParseDeviceReportPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -774,21 +771,16 @@ VanPacketParseResult_t ParseDeviceReportPkt(const char* idenStr, TVanPacketRxDes
     if (dataLen < 1 || dataLen > 3) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
     const uint8_t* data = pkt.Data();
-    int at = 0;
+
+    TVanJsonWriter json(buf, n);
 
     if (data[0] == 0x8A)
     {
         if (dataLen != 3) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_report\": \"%S\"";
-
-        at = snprintf_P(buf, n, jsonFormatter,
+        BeginDisplayEvent(json);
 
+        json.AddStrP(PSTR("head_unit_report"),
             data[1] == 0x20 ? PSTR("TUNER_REPLY") :
             data[1] == 0x21 ? PSTR("AUDIO_SETTINGS_ANNOUNCE") :
             data[1] == 0x22 ? PSTR("BUTTON_PRESS_ANNOUNCE") :
@@ -812,10 +804,8 @@ VanPacketParseResult_t ParseDeviceReportPkt(const char* idenStr, TVanPacketRxDes
         // Button-press announcement?
         if ((data[1] & 0x0F) == 0x02)
         {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at,
-                    PSTR(",\n\"head_unit_button_pressed\": \"%S%S\""),
-
+            json.BeginValue(PSTR("head_unit_button_pressed"))
+                .StrP(
                     (data[2] & 0x1F) == 0x01 ? PSTR("1") :
                     (data[2] & 0x1F) == 0x02 ? PSTR("2") :
                     (data[2] & 0x1F) == 0x03 ? PSTR("3") :
@@ -832,31 +822,21 @@ VanPacketParseResult_t ParseDeviceReportPkt(const char* idenStr, TVanPacketRxDes
                     (data[2] & 0x1F) == 0x1C ? PSTR("TAPE") :
                     (data[2] & 0x1F) == 0x1D ? PSTR("CD") :
                     (data[2] & 0x1F) == 0x1E ? PSTR("CD_CHANGER") :
-                    ToHexStr(data[2]),
-
+                    ToHexStr(data[2]))
+                .StrP(
                     (data[2] & 0xC0) == 0xC0 ? PSTR(" (held)") :
                     data[2] & 0x40 ? PSTR(" (released)") :
                     data[2] & 0x80 ? PSTR(" (repeat)") :
-                    emptyStr
-                );
+                    emptyStr)
+                .EndValue();
         } // if
-
-        at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
     }
     else if (data[0] == 0x96)
     {
         if (dataLen != 1) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"cd_changer_announce\": \"STATUS_UPDATE_ANNOUNCE\""
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter);
+        BeginDisplayEvent(json);
+        json.AddStrP(PSTR("cd_changer_announce"), PSTR("STATUS_UPDATE_ANNOUNCE"));
     }
     else if (data[0] == 0x07)
     {
@@ -877,10 +857,7 @@ VanPacketParseResult_t ParseDeviceReportPkt(const char* idenStr, TVanPacketRxDes
         return VAN_PACKET_PARSE_TO_BE_DECODED;
     } // if
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseDeviceReportPkt
 
 VanPacketParseResult_t ParseCarStatus1Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -901,70 +878,43 @@ VanPacketParseResult_t ParseCarStatus1Pkt(const char* idenStr, TVanPacketRxDesc&
     memcpy(packetData, data + 1, dataLen - 2);
     */
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"door_front_right\": \"%S\",\n"
-            "\"door_front_left\": \"%S\",\n"
-            "\"door_rear_right\": \"%S\",\n"
-            "\"door_rear_left\": \"%S\",\n"
-            "\"door_boot\": \"%S\",\n"
-            "\"right_stalk_button\": \"%S\",\n"
-            "\"avg_speed_1\": \"%u\",\n"
-            "\"avg_speed_2\": \"%u\",\n"
-            "\"exp_moving_avg_speed\": \"%u\",\n"
-            "\"distance_1\": \"%u\",\n"
-            "\"avg_consumption_lt_100_1\": \"%s\",\n"
-            "\"distance_2\": \"%u\",\n"
-            "\"avg_consumption_lt_100_2\": \"%s\",\n"
-            "\"inst_consumption_lt_100\": \"%S\",\n"
-            "\"distance_to_empty\": \"%u\"\n"
-        "}\n"
-    "}\n";
-
-    float avgConsumptionLt100_1 = ((uint16_t)data[16] << 8 | data[17]) / 10.0;
-    float avgConsumptionLt100_2 = ((uint16_t)data[20] << 8 | data[21]) / 10.0;
-    float instConsumptionLt_100 = ((uint16_t)data[22] << 8 | data[23]) / 10.0;
-
-    char floatBuf[3][MAX_FLOAT_SIZE];
-    int at = snprintf_P(buf, n, jsonFormatter,
-        data[7] & 0x80 ? openStr : closedStr,
-        data[7] & 0x40 ? openStr : closedStr,
-        data[7] & 0x20 ? openStr : closedStr,
-        data[7] & 0x10 ? openStr : closedStr,
-        data[7] & 0x08 ? openStr : closedStr,
-        data[10] & 0x01 ? PSTR("PRESSED") : PSTR("RELEASED"),
-        data[11],
-        data[12],
-
-        // When engine running but stopped (actual vehicle speed is 0), this value counts down by 1 every
-        // 10 - 20 seconds or so. When driving, this goes up and down slowly toward the current speed.
-        // Looking at the time stamps when this value changes, it looks like this is an exponential moving
-        // average (EMA) of the recent vehicle speed. When the actual speed is 0, the value is seen to decrease
-        // about 12% per minute. If the actual vehicle speed is sampled every second, then, in the
-        // following formula, K would be around 12% / 60 = 0.2% = 0.002 :
-        //
-        //   exp_moving_avg_speed := exp_moving_avg_speed * (1 − K) + actual_vehicle_speed * K
-        //
-        // Often used in EMA is the constant N, where K = 2 / (N + 1). That means N would be around 1000 (given
-        // a sampling time of 1 second).
-        //
-        data[13],
-
-        (uint16_t)data[14] << 8 | data[15],
-        FloatToStr(floatBuf[0], avgConsumptionLt100_1, 1),
-        (uint16_t)data[18] << 8 | data[19],
-        FloatToStr(floatBuf[1], avgConsumptionLt100_2, 1),
-        (uint16_t)data[22] << 8 | data[23] == 0xFFFF ? notApplicable3Str : FloatToStr(floatBuf[2], instConsumptionLt_100, 1),
-        (uint16_t)data[24] << 8 | data[25]
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+
+    json.AddStrP(PSTR("door_front_right"), data[7] & 0x80 ? openStr : closedStr);
+    json.AddStrP(PSTR("door_front_left"), data[7] & 0x40 ? openStr : closedStr);
+    json.AddStrP(PSTR("door_rear_right"), data[7] & 0x20 ? openStr : closedStr);
+    json.AddStrP(PSTR("door_rear_left"), data[7] & 0x10 ? openStr : closedStr);
+    json.AddStrP(PSTR("door_boot"), data[7] & 0x08 ? openStr : closedStr);
+    json.AddStrP(PSTR("right_stalk_button"), data[10] & 0x01 ? PSTR("PRESSED") : PSTR("RELEASED"));
+    json.AddUInt(PSTR("avg_speed_1"), data[11]);
+    json.AddUInt(PSTR("avg_speed_2"), data[12]);
+
+    // When engine running but stopped (actual vehicle speed is 0), this value counts down by 1 every
+    // 10 - 20 seconds or so. When driving, this goes up and down slowly toward the current speed.
+    // Looking at the time stamps when this value changes, it looks like this is an exponential moving
+    // average (EMA) of the recent vehicle speed. When the actual speed is 0, the value is seen to decrease
+    // about 12% per minute. If the actual vehicle speed is sampled every second, then, in the
+    // following formula, K would be around 12% / 60 = 0.2% = 0.002 :
+    //
+    //   exp_moving_avg_speed := exp_moving_avg_speed * (1 − K) + actual_vehicle_speed * K
+    //
+    // Often used in EMA is the constant N, where K = 2 / (N + 1). That means N would be around 1000 (given
+    // a sampling time of 1 second).
+    //
+    json.AddUInt(PSTR("exp_moving_avg_speed"), data[13]);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    json.AddUInt(PSTR("distance_1"), (uint16_t)data[14] << 8 | data[15]);
+    json.AddFixed(PSTR("avg_consumption_lt_100_1"), (uint16_t)data[16] << 8 | data[17], 1);
+    json.AddUInt(PSTR("distance_2"), (uint16_t)data[18] << 8 | data[19]);
+    json.AddFixed(PSTR("avg_consumption_lt_100_2"), (uint16_t)data[20] << 8 | data[21], 1);
 
-    return VAN_PACKET_PARSE_OK;
+    if ((uint16_t)data[22] << 8 | data[23] == 0xFFFF) json.AddStrP(PSTR("inst_consumption_lt_100"), notApplicable3Str);
+    else json.AddFixed(PSTR("inst_consumption_lt_100"), (uint16_t)data[22] << 8 | data[23], 1);
+
+    json.AddUInt(PSTR("distance_to_empty"), (uint16_t)data[24] << 8 | data[25]);
+
+    return EndDisplayEvent(json);
 } // ParseCarStatus1Pkt
 
 VanPacketParseResult_t ParseCarStatus2Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1157,18 +1107,12 @@ VanPacketParseResult_t ParseCarStatus2Pkt(const char* idenStr, TVanPacketRxDesc&
         msg_15_0, msg_15_1, msg_15_2, msg_15_3, msg_15_4, msg_15_5, msg_15_6, msg_15_7
     };
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\": {\n"
-            "\"alarm_list\":\n"
-            "[";
-
-    int at = snprintf_P(buf, n, jsonFormatter);
-
     const uint8_t* data = pkt.Data();
 
-    bool first = true;
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+
+    json.BeginArray(PSTR("alarm_list"));
     for (int byte = 0; byte < 16; byte++)
     {
         if (byte == 9) byte++;
@@ -1176,31 +1120,17 @@ VanPacketParseResult_t ParseCarStatus2Pkt(const char* idenStr, TVanPacketRxDesc&
         {
             if (data[byte] >> bit & 0x01)
             {
-                char alarmText[80];  // Make sure this is large enough for the largest string it must hold; see above
-                strncpy_P(alarmText, (char *)pgm_read_dword(&(msgTable[byte * 8 + bit])), sizeof(alarmText) - 1);
-                alarmText[sizeof(alarmText) - 1] = 0;
-                at += at >= JSON_BUFFER_SIZE ? 0 :
-                    snprintf_P(buf + at, n - at, PSTR("%S\n\"%s\""), first ? emptyStr : commaStr, alarmText);
-                first = false;
+                json.BeginValue().StrP((const char*)pgm_read_ptr(&(msgTable[byte * 8 + bit]))).EndValue();
             } // if
         } // for
     } // for
-
-    at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n]"));
+    json.EndArray();
 
     uint8_t currentMsg = data[9];
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, PSTR(",\n\"message_displayed_on_mfd\": \"%S\""),
-            currentMsg == 0xFF ? emptyStr : msgTable[currentMsg]);
-
-    at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
-
-    // TODO - this packet could become very large and overflow the JSON buffer, causing corrupt JSON data to be sent
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    json.AddStrP(PSTR("message_displayed_on_mfd"),
+        currentMsg == 0xFF ? emptyStr : (const char*)pgm_read_ptr(&(msgTable[currentMsg])));
 
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseCarStatus2Pkt
 
 VanPacketParseResult_t ParseDashboardPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1210,30 +1140,22 @@ VanPacketParseResult_t ParseDashboardPkt(const char* idenStr, TVanPacketRxDesc&
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"engine_rpm\": \"%S\",\n"
-            "\"vehicle_speed\": \"%S\"\n"
-        "}\n"
-    "}\n";
-
-    char floatBuf[2][MAX_FLOAT_SIZE];
-    int at = snprintf_P(buf, n, jsonFormatter,
-        data[0] == 0xFF && data[1] == 0xFF ?
-            PSTR("---.-") :
-            FloatToStr(floatBuf[0], ((uint16_t)data[0] << 8 | data[1]) / 8.0, 1),
-        data[2] == 0xFF && data[3] == 0xFF ?
-            PSTR("---.--") :
-            FloatToStr(floatBuf[1], ((uint16_t)data[2] << 8 | data[3]) / 100.0, 2)
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    if (IsChanged(DATA_BYTES(0, 1)))
+    {
+        if (data[0] == 0xFF && data[1] == 0xFF) json.AddStrP(PSTR("engine_rpm"), PSTR("---.-"));
+        else json.AddFixed(PSTR("engine_rpm"), RoundedDiv(((uint16_t)data[0] << 8 | data[1]) * 10L, 8), 1);
+    } // if
 
-    return VAN_PACKET_PARSE_OK;
+    if (IsChanged(DATA_BYTES(2, 3)))
+    {
+        if (data[2] == 0xFF && data[3] == 0xFF) json.AddStrP(PSTR("vehicle_speed"), PSTR("---.--"));
+        else json.AddFixed(PSTR("vehicle_speed"), (uint16_t)data[2] << 8 | data[3], 2);
+    } // if
+
+    return EndDisplayEvent(json);
 } // ParseDashboardPkt
 
 VanPacketParseResult_t ParseDashboardButtonsPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1245,54 +1167,36 @@ VanPacketParseResult_t ParseDashboardButtonsPkt(const char* idenStr, TVanPacketR
     if (dataLen != 11 && dataLen != 12) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
     const uint8_t* data = pkt.Data();
-    float fuelLevelFiltered = data[4] / 2.0;
-
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"hazard_lights\": \"%S\",\n"
-            "\"door_lock\": \"%S\",\n"
-            "\"dashboard_programmed_brightness\": \"%u\",\n"
-            "\"esp\": \"%S\",\n"
-            "\"fuel_level_filtered\": \"%s\",\n"
-            "\"fuel_level_filtered_perc\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"transform\": \"scaleX(%S)\"\n"
-                "}\n"
-            "},\n"
-            "\"fuel_level_raw\": \"%s\"\n"
-        "}\n"
-    "}\n";
 
     // data[6..10] - always 00-FF-00-FF-00
 
-    char floatBuf[3][MAX_FLOAT_SIZE];
-    int at = snprintf_P(buf, n, jsonFormatter,
-        data[0] & 0x02 ? onStr : offStr,
-        data[2] & 0x40 ? PSTR("LOCKED") : PSTR("UNLOCKED"),
-        data[2] & 0x0F,
-        data[3] & 0x02 ? onStr : offStr,
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-        // Surely fuel level. Test with tank full shows definitely level is in litres.
-        FloatToStr(floatBuf[0], fuelLevelFiltered, 1),
+    if (IsChanged(DATA_BYTE(0))) json.AddStrP(PSTR("hazard_lights"), data[0] & 0x02 ? onStr : offStr);
 
-        // TODO - hard coded "full" value of 80.0
-        #define FULL_TANK_L (80.0)
-        fuelLevelFiltered >= FULL_TANK_L ?
-            PSTR("1") :
-            FloatToStr(floatBuf[1], fuelLevelFiltered / FULL_TANK_L, 2),
+    if (IsChanged(DATA_BYTE(2)))
+    {
+        json.AddStrP(PSTR("door_lock"), data[2] & 0x40 ? PSTR("LOCKED") : PSTR("UNLOCKED"));
+        json.AddUInt(PSTR("dashboard_programmed_brightness"), data[2] & 0x0F);
+    } // if
 
-        FloatToStr(floatBuf[2], data[5] / 2.0, 1)
-    );
+    if (IsChanged(DATA_BYTE(3))) json.AddStrP(PSTR("esp"), data[3] & 0x02 ? onStr : offStr);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    if (IsChanged(DATA_BYTE(4)))
+    {
+        // Surely fuel level. Test with tank full shows definitely level is in litres. Units of 0.5 litre.
+        json.AddFixed(PSTR("fuel_level_filtered"), data[4] * 5, 1);
 
-    return VAN_PACKET_PARSE_OK;
+        // TODO - hard coded "full" value of 80 litres
+        #define FULL_TANK_HALF_L (160)
+        AddScaleX(json, PSTR("fuel_level_filtered_perc"),
+            data[4] >= FULL_TANK_HALF_L ? 100 : RoundedDiv(data[4] * 100L, FULL_TANK_HALF_L));
+    } // if
+
+    if (IsChanged(DATA_BYTE(5))) json.AddFixed(PSTR("fuel_level_raw"), data[5] * 5, 1);
+
+    return EndDisplayEvent(json);
 } // ParseDashboardButtonsPkt
 
 VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1314,7 +1218,8 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
     const uint8_t* data = pkt.Data();
     uint8_t infoType = data[1];
     int dataLen = pkt.DataLen();
-    int at = 0;
+
+    TVanJsonWriter json(buf, n);
 
     switch (infoType)
     {
@@ -1329,8 +1234,6 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
             // data[2]: radio band and preset position
             uint8_t band = data[2] & 0x07;
             uint8_t presetMemory = data[2] >> 3 & 0x0F;
-            char presetMemoryBuffer[3];
-            sprintf_P(presetMemoryBuffer, PSTR("%1u"), presetMemory);
 
             // data[3]: search bits
             bool dxSensitivity = data[3] & 0x02;  // Tuner sensitivity: distant (Dx) or local (Lo)
@@ -1362,76 +1265,63 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
             // & 0x0F = signal strength: increases with antenna plugged in and decreases with antenna plugged
             //          out. Updated when a station is being tuned in to, or when the MAN button is pressed.
             uint8_t signalStrength = data[6] & 0x0F;
-            char signalStrengthBuffer[3];
-            sprintf_P(signalStrengthBuffer, PSTR("%u"), signalStrength);
-
-            const static char jsonFormatterCommon[] PROGMEM =
-            "{\n"
-                "\"event\": \"display\",\n"
-                "\"data\":\n"
-                "{\n"
-                    "\"tuner_band\": \"%S\",\n"
-                    "\"fm_band\": \"%S\",\n"
-                    "\"fm_band_1\": \"%S\",\n"
-                    "\"fm_band_2\": \"%S\",\n"
-                    "\"fm_band_ast\": \"%S\",\n"
-                    "\"am_band\": \"%S\",\n"
-                    "\"tuner_memory\": \"%S\",\n"
-                    "\"frequency\": \"%S\",\n"
-                    "\"frequency_h\": \"%S\",\n"
-                    "\"frequency_unit\": \"%S\",\n"
-                    "\"frequency_khz\": \"%S\",\n"
-                    "\"frequency_mhz\": \"%S\",\n"
-                    "\"signal_strength\": \"%S\",\n"
-                    "\"search_mode\": \"%S\",\n"
-                    "\"search_sensitivity\": \"%S\",\n"
-                    "\"search_sensitivity_lo\": \"%S\",\n"
-                    "\"search_sensitivity_dx\": \"%S\",\n"
-                    "\"search_direction\": \"%S\",\n"
-                    "\"search_direction_up\": \"%S\",\n"
-                    "\"search_direction_down\": \"%S\"";
-
-            char floatBuf[MAX_FLOAT_SIZE];
-            at = snprintf_P(buf, n, jsonFormatterCommon,
-                TunerBandStr(band),
-                band == TB_FM1 || band == TB_FM2 || band == TB_FM3 || band == TB_FMAST ? onStr : offStr,
-                band == TB_FM1 ? onStr : offStr,
-                band == TB_FM2 ? onStr : offStr,
-                band == TB_FMAST ? onStr : offStr,
-                band == TB_AM ? onStr : offStr,
-                presetMemory == 0 ? PSTR("-") : presetMemoryBuffer,
-                frequency == 0x07FF ? notApplicable3Str :
-                    band == TB_AM
-                        ? FloatToStr(floatBuf, frequency, 0)  // AM and LW bands
-                        : FloatToStr(floatBuf, (frequency / 2 + 500) / 10.0, 1),  // FM bands
+
+            BeginDisplayEvent(json);
+
+            json.AddStrP(PSTR("tuner_band"), TunerBandStr(band));
+            json.AddStrP(PSTR("fm_band"),
+                band == TB_FM1 || band == TB_FM2 || band == TB_FM3 || band == TB_FMAST ? onStr : offStr);
+            json.AddStrP(PSTR("fm_band_1"), band == TB_FM1 ? onStr : offStr);
+            json.AddStrP(PSTR("fm_band_2"), band == TB_FM2 ? onStr : offStr);
+            json.AddStrP(PSTR("fm_band_ast"), band == TB_FMAST ? onStr : offStr);
+            json.AddStrP(PSTR("am_band"), band == TB_AM ? onStr : offStr);
+
+            if (presetMemory == 0) json.AddStrP(PSTR("tuner_memory"), PSTR("-"));
+            else json.AddUInt(PSTR("tuner_memory"), presetMemory);
+
+            if (frequency == 0x07FF) json.AddStrP(PSTR("frequency"), notApplicable3Str);
+            else if (band == TB_AM) json.AddUInt(PSTR("frequency"), frequency);  // AM and LW bands
+            else json.AddFixed(PSTR("frequency"), frequency / 2 + 500, 1);  // FM bands
+
+            json.AddStrP(PSTR("frequency_h"),
                 frequency == 0x07FF ? PSTR("-") :
                     band == TB_AM
                         ? emptyStr  // AM and LW bands
-                        : frequency % 2 == 0 ? PSTR("0") : PSTR("5"),  // FM bands
-                band == TB_AM ? PSTR("KHz") : PSTR("MHz"),
-                band == TB_AM ? onStr : offStr,  // For retro-type "LED" display
-                band == TB_AM ? offStr : onStr,  // For retro-type "LED" display
-
-                // TODO - not sure if applicable in AM mode
-                signalStrength == 15 && (searchMode == TS_BY_FREQUENCY || searchMode == TS_BY_MATCHING_PTY)
-                    ? notApplicable2Str
-                    : signalStrengthBuffer,
-
-                TunerSearchModeStr(searchMode),
-
-                // Search sensitivity: distant (Dx) or local (Lo)
-                // TODO - not sure if this bit is applicable for the various values of 'searchMode'
-                // ! anySearchBusy ? emptyStr : dxSensitivity ? PSTR("Dx") : PSTR("Lo"),
-                // ! anySearchBusy ? offStr : dxSensitivity ? offStr : onStr,  // For retro-type "LED" display
-                // ! anySearchBusy ? offStr : dxSensitivity ? onStr : offStr,  // For retro-type "LED" display
-                dxSensitivity ? PSTR("Dx") : PSTR("Lo"),
-                dxSensitivity ? offStr : onStr,  // For retro-type "LED" display
-                dxSensitivity ? onStr : offStr,  // For retro-type "LED" display
-
-                ! anySearchBusy ? emptyStr : searchDirectionUp ? PSTR("UP") : PSTR("DOWN"),
-                anySearchBusy && searchDirectionUp ? onStr : offStr,  // For retro-type "LED" display
-                anySearchBusy && ! searchDirectionUp ? onStr : offStr  // For retro-type "LED" display
-            );
+                        : frequency % 2 == 0 ? PSTR("0") : PSTR("5"));  // FM bands
+
+            json.AddStrP(PSTR("frequency_unit"), band == TB_AM ? PSTR("KHz") : PSTR("MHz"));
+            json.AddStrP(PSTR("frequency_khz"), band == TB_AM ? onStr : offStr);  // For retro-type "LED" display
+            json.AddStrP(PSTR("frequency_mhz"), band == TB_AM ? offStr : onStr);  // For retro-type "LED" display
+
+            // TODO - not sure if applicable in AM mode
+            if (signalStrength == 15 && (searchMode == TS_BY_FREQUENCY || searchMode == TS_BY_MATCHING_PTY))
+            {
+                json.AddStrP(PSTR("signal_strength"), notApplicable2Str);
+            }
+            else
+            {
+                json.AddUInt(PSTR("signal_strength"), signalStrength);
+            } // if
+
+            json.AddStrP(PSTR("search_mode"), TunerSearchModeStr(searchMode));
+
+            // Search sensitivity: distant (Dx) or local (Lo)
+            // TODO - not sure if this bit is applicable for the various values of 'searchMode'
+            // ! anySearchBusy ? emptyStr : dxSensitivity ? PSTR("Dx") : PSTR("Lo"),
+            // ! anySearchBusy ? offStr : dxSensitivity ? offStr : onStr,  // For retro-type "LED" display
+            // ! anySearchBusy ? offStr : dxSensitivity ? onStr : offStr,  // For retro-type "LED" display
+            json.AddStrP(PSTR("search_sensitivity"), dxSensitivity ? PSTR("Dx") : PSTR("Lo"));
+
+            // For retro-type "LED" display
+            json.AddStrP(PSTR("search_sensitivity_lo"), dxSensitivity ? offStr : onStr);
+            json.AddStrP(PSTR("search_sensitivity_dx"), dxSensitivity ? onStr : offStr);
+
+            json.AddStrP(PSTR("search_direction"),
+                ! anySearchBusy ? emptyStr : searchDirectionUp ? PSTR("UP") : PSTR("DOWN"));
+            json.AddStrP(PSTR("search_direction_up"),  // For retro-type "LED" display
+                anySearchBusy && searchDirectionUp ? onStr : offStr);
+            json.AddStrP(PSTR("search_direction_down"),  // For retro-type "LED" display
+                anySearchBusy && ! searchDirectionUp ? onStr : offStr);
 
             if (band != TB_AM)
             {
@@ -1465,64 +1355,37 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
                 uint8_t selectedPty = data[10] & 0x1F;
                 bool ptyMatch = (data[10] & 0x20) == 0;  // PTY of station matches selected PTY
                 bool ptySelectionMenu = data[10] & 0x40;
-                char selectedPtyBuffer[40];
-                sprintf_P(selectedPtyBuffer, PSTR("%S"), PtyStrFull(selectedPty));
 
                 // data[11]: PTY code of current station
                 uint8_t currPty = data[11] & 0x1F;
-                char currPtyBuffer[40];
-                sprintf_P(currPtyBuffer, PSTR("%S"), PtyStrFull(currPty));
 
                 // data[12]...data[20]: RDS text
                 char rdsTxt[9];
                 strncpy(rdsTxt, (const char*) data + 12, 8);
                 rdsTxt[8] = 0;
 
-                const static char jsonFormatterFmBand[] PROGMEM = ",\n"
-                    "\"pty_selection_menu\": \"%S\",\n"
-                    "\"selected_pty\": \"%s\",\n"
-                    "\"pty_standby_mode\": \"%S\",\n"
-                    "\"pty_match\": \"%S\",\n"
-                    "\"pty_8\": \"%S\",\n"
-                    "\"pty_16\": \"%S\",\n"
-                    "\"pty_full\": \"%S\",\n"
-                    "\"pi_code\": \"%S\",\n"
-                    "\"pi_country\": \"%S\",\n"
-                    "\"pi_area_coverage\": \"%S\",\n"
-                    "\"regional\": \"%S\",\n"
-                    "\"ta_selected\": \"%S\",\n"
-                    "\"ta_not_available\": \"%S\",\n"
-                    "\"rds_selected\": \"%S\",\n"
-                    "\"rds_not_available\": \"%S\",\n"
-                    "\"rds_text\": \"%s\",\n"
-                    "\"info_traffic\": \"%S\"";
-
-                at += at >= JSON_BUFFER_SIZE ? 0 :
-                    snprintf_P(buf + at, n - at, jsonFormatterFmBand,
-                        ptySelectionMenu ? onStr : offStr,
-                        selectedPtyBuffer,
-                        ptyStandbyMode ? yesStr : noStr,
-                        ptyMatch ? yesStr : noStr,
-                        currPty == 0x00 ? notApplicable3Str : PtyStr8(currPty),
-                        currPty == 0x00 ? notApplicable3Str : PtyStr16(currPty),
-                        currPty == 0x00 ? notApplicable3Str : PtyStrFull(currPty),
-
-                        piCode == 0xFFFF ? notApplicable3Str : piBuffer,
-                        piCode == 0xFFFF ? notApplicable2Str : RadioPiCountry(countryCode),
-                        piCode == 0xFFFF ? notApplicable3Str : RadioPiAreaCoverage(coverageCode),
-
-                        regional ? onStr : offStr,
-                        taSelected ? yesStr : noStr,
-                        taNotAvailable ? yesStr : noStr,
-                        rdsSelected ? yesStr : noStr,
-                        rdsNotAvailable ? yesStr : noStr,
-                        rdsTxt,
-
-                        taAnnounce ? yesStr : noStr
-                    );
+                json.AddStrP(PSTR("pty_selection_menu"), ptySelectionMenu ? onStr : offStr);
+                json.AddStrP(PSTR("selected_pty"), PtyStrFull(selectedPty));
+                json.AddStrP(PSTR("pty_standby_mode"), ptyStandbyMode ? yesStr : noStr);
+                json.AddStrP(PSTR("pty_match"), ptyMatch ? yesStr : noStr);
+                json.AddStrP(PSTR("pty_8"), currPty == 0x00 ? notApplicable3Str : PtyStr8(currPty));
+                json.AddStrP(PSTR("pty_16"), currPty == 0x00 ? notApplicable3Str : PtyStr16(currPty));
+                json.AddStrP(PSTR("pty_full"), currPty == 0x00 ? notApplicable3Str : PtyStrFull(currPty));
+
+                json.AddStrP(PSTR("pi_code"), piCode == 0xFFFF ? notApplicable3Str : piBuffer);
+                json.AddStrP(PSTR("pi_country"), piCode == 0xFFFF ? notApplicable2Str : RadioPiCountry(countryCode));
+                json.AddStrP(PSTR("pi_area_coverage"),
+                    piCode == 0xFFFF ? notApplicable3Str : RadioPiAreaCoverage(coverageCode));
+
+                json.AddStrP(PSTR("regional"), regional ? onStr : offStr);
+                json.AddStrP(PSTR("ta_selected"), taSelected ? yesStr : noStr);
+                json.AddStrP(PSTR("ta_not_available"), taNotAvailable ? yesStr : noStr);
+                json.AddStrP(PSTR("rds_selected"), rdsSelected ? yesStr : noStr);
+                json.AddStrP(PSTR("rds_not_available"), rdsNotAvailable ? yesStr : noStr);
+                json.AddStr(PSTR("rds_text"), rdsTxt);
+
+                json.AddStrP(PSTR("info_traffic"), taAnnounce ? yesStr : noStr);
             } // if
-
-            at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
         }
         break;
 
@@ -1534,27 +1397,11 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
 
             uint8_t status = data[2] & 0x3C;
 
-            const static char jsonFormatter[] PROGMEM =
-            "{\n"
-                "\"event\": \"display\",\n"
-                "\"data\":\n"
-                "{\n"
-                    "\"tape_side\": \"%S\",\n"
-                    "\"tape_status\": \"%S\",\n"
-                    "\"tape_status_stopped\": \"%S\",\n"
-                    "\"tape_status_loading\": \"%S\",\n"
-                    "\"tape_status_play\": \"%S\",\n"
-                    "\"tape_status_fast_forward\": \"%S\",\n"
-                    "\"tape_status_next_track\": \"%S\",\n"
-                    "\"tape_status_rewind\": \"%S\",\n"
-                    "\"tape_status_previous_track\": \"%S\"\n"
-                "}\n"
-            "}\n";
-
-            at = snprintf_P(buf, n, jsonFormatter,
-
-                data[2] & 0x01 ? PSTR("2") : PSTR("1"),
+            BeginDisplayEvent(json);
+
+            json.AddStrP(PSTR("tape_side"), data[2] & 0x01 ? PSTR("2") : PSTR("1"));
 
+            json.AddStrP(PSTR("tape_status"),
                 status == 0x00 ? PSTR("STOPPED") :
                 status == 0x04 ? PSTR("LOADING") :
                 status == 0x0C ? PSTR("PLAY") :
@@ -1562,16 +1409,15 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
                 status == 0x14 ? PSTR("NEXT_TRACK") :
                 status == 0x30 ? PSTR("REWIND") :
                 status == 0x34 ? PSTR("PREVIOUS_TRACK") :
-                ToHexStr(status),
-
-                status == 0x00 ? onStr : offStr,
-                status == 0x04 ? onStr : offStr,
-                status == 0x0C ? onStr : offStr,
-                status == 0x10 ? onStr : offStr,
-                status == 0x14 ? onStr : offStr,
-                status == 0x30 ? onStr : offStr,
-                status == 0x34 ? onStr : offStr
-            );
+                ToHexStr(status));
+
+            json.AddStrP(PSTR("tape_status_stopped"), status == 0x00 ? onStr : offStr);
+            json.AddStrP(PSTR("tape_status_loading"), status == 0x04 ? onStr : offStr);
+            json.AddStrP(PSTR("tape_status_play"), status == 0x0C ? onStr : offStr);
+            json.AddStrP(PSTR("tape_status_fast_forward"), status == 0x10 ? onStr : offStr);
+            json.AddStrP(PSTR("tape_status_next_track"), status == 0x14 ? onStr : offStr);
+            json.AddStrP(PSTR("tape_status_rewind"), status == 0x30 ? onStr : offStr);
+            json.AddStrP(PSTR("tape_status_previous_track"), status == 0x34 ? onStr : offStr);
         }
         break;
 
@@ -1588,21 +1434,14 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
             strncpy(rdsOrFreqTxt, (const char*) data + 3, 8);
             rdsOrFreqTxt[8] = 0;
 
-            const static char jsonFormatter[] PROGMEM =
-            "{\n"
-                "\"event\": \"display\",\n"
-                "\"data\":\n"
-                "{\n"
-                    "\"radio_preset_%S_%u\": \"%s%S\"\n"
-                "}\n"
-            "}\n";
-
-            at = snprintf_P(buf, n, jsonFormatter,
-                TunerBandStr(tunerBand),
-                tunerMemory,
-                rdsOrFreqTxt,
-                tunerBand == TB_AM ? PSTR(" KHz") : data[2] & 0x80 ? emptyStr : PSTR(" MHz")
-            );
+            char key[30];
+            sprintf_P(key, PSTR("radio_preset_%S_%u"), TunerBandStr(tunerBand), tunerMemory);
+
+            BeginDisplayEvent(json);
+            json.BeginValue(key)
+                .Str(rdsOrFreqTxt)
+                .StrP(tunerBand == TB_AM ? PSTR(" KHz") : data[2] & 0x80 ? emptyStr : PSTR(" MHz"))
+                .EndValue();
         }
         break;
 
@@ -1618,6 +1457,9 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
 
             bool searching = data[3] & 0x10;
 
+            char currentTrackStr[3];
+            sprintf_P(currentTrackStr, PSTR("%X"), data[7]);
+
             uint8_t totalTracks = data[8];
             bool totalTracksInvalid = totalTracks == 0xFF;
             char totalTracksStr[3];
@@ -1633,27 +1475,9 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
                 if (! totalTimeInvalid) sprintf_P(totalTimeStr, PSTR("%X:%02X"), totalTimeMin, totalTimeSec);
             } // if
 
-            const static char jsonFormatter[] PROGMEM =
-            "{\n"
-                "\"event\": \"display\",\n"
-                "\"data\":\n"
-                "{\n"
-                    "\"cd_status\": \"%S\",\n"
-                    "\"cd_status_inserted\": \"%S\",\n"
-                    "\"cd_status_pause\": \"%S\",\n"
-                    "\"cd_status_play\": \"%S\",\n"
-                    "\"cd_status_fast_forward\": \"%S\",\n"
-                    "\"cd_status_rewind\": \"%S\",\n"
-                    "\"cd_status_searching\": \"%S\",\n"
-                    "\"cd_track_time\": \"%S\",\n"
-                    "\"cd_current_track\": \"%X\",\n"
-                    "\"cd_total_tracks\": \"%S\",\n"
-                    "\"cd_total_time\": \"%S\"\n"
-                "}\n"
-            "}\n";
-
-            at = snprintf_P(buf, n, jsonFormatter,
+            BeginDisplayEvent(json);
 
+            json.AddStrP(PSTR("cd_status"),
                 data[3] == 0x11 ? PSTR("INSERTED") :
                 data[3] == 0x12 ? PSTR("PAUSE-SEARCHING") :
                 data[3] == 0x13 ? PSTR("PLAY-SEARCHING") :
@@ -1661,22 +1485,21 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
                 data[3] == 0x03 ? PSTR("PLAY") :
                 data[3] == 0x04 ? PSTR("FAST_FORWARD") :
                 data[3] == 0x05 ? PSTR("REWIND") :
-                ToHexStr(data[3]),
+                ToHexStr(data[3]));
 
-                (data[3] & 0x0F) == 0x01 ? onStr : offStr,
-                (data[3] & 0x0F) == 0x02 ? onStr : offStr,
-                (data[3] & 0x0F) == 0x03 ? onStr : offStr,
-                (data[3] & 0x0F) == 0x04 ? onStr : offStr,
-                (data[3] & 0x0F) == 0x05 ? onStr : offStr,
+            json.AddStrP(PSTR("cd_status_inserted"), (data[3] & 0x0F) == 0x01 ? onStr : offStr);
+            json.AddStrP(PSTR("cd_status_pause"), (data[3] & 0x0F) == 0x02 ? onStr : offStr);
+            json.AddStrP(PSTR("cd_status_play"), (data[3] & 0x0F) == 0x03 ? onStr : offStr);
+            json.AddStrP(PSTR("cd_status_fast_forward"), (data[3] & 0x0F) == 0x04 ? onStr : offStr);
+            json.AddStrP(PSTR("cd_status_rewind"), (data[3] & 0x0F) == 0x05 ? onStr : offStr);
 
-                searching ? onStr : offStr,
+            json.AddStrP(PSTR("cd_status_searching"), searching ? onStr : offStr);
 
-                searching ? PSTR("--:--") : trackTimeStr,
+            json.AddStrP(PSTR("cd_track_time"), searching ? PSTR("--:--") : trackTimeStr);
 
-                data[7],
-                totalTracksInvalid ? notApplicable2Str : totalTracksStr,
-                totalTimeInvalid ? PSTR("--:--") : totalTimeStr
-            );
+            json.AddStr(PSTR("cd_current_track"), currentTrackStr);
+            json.AddStrP(PSTR("cd_total_tracks"), totalTracksInvalid ? notApplicable2Str : totalTracksStr);
+            json.AddStrP(PSTR("cd_total_time"), totalTimeInvalid ? PSTR("--:--") : totalTimeStr);
         }
         break;
 
@@ -1693,10 +1516,7 @@ VanPacketParseResult_t ParseHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& p
         break;
     } // switch
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseHeadUnitPkt
 
 VanPacketParseResult_t ParseTimePkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1710,26 +1530,14 @@ VanPacketParseResult_t ParseTimePkt(const char* idenStr, TVanPacketRxDesc& pkt,
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"uptime_battery\": \"%u\",\n"
-            "\"uptime\": \"%uh%um\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-        (uint16_t)data[0] << 8 | data[1],
-        data[3],
-        data[4]
-    );
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+    if (IsChanged(DATA_BYTES(0, 1))) json.AddUInt(PSTR("uptime_battery"), (uint16_t)data[0] << 8 | data[1]);
+    if (IsChanged(DATA_BYTES(3, 4)))
+    {
+        json.BeginValue(PSTR("uptime")).UInt(data[3]).Char('h').UInt(data[4]).Char('m').EndValue();
+    } // if
+    return EndDisplayEvent(json);
 } // ParseTimePkt
 
 VanPacketParseResult_t ParseAudioSettingsPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1741,48 +1549,15 @@ VanPacketParseResult_t ParseAudioSettingsPkt(const char* idenStr, TVanPacketRxDe
     const uint8_t* data = pkt.Data();
     uint8_t volume = data[5] & 0x7F;
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"power\": \"%S\",\n"
-            "\"tape_present\": \"%S\",\n"
-            "\"cd_present\": \"%S\",\n"
-            "\"audio_source\": \"%S\",\n"
-            "\"ext_mute\": \"%S\",\n"
-            "\"mute\": \"%S\",\n"
-            "\"volume\": \"%u\",\n"
-            "\"volume_update\": \"%S\",\n"
-            "\"volume_perc\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"transform\": \"scaleX(%S)\"\n"
-                "}\n"
-            "},\n"
-            "\"audio_menu\": \"%S\",\n"
-            "\"bass\": \"%+d\",\n"
-            "\"bass_update\": \"%S\",\n"
-            "\"treble\": \"%+d\",\n"
-            "\"treble_update\": \"%S\",\n"
-            "\"loudness\": \"%S\",\n"
-            "\"fader\": \"%+d\",\n"
-            "\"fader_update\": \"%S\",\n"
-            "\"balance\": \"%+d\",\n"
-            "\"balance_update\": \"%S\",\n"
-            "\"auto_volume\": \"%S\"\n"
-        "}\n"
-    "}\n";
-
-    char floatBuf[MAX_FLOAT_SIZE];
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-        data[2] & 0x01 ? onStr : offStr,  // Power
-        data[4] & 0x20 ? yesStr : noStr,  // Tape present
-        data[4] & 0x40 ? yesStr : noStr,  // CD present
-
-        (data[4] & 0x0F) == 0x00 ? noneStr :  // Source of audio
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+
+    json.AddStrP(PSTR("power"), data[2] & 0x01 ? onStr : offStr);
+    json.AddStrP(PSTR("tape_present"), data[4] & 0x20 ? yesStr : noStr);
+    json.AddStrP(PSTR("cd_present"), data[4] & 0x40 ? yesStr : noStr);
+
+    json.AddStrP(PSTR("audio_source"),
+        (data[4] & 0x0F) == 0x00 ? noneStr :
         (data[4] & 0x0F) == 0x01 ? PSTR("TUNER") :
         (data[4] & 0x0F) == 0x02 ?
             data[4] & 0x20 ? PSTR("TAPE") :
@@ -1795,40 +1570,37 @@ VanPacketParseResult_t ParseAudioSettingsPkt(const char* idenStr, TVanPacketRxDe
         // whenever this source is chosen.
         (data[4] & 0x0F) == 0x05 ? PSTR("NAVIGATION") :
 
-        ToHexStr((uint8_t)(data[4] & 0x0F)),
+        ToHexStr((uint8_t)(data[4] & 0x0F))
+    );
 
-        // External mute. Activated when head unit ISO connector A pin 1 ("Phone mute") is pulled LOW (to Ground).
-        data[1] & 0x02 ? onStr : offStr,
+    // External mute. Activated when head unit ISO connector A pin 1 ("Phone mute") is pulled LOW (to Ground).
+    json.AddStrP(PSTR("ext_mute"), data[1] & 0x02 ? onStr : offStr);
 
-        // Mute. To activate: press both VOL_UP and VOL_DOWN buttons on stalk.
-        data[1] & 0x01 ? onStr : offStr,
+    // Mute. To activate: press both VOL_UP and VOL_DOWN buttons on stalk.
+    json.AddStrP(PSTR("mute"), data[1] & 0x01 ? onStr : offStr);
 
-        volume,
-        data[5] & 0x80 ? yesStr : noStr,
+    json.AddUInt(PSTR("volume"), volume);
+    json.AddStrP(PSTR("volume_update"), data[5] & 0x80 ? yesStr : noStr);
 
-        // TODO - hard coded value 30 for 100%
-        #define MAX_AUDIO_VOLUME (30)
-        FloatToStr(floatBuf, (float)volume / MAX_AUDIO_VOLUME, 2),
+    // TODO - hard coded value 30 for 100%
+    #define MAX_AUDIO_VOLUME (30)
+    AddScaleX(json, PSTR("volume_perc"), RoundedDiv(volume * 100L, MAX_AUDIO_VOLUME));
 
-        // Audio menu. Bug: if CD changer is playing, this one is always "OPEN" (even if it isn't).
-        data[1] & 0x20 ? openStr : closedStr,
+    // Audio menu. Bug: if CD changer is playing, this one is always "OPEN" (even if it isn't).
+    json.AddStrP(PSTR("audio_menu"), data[1] & 0x20 ? openStr : closedStr);
 
-        (sint8_t)(data[8] & 0x7F) - 0x3F,  // Bass
-        data[8] & 0x80 ? yesStr : noStr,
-        (sint8_t)(data[9] & 0x7F) - 0x3F,  // Treble
-        data[9] & 0x80 ? yesStr : noStr,
-        data[1] & 0x10 ? onStr : offStr,  // Loudness
-        (sint8_t)(0x3F) - (data[7] & 0x7F),  // Fader
-        data[7] & 0x80 ? yesStr : noStr,
-        (sint8_t)(0x3F) - (data[6] & 0x7F),  // Balance
-        data[6] & 0x80 ? yesStr : noStr,
-        data[1] & 0x04 ? onStr : offStr  // Auto volume
-    );
+    AddSignedInt(json, PSTR("bass"), (sint8_t)(data[8] & 0x7F) - 0x3F);
+    json.AddStrP(PSTR("bass_update"), data[8] & 0x80 ? yesStr : noStr);
+    AddSignedInt(json, PSTR("treble"), (sint8_t)(data[9] & 0x7F) - 0x3F);
+    json.AddStrP(PSTR("treble_update"), data[9] & 0x80 ? yesStr : noStr);
+    json.AddStrP(PSTR("loudness"), data[1] & 0x10 ? onStr : offStr);
+    AddSignedInt(json, PSTR("fader"), (sint8_t)(0x3F) - (data[7] & 0x7F));
+    json.AddStrP(PSTR("fader_update"), data[7] & 0x80 ? yesStr : noStr);
+    AddSignedInt(json, PSTR("balance"), (sint8_t)(0x3F) - (data[6] & 0x7F));
+    json.AddStrP(PSTR("balance_update"), data[6] & 0x80 ? yesStr : noStr);
+    json.AddStrP(PSTR("auto_volume"), data[1] & 0x04 ? onStr : offStr);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseAudioSettingsPkt
 
 VanPacketParseResult_t ParseMfdStatusPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1839,30 +1611,23 @@ VanPacketParseResult_t ParseMfdStatusPkt(const char* idenStr, TVanPacketRxDesc&
     const uint8_t* data = pkt.Data();
     uint16_t mfdStatus = (uint16_t)data[0] << 8 | data[1];
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"mfd_status\": \"MFD_SCREEN_%S\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-        // hmmm... MFD can also be ON if this is reported; this happens e.g. in the "minimal VAN network" test
-        // setup with only the head unit (radio) and MFD. Maybe this is a status report: the MFD shows if has
-        // received any packets that show connectivity to e.g. the BSI?
-        data[0] == 0x00 && data[1] == 0xFF ? offStr :
+    json.BeginValue(PSTR("mfd_status"))
+        .StrP(PSTR("MFD_SCREEN_"))
+        .StrP(
 
-        data[0] == 0x20 && data[1] == 0xFF ? onStr :
-        ToHexStr(mfdStatus)
-    );
+            // hmmm... MFD can also be ON if this is reported; this happens e.g. in the "minimal VAN network" test
+            // setup with only the head unit (radio) and MFD. Maybe this is a status report: the MFD shows if has
+            // received any packets that show connectivity to e.g. the BSI?
+            data[0] == 0x00 && data[1] == 0xFF ? offStr :
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+            data[0] == 0x20 && data[1] == 0xFF ? onStr :
+            ToHexStr(mfdStatus))
+        .EndValue();
 
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseMfdStatusPkt
 
 VanPacketParseResult_t ParseAirCon1Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -1955,31 +1720,16 @@ VanPacketParseResult_t ParseAirCon1Pkt(const char* idenStr, TVanPacketRxDesc& pk
         setFanSpeed == 3 ? 1 : // All empty blades (1)
         0; // Fan icon not visible at all
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"ac_icon\": \"%S\",\n"
-            "\"recirc\": \"%S\",\n"
-            "\"rear_heater_1\": \"%S\",\n"
-            "\"reported_fan_speed\": \"%u\",\n"
-            "\"set_fan_speed\": \"%u\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-        ac_icon ? onStr : offStr,
-        data[0] & 0x04 ? onStr : offStr,
-        rear_heater ? yesStr : noStr,
-        data[4],
-        setFanSpeed
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    json.AddStrP(PSTR("ac_icon"), ac_icon ? onStr : offStr);
+    json.AddStrP(PSTR("recirc"), data[0] & 0x04 ? onStr : offStr);
+    json.AddStrP(PSTR("rear_heater_1"), rear_heater ? yesStr : noStr);
+    json.AddUInt(PSTR("reported_fan_speed"), data[4]);
+    json.AddUInt(PSTR("set_fan_speed"), setFanSpeed);
 
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseAirCon1Pkt
 
 VanPacketParseResult_t ParseAirCon2Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2001,46 +1751,31 @@ VanPacketParseResult_t ParseAirCon2Pkt(const char* idenStr, TVanPacketRxDesc& pk
     memcpy(packetData[0], packetData[1], dataLen);
     memcpy(packetData[1], data, dataLen);
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"contact_key_on\": \"%S\",\n"
-            "\"ac_enabled\": \"%S\",\n"
-            "\"rear_heater_2\": \"%S\",\n"
-            "\"ac_compressor\": \"%S\",\n"
-            "\"contact_key_position_ac\": \"%S\",\n"
-            "\"condenser_temperature\": \"%S\",\n"
-            "\"evaporator_temperature\": \"%s\"\n"
-        "}\n"
-    "}\n";
-
-    char floatBuf[2][MAX_FLOAT_SIZE];
-    int at = snprintf_P(buf, n, jsonFormatter,
-        data[0] & 0x80 ? yesStr : noStr,
-        data[0] & 0x40 ? yesStr : noStr,
-        data[0] & 0x20 ? onStr : offStr,
-        data[0] & 0x01 ? onStr : offStr,
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
+    json.AddStrP(PSTR("contact_key_on"), data[0] & 0x80 ? yesStr : noStr);
+    json.AddStrP(PSTR("ac_enabled"), data[0] & 0x40 ? yesStr : noStr);
+    json.AddStrP(PSTR("rear_heater_2"), data[0] & 0x20 ? onStr : offStr);
+    json.AddStrP(PSTR("ac_compressor"), data[0] & 0x01 ? onStr : offStr);
+
+    json.AddStrP(PSTR("contact_key_position_ac"),
         data[1] == 0x1C ? PSTR("ACC_OR_OFF") :
         data[1] == 0x18 ? PSTR("ACC-->OFF") :
         data[1] == 0x04 ? PSTR("ON-->ACC") :
         data[1] == 0x00 ? onStr :
-        ToHexStr(data[1]),
-
-        // This is not interior temperature. This rises quite rapidly if the aircon compressor is
-        // running, and drops again when the aircon compressor is off. So I think this is the condenser
-        // temperature.
-        data[2] == 0xFF ? notApplicable2Str : FloatToStr(floatBuf[0], data[2], 0),
-
-        FloatToStr(floatBuf[1], ((uint16_t)data[3] << 8 | data[4]) / 10.0 - 40.0, 1)
+        ToHexStr(data[1])
     );
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    // This is not interior temperature. This rises quite rapidly if the aircon compressor is
+    // running, and drops again when the aircon compressor is off. So I think this is the condenser
+    // temperature.
+    if (data[2] == 0xFF) json.AddStrP(PSTR("condenser_temperature"), notApplicable2Str);
+    else json.AddUInt(PSTR("condenser_temperature"), data[2]);
 
-    return VAN_PACKET_PARSE_OK;
+    json.AddFixed(PSTR("evaporator_temperature"), ((uint16_t)data[3] << 8 | data[4]) - 400, 1);
+
+    return EndDisplayEvent(json);
 } // ParseAirCon2Pkt
 
 VanPacketParseResult_t ParseCdChangerPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2066,37 +1801,18 @@ VanPacketParseResult_t ParseCdChangerPkt(const char* idenStr, TVanPacketRxDesc&
     char totalTracksStr[3];
     if (! totalTracksInvalid) sprintf_P(totalTracksStr, PSTR("%X"), totalTracks);
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"cd_changer_random\": \"%S\",\n"
-            "\"cd_changer_status\": \"%S\",\n"
-            "\"cd_changer_status_pause\": \"%S\",\n"
-            "\"cd_changer_status_play\": \"%S\",\n"
-            "\"cd_changer_status_fast_forward\": \"%S\",\n"
-            "\"cd_changer_status_rewind\": \"%S\",\n"
-            "\"cd_changer_status_search\": \"%S\",\n"
-            "\"cd_changer_status_next_track\": \"%S\",\n"
-            "\"cd_changer_status_previous_track\": \"%S\",\n"
-            "\"cd_changer_cartridge_present\": \"%S\",\n"
-            "\"cd_changer_track_time\": \"%S\",\n"
-            "\"cd_changer_current_track\": \"%X\",\n"
-            "\"cd_changer_total_tracks\": \"%S\",\n"
-            "\"cd_changer_current_cd\": \"%X\",\n"
-            "\"cd_changer_disc_1_present\": \"%S\",\n"
-            "\"cd_changer_disc_2_present\": \"%S\",\n"
-            "\"cd_changer_disc_3_present\": \"%S\",\n"
-            "\"cd_changer_disc_4_present\": \"%S\",\n"
-            "\"cd_changer_disc_5_present\": \"%S\",\n"
-            "\"cd_changer_disc_6_present\": \"%S\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-        data[1] == 0x01 ? onStr : offStr,
+    char currentTrackStr[3];
+    sprintf_P(currentTrackStr, PSTR("%X"), data[6]);
+
+    char currentCdStr[3];
+    sprintf_P(currentCdStr, PSTR("%X"), data[7]);
+
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
+    json.AddStrP(PSTR("cd_changer_random"), data[1] == 0x01 ? onStr : offStr);
+
+    json.AddStrP(PSTR("cd_changer_status"),
         data[2] == 0x40 ? PSTR("POWER_OFF") :  // Not sure
         data[2] == 0x41 ? PSTR("POWER_ON") : // Not sure
         data[2] == 0x49 ? PSTR("INITIALIZE") :  // Not sure
@@ -2108,39 +1824,36 @@ VanPacketParseResult_t ParseCdChangerPkt(const char* idenStr, TVanPacketRxDesc&
         data[2] == 0xD3 ? PSTR("SEARCH") :
         data[2] == 0xD4 ? PSTR("NEXT_TRACK") :  // Not sure
         data[2] == 0xD5 ? PSTR("PREVIOUS_TRACK") :  // Not sure
-        ToHexStr(data[2]),
+        ToHexStr(data[2])
+    );
 
-        data[2] == 0xC1 ? onStr : offStr,
-        data[2] == 0xC3 ? onStr : offStr,
-        data[2] == 0xC4 ? onStr : offStr,
-        data[2] == 0xC5 ? onStr : offStr,
-        data[2] == 0xD3 ? onStr : offStr,
-        data[2] == 0xD4 ? onStr : offStr,
-        data[2] == 0xD5 ? onStr : offStr,
+    json.AddStrP(PSTR("cd_changer_status_pause"), data[2] == 0xC1 ? onStr : offStr);
+    json.AddStrP(PSTR("cd_changer_status_play"), data[2] == 0xC3 ? onStr : offStr);
+    json.AddStrP(PSTR("cd_changer_status_fast_forward"), data[2] == 0xC4 ? onStr : offStr);
+    json.AddStrP(PSTR("cd_changer_status_rewind"), data[2] == 0xC5 ? onStr : offStr);
+    json.AddStrP(PSTR("cd_changer_status_search"), data[2] == 0xD3 ? onStr : offStr);
+    json.AddStrP(PSTR("cd_changer_status_next_track"), data[2] == 0xD4 ? onStr : offStr);
+    json.AddStrP(PSTR("cd_changer_status_previous_track"), data[2] == 0xD5 ? onStr : offStr);
 
+    json.AddStrP(PSTR("cd_changer_cartridge_present"),
         data[3] == 0x16 ? yesStr :
         data[3] == 0x06 ? noStr :
-        ToHexStr(data[3]),
-
-        trackTimeInvalid ? PSTR("--:--") : trackTimeStr,
-
-        data[6],
-        totalTracksInvalid ? notApplicable2Str : totalTracksStr,
-
-        data[7],
-
-        data[10] & 0x01 ? yesStr : noStr,
-        data[10] & 0x02 ? yesStr : noStr,
-        data[10] & 0x04 ? yesStr : noStr,
-        data[10] & 0x08 ? yesStr : noStr,
-        data[10] & 0x10 ? yesStr : noStr,
-        data[10] & 0x20 ? yesStr : noStr
+        ToHexStr(data[3])
     );
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    json.AddStrP(PSTR("cd_changer_track_time"), trackTimeInvalid ? PSTR("--:--") : trackTimeStr);
+    json.AddStr(PSTR("cd_changer_current_track"), currentTrackStr);
+    json.AddStrP(PSTR("cd_changer_total_tracks"), totalTracksInvalid ? notApplicable2Str : totalTracksStr);
+    json.AddStr(PSTR("cd_changer_current_cd"), currentCdStr);
 
-    return VAN_PACKET_PARSE_OK;
+    json.AddStrP(PSTR("cd_changer_disc_1_present"), data[10] & 0x01 ? yesStr : noStr);
+    json.AddStrP(PSTR("cd_changer_disc_2_present"), data[10] & 0x02 ? yesStr : noStr);
+    json.AddStrP(PSTR("cd_changer_disc_3_present"), data[10] & 0x04 ? yesStr : noStr);
+    json.AddStrP(PSTR("cd_changer_disc_4_present"), data[10] & 0x08 ? yesStr : noStr);
+    json.AddStrP(PSTR("cd_changer_disc_5_present"), data[10] & 0x10 ? yesStr : noStr);
+    json.AddStrP(PSTR("cd_changer_disc_6_present"), data[10] & 0x20 ? yesStr : noStr);
+
+    return EndDisplayEvent(json);
 } // ParseCdChangerPkt
 
 VanPacketParseResult_t ParseSatNavStatus1Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2151,51 +1864,44 @@ VanPacketParseResult_t ParseSatNavStatus1Pkt(const char* idenStr, TVanPacketRxDe
     const uint8_t* data = pkt.Data();
     uint16_t status = (uint16_t)data[1] << 8 | data[2];
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"satnav_status_1\": \"%S%S\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-
-        // TODO - check; total guess
-        status == 0x0000 ? PSTR("NOT_OPERATING") :
-        status == 0x0001 ? ToHexStr(status) :  // Seen this but what is it??
-        status == 0x0020 ? ToHexStr(status) :  // Seen this but what is it?? Nearly at destination ??
-        status == 0x0080 ? PSTR("READY") :
-        status == 0x0101 ? ToHexStr(status) :  // Seen this but what is it??
-        status == 0x0200 ? PSTR("READING_DISC_1") :
-        status == 0x0220 ? ToHexStr(status) :  // Seen this but what is it??
-        status == 0x0300 ? PSTR("IN_GUIDANCE_MODE_1") :
-        status == 0x0301 ? PSTR("IN_GUIDANCE_MODE_2") :
-        status == 0x0320 ? PSTR("STOPPING_GUIDANCE") :
-        status == 0x0400 ? PSTR("START_OF_AUDIO_MESSAGE") :
-        status == 0x0410 ? PSTR("ARRIVED_AT_DESTINATION_1") :
-        status == 0x0600 ? ToHexStr(status) :  // Seen this but what is it??
-        status == 0x0700 ? PSTR("INSTRUCTION_AUDIO_MESSAGE_START_1") :
-        status == 0x0701 ? PSTR("INSTRUCTION_AUDIO_MESSAGE_START_2") :
-        status == 0x0800 ? PSTR("END_OF_AUDIO_MESSAGE") :  // Follows 0x0400, 0x0700, 0x0701
-        status == 0x4000 ? PSTR("GUIDANCE_STOPPED") :
-        status == 0x4001 ? ToHexStr(status) :  // Seen this but what is it??
-        status == 0x4200 ? PSTR("ARRIVED_AT_DESTINATION_2") :
-        status == 0x9000 ? PSTR("READING_DISC_2") :
-        status == 0x9080 ? ToHexStr(status) :  // Seen this but what is it??
-        ToHexStr(data[1], data[2]),
-
-        data[4] == 0x0B ? PSTR(" reason=0x0B") :  // Seen with status == 0x4001
-        data[4] == 0x0C ? PSTR(" reason=NO_DISC") :
-        data[4] == 0x0E ? PSTR(" reason=NO_DISC") :
-        emptyStr
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    json.BeginValue(PSTR("satnav_status_1"))
+        .StrP(
 
-    return VAN_PACKET_PARSE_OK;
+            // TODO - check; total guess
+            status == 0x0000 ? PSTR("NOT_OPERATING") :
+            status == 0x0001 ? ToHexStr(status) :  // Seen this but what is it??
+            status == 0x0020 ? ToHexStr(status) :  // Seen this but what is it?? Nearly at destination ??
+            status == 0x0080 ? PSTR("READY") :
+            status == 0x0101 ? ToHexStr(status) :  // Seen this but what is it??
+            status == 0x0200 ? PSTR("READING_DISC_1") :
+            status == 0x0220 ? ToHexStr(status) :  // Seen this but what is it??
+            status == 0x0300 ? PSTR("IN_GUIDANCE_MODE_1") :
+            status == 0x0301 ? PSTR("IN_GUIDANCE_MODE_2") :
+            status == 0x0320 ? PSTR("STOPPING_GUIDANCE") :
+            status == 0x0400 ? PSTR("START_OF_AUDIO_MESSAGE") :
+            status == 0x0410 ? PSTR("ARRIVED_AT_DESTINATION_1") :
+            status == 0x0600 ? ToHexStr(status) :  // Seen this but what is it??
+            status == 0x0700 ? PSTR("INSTRUCTION_AUDIO_MESSAGE_START_1") :
+            status == 0x0701 ? PSTR("INSTRUCTION_AUDIO_MESSAGE_START_2") :
+            status == 0x0800 ? PSTR("END_OF_AUDIO_MESSAGE") :  // Follows 0x0400, 0x0700, 0x0701
+            status == 0x4000 ? PSTR("GUIDANCE_STOPPED") :
+            status == 0x4001 ? ToHexStr(status) :  // Seen this but what is it??
+            status == 0x4200 ? PSTR("ARRIVED_AT_DESTINATION_2") :
+            status == 0x9000 ? PSTR("READING_DISC_2") :
+            status == 0x9080 ? ToHexStr(status) :  // Seen this but what is it??
+            ToHexStr(data[1], data[2]))
+
+        .StrP(
+            data[4] == 0x0B ? PSTR(" reason=0x0B") :  // Seen with status == 0x4001
+            data[4] == 0x0C ? PSTR(" reason=NO_DISC") :
+            data[4] == 0x0E ? PSTR(" reason=NO_DISC") :
+            emptyStr)
+        .EndValue();
+
+    return EndDisplayEvent(json);
 } // ParseSatNavStatus1Pkt
 
 VanPacketParseResult_t ParseSatNavStatus2Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2205,20 +1911,10 @@ VanPacketParseResult_t ParseSatNavStatus2Pkt(const char* idenStr, TVanPacketRxDe
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"satnav_status_2\": \"%S\",\n"
-            "\"satnav_disc_present\": \"%S\",\n"
-            "\"satnav_gps_fix\": \"%S\",\n"
-            "\"satnav_gps_fix_lost\": \"%S\",\n"
-            "\"satnav_gps_scanning\": \"%S\",\n"
-            "\"satnav_gps_speed\": \"%S%u\"";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
+    json.AddStrP(PSTR("satnav_status_2"),
         data[1] == 0x11 ? PSTR("STOPPING_GUIDANCE") :
         data[1] == 0x15 ? PSTR("IN_GUIDANCE_MODE") :
         data[1] == 0x20 ? PSTR("IDLE_NOT_READY") :
@@ -2226,49 +1922,40 @@ VanPacketParseResult_t ParseSatNavStatus2Pkt(const char* idenStr, TVanPacketRxDe
         data[1] == 0x25 ? PSTR("CALCULATING_ROUTE") :
         data[1] == 0x41 ? ToHexStr(data[1]) :  // Seen this but what is it??
         data[1] == 0xC1 ? PSTR("FINISHED_DOWNLOADING") :
-        ToHexStr(data[1]),
+        ToHexStr(data[1])
+    );
 
+    json.AddStrP(PSTR("satnav_disc_present"),
         (data[2] & 0x70) == 0x70 ? noStr :
         (data[2] & 0x70) == 0x30 ? yesStr :
-        ToHexStr((uint8_t)(data[2] & 0x70)),
+        ToHexStr((uint8_t)(data[2] & 0x70))
+    );
 
-        data[2] & 0x01 ? yesStr : noStr,
-        data[2] & 0x02 ? yesStr : noStr,
-        data[2] & 0x04 ? yesStr : noStr,
+    json.AddStrP(PSTR("satnav_gps_fix"), data[2] & 0x01 ? yesStr : noStr);
+    json.AddStrP(PSTR("satnav_gps_fix_lost"), data[2] & 0x02 ? yesStr : noStr);
+    json.AddStrP(PSTR("satnav_gps_scanning"), data[2] & 0x04 ? yesStr : noStr);
 
-        // 0xE0 as boundary for "reverse": just guessing. Do we ever drive faster than 224 km/h?
-        data[16] >= 0xE0 ? PSTR("-") : emptyStr,
-        data[16] < 0xE0 ? data[16] : 0xFF - data[16] + 1
-    );
+    // 0xE0 as boundary for "reverse": just guessing. Do we ever drive faster than 224 km/h?
+    json.AddInt(PSTR("satnav_gps_speed"), data[16] < 0xE0 ? data[16] : (int)data[16] - 0xFF - 1);
 
     // TODO - what is this?
     uint16_t zzz = (uint16_t)data[9] << 8 | data[10];
-    if (zzz != 0x00)
-    {
-        at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR(",\n\"satnav_zzz\": \"%u\""), zzz);
-    } // if
+    if (zzz != 0x00) json.AddUInt(PSTR("satnav_zzz"), zzz);
 
     if (data[17] != 0x00)
     {
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"satnav_disc_status\": \"%S%S%S%S%S%S%S\""),
-
-                data[17] & 0x01 ? PSTR("LOADING_AUDIO_FRAGMENT ") : emptyStr,
-                data[17] & 0x02 ? PSTR("AUDIO_OUTPUT ") : emptyStr,
-                data[17] & 0x04 ? PSTR("NEW_GUIDANCE_INSTRUCTION ") : emptyStr,
-                data[17] & 0x08 ? PSTR("READING_DISC ") : emptyStr,
-                data[17] & 0x10 ? PSTR("CALCULATING_ROUTE ") : emptyStr,
-                data[17] & 0x20 ? PSTR("DISC_PRESENT ") : emptyStr,
-                data[17] & 0x80 ? PSTR("REACHED_DESTINATION ") : emptyStr
-            );
+        json.BeginValue(PSTR("satnav_disc_status"))
+            .StrP(data[17] & 0x01 ? PSTR("LOADING_AUDIO_FRAGMENT ") : emptyStr)
+            .StrP(data[17] & 0x02 ? PSTR("AUDIO_OUTPUT ") : emptyStr)
+            .StrP(data[17] & 0x04 ? PSTR("NEW_GUIDANCE_INSTRUCTION ") : emptyStr)
+            .StrP(data[17] & 0x08 ? PSTR("READING_DISC ") : emptyStr)
+            .StrP(data[17] & 0x10 ? PSTR("CALCULATING_ROUTE ") : emptyStr)
+            .StrP(data[17] & 0x20 ? PSTR("DISC_PRESENT ") : emptyStr)
+            .StrP(data[17] & 0x80 ? PSTR("REACHED_DESTINATION ") : emptyStr)
+            .EndValue();
     } // if
 
-    at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseSatNavStatus2Pkt
 
 VanPacketParseResult_t ParseSatNavStatus3Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2280,22 +1967,16 @@ VanPacketParseResult_t ParseSatNavStatus3Pkt(const char* idenStr, TVanPacketRxDe
     if (dataLen != 2 && dataLen != 3 && dataLen != 17) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
     const uint8_t* data = pkt.Data();
-    int at = 0;
+
+    TVanJsonWriter json(buf, n);
 
     if (dataLen == 2)
     {
         uint16_t status = (uint16_t)data[0] << 8 | data[1];
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"satnav_status_3\": \"%S\"\n"
-            "}\n"
-        "}\n";
+        BeginDisplayEvent(json);
 
-        at = snprintf_P(buf, n, jsonFormatter,
+        json.AddStrP(PSTR("satnav_status_3"),
 
             // TODO - check; total guess
             status == 0x0000 ? PSTR("CALCULATING_ROUTE") :
@@ -2312,37 +1993,28 @@ VanPacketParseResult_t ParseSatNavStatus3Pkt(const char* idenStr, TVanPacketRxDe
     {
         // Some set of ID strings. Stays the same even when the navigation CD is changed.
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"satnav_system_id\":\n"
-                "[";
-
-        at = snprintf_P(buf, n, jsonFormatter);
+        BeginDisplayEvent(json);
+        json.BeginArray(PSTR("satnav_system_id"));
 
         char txt[VAN_MAX_DATA_BYTES - 1 + 1];  // Max 28 data bytes, minus header (1), plus terminating '\0'
 
-        bool first = true;
         int at2 = 1;
         while (at2 < dataLen)
         {
             strncpy(txt, (const char*) data + at2, dataLen - at2);
             txt[dataLen - at2] = 0;
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at, PSTR("%S\n\"%s\""), first ? emptyStr : commaStr, txt);
+            json.BeginValue().Str(txt).EndValue();
             at2 += strlen(txt) + 1;
-            first = false;
         } // while
 
-        at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n]\n}\n}\n"));
+        json.EndArray();
+    }
+    else
+    {
+        return VAN_PACKET_NO_CONTENT;
     } // if
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseSatNavStatus3Pkt
 
 VanPacketParseResult_t ParseSatNavGuidanceDataPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2362,64 +2034,31 @@ VanPacketParseResult_t ParseSatNavGuidanceDataPkt(const char* idenStr, TVanPacke
     // TODO - Not sure, just guessing. could also be number of instructions still to be done
     uint16_t minutesToTravel = (uint16_t)data[13] << 8 | data[14];
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"satnav_curr_heading\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"transform\": \"rotate(%udeg)\"\n"
-                "}\n"
-            "},\n"
-            "\"satnav_curr_heading_as_text\": \"%u deg\",\n"
-            "\"satnav_heading_to_dest\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"transform\": \"rotate(%udeg)\"\n"
-                "}\n"
-            "},\n"
-            "\"satnav_heading_to_dest_as_text\": \"%u deg\",\n"
-            "\"satnav_distance_to_dest_via_road\": \"%u\",\n"
-            "\"satnav_distance_to_dest_via_road_m\": \"%S\",\n"
-            "\"satnav_distance_to_dest_via_road_km\": \"%S\",\n"
-            "\"satnav_distance_to_dest_via_straight_line\": \"%u\",\n"
-            "\"satnav_distance_to_dest_via_straight_line_m\": \"%S\",\n"
-            "\"satnav_distance_to_dest_via_straight_line_km\": \"%S\",\n"
-            "\"satnav_turn_at\": \"%u\",\n"
-            "\"satnav_turn_at_m\": \"%S\",\n"
-            "\"satnav_turn_at_km\": \"%S\",\n"
-            "\"satnav_heading_on_roundabout_as_text\": \"%S deg\",\n"
-            "\"satnav_minutes_to_travel\": \"%u\"\n"
-        "}\n"
-    "}\n";
-
-    char floatBuf[MAX_FLOAT_SIZE];
-    int at = snprintf_P(buf, n, jsonFormatter,
-        currHeading,
-        currHeading,
-        headingToDestination,
-        headingToDestination,
-        roadDistanceToDestination,
-        data[5] & 0x80 ? offStr : onStr,
-        data[5] & 0x80 ? onStr : offStr,
-        gpsDistanceToDestination,
-        data[7] & 0x80 ? offStr : onStr,
-        data[7] & 0x80 ? onStr : offStr,
-        distanceToNextTurn,
-        data[9] & 0x80 ? offStr : onStr,
-        data[9] & 0x80 ? onStr : offStr,
-        headingOnRoundabout == 0x7FFF ? notApplicable3Str : FloatToStr(floatBuf, headingOnRoundabout, 0),
-        minutesToTravel
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    AddRotate(json, PSTR("satnav_curr_heading"), currHeading);
+    json.BeginValue(PSTR("satnav_curr_heading_as_text")).UInt(currHeading).StrP(PSTR(" deg")).EndValue();
+    AddRotate(json, PSTR("satnav_heading_to_dest"), headingToDestination);
+    json.BeginValue(PSTR("satnav_heading_to_dest_as_text")).UInt(headingToDestination).StrP(PSTR(" deg")).EndValue();
 
-    return VAN_PACKET_PARSE_OK;
+    json.AddUInt(PSTR("satnav_distance_to_dest_via_road"), roadDistanceToDestination);
+    json.AddStrP(PSTR("satnav_distance_to_dest_via_road_m"), data[5] & 0x80 ? offStr : onStr);
+    json.AddStrP(PSTR("satnav_distance_to_dest_via_road_km"), data[5] & 0x80 ? onStr : offStr);
+    json.AddUInt(PSTR("satnav_distance_to_dest_via_straight_line"), gpsDistanceToDestination);
+    json.AddStrP(PSTR("satnav_distance_to_dest_via_straight_line_m"), data[7] & 0x80 ? offStr : onStr);
+    json.AddStrP(PSTR("satnav_distance_to_dest_via_straight_line_km"), data[7] & 0x80 ? onStr : offStr);
+    json.AddUInt(PSTR("satnav_turn_at"), distanceToNextTurn);
+    json.AddStrP(PSTR("satnav_turn_at_m"), data[9] & 0x80 ? offStr : onStr);
+    json.AddStrP(PSTR("satnav_turn_at_km"), data[9] & 0x80 ? onStr : offStr);
+
+    json.BeginValue(PSTR("satnav_heading_on_roundabout_as_text"));
+    if (headingOnRoundabout == 0x7FFF) json.StrP(notApplicable3Str); else json.UInt(headingOnRoundabout);
+    json.StrP(PSTR(" deg")).EndValue();
+
+    json.AddUInt(PSTR("satnav_minutes_to_travel"), minutesToTravel);
+
+    return EndDisplayEvent(json);
 } // ParseSatNavGuidanceDataPkt
 
 VanPacketParseResult_t ParseSatNavGuidancePkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2435,55 +2074,15 @@ VanPacketParseResult_t ParseSatNavGuidancePkt(const char* idenStr, TVanPacketRxD
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"satnav_curr_turn_icon\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"display\": \"%S\"\n"
-                "}\n"
-            "},\n"
-            "\"satnav_next_turn_icon\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"display\": \"%S\"\n"
-                "}\n"
-            "},\n"
-            "\"satnav_turn_around_if_possible_icon\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"display\": \"%S\"\n"
-                "}\n"
-            "},\n"
-            "\"satnav_follow_road_icon\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"display\": \"%S\"\n"
-                "}\n"
-            "},\n"
-            "\"satnav_not_on_map_icon\":\n"
-            "{\n"
-                "\"style\":\n"
-                "{\n"
-                    "\"display\": \"%S\"\n"
-                "}\n"
-            "}";
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
     // Determines which guidance icon(s) will be visible
-    int at = snprintf_P(buf, n, jsonFormatter,
-        data[1] == 0x01 || data[1] == 0x03 ? styleDisplayBlockStr : styleDisplayNoneStr,
-        data[1] == 0x03 ? styleDisplayBlockStr : styleDisplayNoneStr,
-        data[1] == 0x04 ? styleDisplayBlockStr : styleDisplayNoneStr,
-        data[1] == 0x05 ? styleDisplayBlockStr : styleDisplayNoneStr,
-        data[1] == 0x06 ? styleDisplayBlockStr : styleDisplayNoneStr
-    );
+    AddStyleDisplay(json, PSTR("satnav_curr_turn_icon"), data[1] == 0x01 || data[1] == 0x03);
+    AddStyleDisplay(json, PSTR("satnav_next_turn_icon"), data[1] == 0x03);
+    AddStyleDisplay(json, PSTR("satnav_turn_around_if_possible_icon"), data[1] == 0x04);
+    AddStyleDisplay(json, PSTR("satnav_follow_road_icon"), data[1] == 0x05);
+    AddStyleDisplay(json, PSTR("satnav_not_on_map_icon"), data[1] == 0x06);
 
     if (data[1] == 0x01)  // Single turn
     {
@@ -2493,7 +2092,7 @@ VanPacketParseResult_t ParseSatNavGuidancePkt(const char* idenStr, TVanPacketRxD
 
             // One instruction icon: current in data[4...11]
 
-            GuidanceInstructionIconJson(PSTR("satnav_curr_turn_icon"), data + 4, buf, at, n);
+            GuidanceInstructionIconJson(json, PSTR("satnav_curr_turn_icon"), data + 4);
         }
         else if (data[2] == 0x02)
         {
@@ -2501,22 +2100,14 @@ VanPacketParseResult_t ParseSatNavGuidancePkt(const char* idenStr, TVanPacketRxD
 
             // "Fork or exit" instruction
             // Show one of the available icons
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at,
-                    PSTR(
-                        ",\n"
-                        "\"satnav_fork_icon_take_right_exit\": \"%S\",\n"
-                        "\"satnav_fork_icon_keep_right\": \"%S\",\n"
-                        "\"satnav_fork_icon_take_left_exit\": \"%S\",\n"
-                        "\"satnav_fork_icon_keep_left\": \"%S\""
-                    ),
-
-                    // Pretty sure there are more values
-                    data[4] == 0x12 ? onStr : offStr,
-                    data[4] == 0x14 ? onStr : offStr,
-                    data[4] == 0x21 ? onStr : offStr,  // Never seen; just guessing
-                    data[4] == 0x41 ? onStr : offStr
-                );
+            // Pretty sure there are more values
+            json.AddStrP(PSTR("satnav_fork_icon_take_right_exit"), data[4] == 0x12 ? onStr : offStr);
+            json.AddStrP(PSTR("satnav_fork_icon_keep_right"), data[4] == 0x14 ? onStr : offStr);
+
+            // Never seen; just guessing
+            json.AddStrP(PSTR("satnav_fork_icon_take_left_exit"), data[4] == 0x21 ? onStr : offStr);
+
+            json.AddStrP(PSTR("satnav_fork_icon_keep_left"), data[4] == 0x41 ? onStr : offStr);
         } // if
     }
     else if (data[1] == 0x03)  // Double turn
@@ -2525,8 +2116,8 @@ VanPacketParseResult_t ParseSatNavGuidancePkt(const char* idenStr, TVanPacketRxD
 
         // Two instruction icons: current in data[6...13], next in data[14...21]
 
-        GuidanceInstructionIconJson(PSTR("satnav_curr_turn_icon"), data + 6, buf, at, n);
-        GuidanceInstructionIconJson(PSTR("satnav_next_turn_icon"), data + 14, buf, at, n);
+        GuidanceInstructionIconJson(json, PSTR("satnav_curr_turn_icon"), data + 6);
+        GuidanceInstructionIconJson(json, PSTR("satnav_next_turn_icon"), data + 14);
     }
     else if (data[1] == 0x04)  // Turn around if possible
     {
@@ -2539,31 +2130,24 @@ VanPacketParseResult_t ParseSatNavGuidancePkt(const char* idenStr, TVanPacketRxD
         if (dataLen != 4) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
         // Show one of the five available icons
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"satnav_follow_road_next_instruction\": \"%S\""),
-                data[2] == 0x00 ? noneStr :
-                data[2] == 0x01 ? PSTR("TURN_RIGHT") :
-                data[2] == 0x02 ? PSTR("TURN_LEFT") :
-                data[2] == 0x04 ? PSTR("ROUNDABOUT") :
-                data[2] == 0x08 ? PSTR("GO_STRAIGHT_AHEAD") :
-                data[2] == 0x10 ? PSTR("RETRIEVING_NEXT_INSTRUCTION") :
-                ToHexStr(data[2])
-            );
+        json.AddStrP(PSTR("satnav_follow_road_next_instruction"),
+            data[2] == 0x00 ? noneStr :
+            data[2] == 0x01 ? PSTR("TURN_RIGHT") :
+            data[2] == 0x02 ? PSTR("TURN_LEFT") :
+            data[2] == 0x04 ? PSTR("ROUNDABOUT") :
+            data[2] == 0x08 ? PSTR("GO_STRAIGHT_AHEAD") :
+            data[2] == 0x10 ? PSTR("RETRIEVING_NEXT_INSTRUCTION") :
+            ToHexStr(data[2])
+        );
     }
     else if (data[1] == 0x06)  // Not on map
     {
         if (dataLen != 4) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR(",\n\"satnav_not_on_map_follow_heading\": \"%u\""), data[2]);
+        json.AddUInt(PSTR("satnav_not_on_map_follow_heading"), data[2]);
     } // if
 
-    at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseSatNavGuidancePkt
 
 VanPacketParseResult_t ParseSatNavReportPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2660,229 +2244,159 @@ VanPacketParseResult_t ParseSatNavReportPkt(const char* idenStr, TVanPacketRxDes
 
     // Last packet in sequence: create an 'easily digestable' report in JSON format
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"satnav_report\": \"%S\"";
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    int at = snprintf_P(buf, n, jsonFormatter, SatNavRequestStr(report));
+    json.AddStrP(PSTR("satnav_report"), SatNavRequestStr(report));
 
     if (report == SR_CURRENT_STREET || report == SR_NEXT_STREET)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_%S_street\": \"%s%s (%s%S%s)\"";
-
         // Current/next street is in first (and only) record. Copy only city [3], district [4] (if any) and
         // street [5, 6]; skip the other strings.
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter,
-
-                report == SR_CURRENT_STREET ? PSTR("curr") : PSTR("next"),
-
-                // Street
-                records[0][5].c_str() + 1,  // Skip the fixed first letter 'G'
-                records[0][6].c_str(),
-
-                // City - District (optional)
-                records[0][3].c_str(),
-                records[0][4].length() == 0 ? emptyStr : PSTR(" - "),
-                records[0][4].c_str()
-            );
+        json.BeginValue(report == SR_CURRENT_STREET ? PSTR("satnav_curr_street") : PSTR("satnav_next_street"))
+
+            // Street
+            .Str(records[0][5].c_str() + 1)  // Skip the fixed first letter 'G'
+            .Str(records[0][6].c_str())
+
+            // City - District (optional)
+            .StrP(PSTR(" ("))
+            .Str(records[0][3].c_str())
+            .StrP(records[0][4].length() == 0 ? emptyStr : PSTR(" - "))
+            .Str(records[0][4].c_str())
+            .Char(')')
+            .EndValue();
     }
     else if (report == SR_GPS_CHOOSE_DESTINATION || report == SR_GPS_FOR_PLACE_OF_INTEREST)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_%S_address\": \"%s%s%s%s (%s%S%s)\"";
-
         // Address is in first (and only) record. Copy only city [3], district [4] (if any), street [5, 6] and
         // house number [7]; skip the other strings.
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter,
-
-                report == SR_GPS_CHOOSE_DESTINATION ? PSTR("destination") : PSTR("current"),
-
-                // Street
-                records[0][5].c_str() + 1,  // Skip the fixed first letter 'G'
-                records[0][6].c_str(),
-
-                // First string is either "C" or "V"; "C" has GPS coordinates in [7] and [8]; "V" has house number
-                // in [7]. If we see "V", show house number.
-                records[0][0] == "V" ? PSTR(" ") : emptyStr,
-                records[0][0] == "V" ? records[0][7].c_str() : emptyStr,
-
-                // City - District (optional)
-                records[0][3].c_str(),
-                records[0][4].length() == 0 ? emptyStr : PSTR(" - "),
-                records[0][4].c_str()
-            );
+        json.BeginValue(report == SR_GPS_CHOOSE_DESTINATION ?
+                PSTR("satnav_destination_address") :
+                PSTR("satnav_current_address"))
+
+            // Street
+            .Str(records[0][5].c_str() + 1)  // Skip the fixed first letter 'G'
+            .Str(records[0][6].c_str());
+
+        // First string is either "C" or "V"; "C" has GPS coordinates in [7] and [8]; "V" has house number
+        // in [7]. If we see "V", show house number.
+        if (records[0][0] == "V") json.Char(' ').Str(records[0][7].c_str());
+
+        // City - District (optional)
+        json.StrP(PSTR(" ("))
+            .Str(records[0][3].c_str())
+            .StrP(records[0][4].length() == 0 ? emptyStr : PSTR(" - "))
+            .Str(records[0][4].c_str())
+            .Char(')')
+            .EndValue();
     }
     else if (report == SR_PRIVATE_ADDRESS || report == SR_BUSINESS_ADDRESS)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_%S_entry\": \"%s\",\n"
-            "\"satnav_%S\": \"%s%s %s (%s%S%s)\"";
-
         // Chosen address is in first (and only) record. Copy only city [3], district [4] (if any), street [5, 6]
         // house number [7] and entry name [8]; skip the other strings.
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter,
-
-                report == SR_PRIVATE_ADDRESS ? PSTR("private_address") : PSTR("business_address"),
-
-                // Name of the entry
-                records[0][8].c_str(),
-
-                report == SR_PRIVATE_ADDRESS ? PSTR("private_address") : PSTR("business_address"),
 
-                // Address of the entry
-
-                // Street and house number
-                records[0][5].c_str() + 1,  // Skip the fixed first letter 'G'
-                records[0][6].c_str(),
-                records[0][7].c_str(),
-
-                // City - District (optional)
-                records[0][3].c_str(),
-                records[0][4].length() == 0 ? emptyStr : PSTR(" - "),
-                records[0][4].c_str()
-            );
+        // Name of the entry
+        json.AddStr(report == SR_PRIVATE_ADDRESS ?
+                PSTR("satnav_private_address_entry") :
+                PSTR("satnav_business_address_entry"),
+            records[0][8].c_str());
+
+        // Address of the entry
+        json.BeginValue(report == SR_PRIVATE_ADDRESS ? PSTR("satnav_private_address") : PSTR("satnav_business_address"))
+
+            // Street and house number
+            .Str(records[0][5].c_str() + 1)  // Skip the fixed first letter 'G'
+            .Str(records[0][6].c_str())
+            .Char(' ')
+            .Str(records[0][7].c_str())
+
+            // City - District (optional)
+            .StrP(PSTR(" ("))
+            .Str(records[0][3].c_str())
+            .StrP(records[0][4].length() == 0 ? emptyStr : PSTR(" - "))
+            .Str(records[0][4].c_str())
+            .Char(')')
+            .EndValue();
     }
     else if (report == SR_PLACE_OF_INTEREST_ADDRESS)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_place_of_interest_address_entry\": \"%s\",\n"
-            "\"satnav_place_of_interest_address\": \"%s%s (%s%S%s)\",\n"
-            "\"satnav_place_of_interest_address_distance\": \"%s\"";
-
         // Chosen place of interest address is in first (and only) record. Copy only city [3], district [4]
         // (if any), street [5, 6], entry name [9] and distance [11]; skip the other strings.
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter,
 
-                // Name of the place of interest
-                records[0][9].c_str(),
+        // Name of the place of interest
+        json.AddStr(PSTR("satnav_place_of_interest_address_entry"), records[0][9].c_str());
 
-                // Address of the place of interest
+        // Address of the place of interest
+        json.BeginValue(PSTR("satnav_place_of_interest_address"))
 
-                // Street
-                records[0][5].c_str() + 1,  // Skip the fixed first letter ('G' or 'I')
-                records[0][6].c_str(),
+            // Street
+            .Str(records[0][5].c_str() + 1)  // Skip the fixed first letter ('G' or 'I')
+            .Str(records[0][6].c_str())
 
-                // City - District (optional)
-                records[0][3].c_str(),
-                records[0][4].length() == 0 ? emptyStr : PSTR(" - "),
-                records[0][4].c_str(),
+            // City - District (optional)
+            .StrP(PSTR(" ("))
+            .Str(records[0][3].c_str())
+            .StrP(records[0][4].length() == 0 ? emptyStr : PSTR(" - "))
+            .Str(records[0][4].c_str())
+            .Char(')')
+            .EndValue();
 
-                // Distance (in meters) to the place of interest. TODO - not sure
-                records[0][11].c_str()
-            );
+        // Distance (in meters) to the place of interest. TODO - not sure
+        json.AddStr(PSTR("satnav_place_of_interest_address_distance"), records[0][11].c_str());
     }
     else if (report == SR_ENTER_CITY
              || report == SR_ENTER_STREET
              || report == SR_PRIVATE_ADDRESS_LIST
              || report == SR_BUSINESS_ADDRESS_LIST)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_list\":\n"
-            "[";
-
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter);
+        json.BeginArray(PSTR("satnav_list"));
 
         // Each item in the list is a single string in a separate record
-        for (int i = 0; i < currentRecord; i++)
-        {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at,
-                    PSTR("%S\n\"%s\""),
-                    i == 0 ? emptyStr : commaStr,
-                    records[i][0].c_str()
-                );
-        } // for
+        for (int i = 0; i < currentRecord; i++) json.BeginValue().Str(records[i][0].c_str()).EndValue();
 
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR("\n]"));
+        json.EndArray();
     }
     else if (report == SR_ENTER_HOUSE_NUMBER)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_house_number_range\": \"%s...%s\"";
-
         // Range of "house numbers" is in first (and only) record, the lowest number is in the first string, and
         // highest number is in the second string
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter,
-
-                records[0][0].c_str(),
-                records[0][1].c_str()
-            );
+        json.BeginValue(PSTR("satnav_house_number_range"))
+            .Str(records[0][0].c_str())
+            .StrP(PSTR("..."))
+            .Str(records[0][1].c_str())
+            .EndValue();
     }
     else if (report == SR_PLACE_OF_INTEREST_CATEGORY_LIST)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_place_of_interest_category_list\":\n"
-            "[";
-
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter);
+        json.BeginArray(PSTR("satnav_place_of_interest_category_list"));
 
         // Each "category" in the list is a single string in a separate record
-        for (int i = 0; i < currentRecord; i++)
-        {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at,
-                    PSTR("%S\n\"%s\""),
-                    i == 0 ? emptyStr : commaStr,
-                    records[i][0].c_str()
-                );
-        } // for
+        for (int i = 0; i < currentRecord; i++) json.BeginValue().Str(records[i][0].c_str()).EndValue();
 
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR("\n]"));
+        json.EndArray();
     } // if
     else if (report == SR_SOFTWARE_MODULE_VERSIONS)
     {
-        const static char jsonFormatter[] PROGMEM =
-            ",\n"
-            "\"satnav_software_modules_list\":\n"
-            "[";
-
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, jsonFormatter);
+        json.BeginArray(PSTR("satnav_software_modules_list"));
 
         // Each "module" in the list is a triplet of strings ('module_name', then 'version' and 'date' in a rather
         // free format) in a separate record
         for (int i = 0; i < currentRecord; i++)
         {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at,
-                    PSTR("%S\n\"%s - %s - %s\""),
-                    i == 0 ? emptyStr : commaStr,
-                    records[i][0].c_str(),
-                    records[i][1].c_str(),
-                    records[i][2].c_str()
-                );
+            json.BeginValue()
+                .Str(records[i][0].c_str())
+                .StrP(PSTR(" - "))
+                .Str(records[i][1].c_str())
+                .StrP(PSTR(" - "))
+                .Str(records[i][2].c_str())
+                .EndValue();
         } // for
 
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR("\n]"));
+        json.EndArray();
     } // if
 
-    at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseSatNavReportPkt
 
 VanPacketParseResult_t ParseMfdToSatNavPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2898,22 +2412,17 @@ VanPacketParseResult_t ParseMfdToSatNavPkt(const char* idenStr, TVanPacketRxDesc
     uint8_t parameter = data[1];
     uint8_t type = data[2];
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"mfd_to_satnav_request\": \"%S\",\n"
-            "\"mfd_to_satnav_extended_request\": \"%S\",\n"
-            "\"mfd_to_satnav_request_type\": \"%S\"";
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    int at = snprintf_P(buf, n, jsonFormatter,
-        SatNavRequestStr(request),
+    json.AddStrP(PSTR("mfd_to_satnav_request"), SatNavRequestStr(request));
 
-        // "Special" combinations
+    // "Special" combinations
+    json.AddStrP(PSTR("mfd_to_satnav_extended_request"),
         request == SR_PLACE_OF_INTEREST_CATEGORY_LIST && parameter == 0xFF && dataLen == 4 ? PSTR("START_SATNAV") :
-            emptyStr,
+            emptyStr);
 
+    json.AddStrP(PSTR("mfd_to_satnav_request_type"),
         type == 0x00 ? PSTR("REQ_LIST_LENGTH") :
         type == 0x01 ? PSTR("REQ_LIST") :
         type == 0x02 ? PSTR("CHOOSE") :
@@ -2922,21 +2431,19 @@ VanPacketParseResult_t ParseMfdToSatNavPkt(const char* idenStr, TVanPacketRxDesc
 
     if (data[3] != 0x00)
     {
-        char buffer[2];
-        sprintf_P(buffer, PSTR("%c"), data[3]);
-
-        at += at >= JSON_BUFFER_SIZE ? 0 :
-            snprintf_P(buf + at, n - at, PSTR
-                (
-                    ",\n"
-                    "\"mfd_to_satnav_character\": \"%s\""
-                ),
-
-                (data[3] >= 'A' && data[3] <= 'Z') || (data[3] >= '0' && data[3] <= '9') || data[3] == '\'' ? buffer :
-                data[3] == ' ' ? "_" : // Space
-                data[3] == 0x01 ? "Esc" :
-                "?"
-            );
+        json.BeginValue(PSTR("mfd_to_satnav_character"));
+        if ((data[3] >= 'A' && data[3] <= 'Z') || (data[3] >= '0' && data[3] <= '9') || data[3] == '\'')
+        {
+            json.Char(data[3]);
+        }
+        else
+        {
+            json.StrP(
+                data[3] == ' ' ? PSTR("_") : // Space
+                data[3] == 0x01 ? PSTR("Esc") :
+                PSTR("?"));
+        } // if
+        json.EndValue();
     } // if
 
     if (dataLen >= 9)
@@ -2946,37 +2453,16 @@ VanPacketParseResult_t ParseMfdToSatNavPkt(const char* idenStr, TVanPacketRxDesc
 
         if (selectionOrOffset > 0 && length > 0)
         {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at, PSTR
-                    (
-                        ",\n"
-                        "\"mfd_to_satnav_offset\": \"%u\",\n"
-                        "\"mfd_to_satnav_length\": \"%u\""
-                    ),
-                    selectionOrOffset,
-                    length
-                );
+            json.AddUInt(PSTR("mfd_to_satnav_offset"), selectionOrOffset);
+            json.AddUInt(PSTR("mfd_to_satnav_length"), length);
         }
         else //if (selectionOrOffset > 0)
         {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at, PSTR
-                    (
-                        ",\n"
-                        "\"mfd_to_satnav_selection\": \"%u\""
-                    ),
-                    selectionOrOffset
-                );
+            json.AddUInt(PSTR("mfd_to_satnav_selection"), selectionOrOffset);
         } // if
     } // if
 
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseMfdToSatNavPkt
 
 VanPacketParseResult_t ParseSatNavToMfdPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -2986,19 +2472,13 @@ VanPacketParseResult_t ParseSatNavToMfdPkt(const char* idenStr, TVanPacketRxDesc
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"satnav_to_mfd_response\": \"%S\",\n"
-            "\"satnav_to_mfd_list_size\": \"%u\",\n"
-            "\"satnav_to_mfd_show_characters\": \"";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-        SatNavRequestStr(data[1]),
-        (uint16_t)data[4] << 8 | data[5]
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+
+    json.AddStrP(PSTR("satnav_to_mfd_response"), SatNavRequestStr(data[1]));
+    json.AddUInt(PSTR("satnav_to_mfd_list_size"), (uint16_t)data[4] << 8 | data[5]);
+
+    json.BeginValue(PSTR("satnav_to_mfd_show_characters"));
 
     // Available letters are bit-coded in bytes 17...20. Print the letter if it is available, print a '.'
     // if not.
@@ -3006,15 +2486,12 @@ VanPacketParseResult_t ParseSatNavToMfdPkt(const char* idenStr, TVanPacketRxDesc
     {
         for (int bit = 0; bit < (byte == 3 ? 2 : 8); bit++)
         {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at, PSTR("%c"), data[byte + 17] >> bit & 0x01 ? 65 + 8 * byte + bit : '.');
-
+            json.Char(data[byte + 17] >> bit & 0x01 ? 65 + 8 * byte + bit : '.');
         } // for
     } // for
 
     // Special character: single quote (')
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, PSTR("%c"), data[21] >> 6 & 0x01 ? '\'' : '.');
+    json.Char(data[21] >> 6 & 0x01 ? '\'' : '.');
 
     // Available numbers are bit-coded in bytes 20...21, starting with '0' at bit 2 of byte 20, ending
     // with '9' at bit 3 of byte 21. Print the number if it is available, print a '.' if not.
@@ -3022,22 +2499,16 @@ VanPacketParseResult_t ParseSatNavToMfdPkt(const char* idenStr, TVanPacketRxDesc
     {
         for (int bit = (byte == 0 ? 2 : 0); bit < (byte == 1 ? 3 : 8); bit++)
         {
-            at += at >= JSON_BUFFER_SIZE ? 0 :
-                snprintf_P(buf + at, n - at, PSTR("%c"), data[byte + 20] >> bit & 0x01 ? 48 + 8 * byte + bit - 2 : '.');
+            json.Char(data[byte + 20] >> bit & 0x01 ? 48 + 8 * byte + bit - 2 : '.');
         } // for
     } // for
 
     // <Space>, will be shown as '_'
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, PSTR("%c"),  data[22] >> 1 & 0x01 ? '_' : '.');
-
-    at += at >= JSON_BUFFER_SIZE ? 0 :
-        snprintf_P(buf + at, n - at, PSTR("\"\n}\n}\n"));
+    json.Char(data[22] >> 1 & 0x01 ? '_' : '.');
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    json.EndValue();
 
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseSatNavToMfdPkt
 
 VanPacketParseResult_t ParseWheelSpeedPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -3046,31 +2517,15 @@ VanPacketParseResult_t ParseWheelSpeedPkt(const char* idenStr, TVanPacketRxDesc&
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"wheel_speed_rear_right\": \"%s\",\n"
-            "\"wheel_speed_rear_left\": \"%s\",\n"
-            "\"wheel_pulses_rear_right\": \"%u\",\n"
-            "\"wheel_pulses_rear_left\": \"%u\"\n"
-        "}\n"
-    "}\n";
-
-    char floatBuf[2][MAX_FLOAT_SIZE];
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-        FloatToStr(floatBuf[0], ((uint16_t)data[0] << 8 | data[1]) / 100.0, 2),
-        FloatToStr(floatBuf[1], ((uint16_t)data[2] << 8 | data[3]) / 100.0, 2),
-        (uint16_t)data[4] << 8 | data[5],
-        (uint16_t)data[6] << 8 | data[7]
-    );
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
+    json.AddFixed(PSTR("wheel_speed_rear_right"), (uint16_t)data[0] << 8 | data[1], 2);
+    json.AddFixed(PSTR("wheel_speed_rear_left"), (uint16_t)data[2] << 8 | data[3], 2);
+    json.AddUInt(PSTR("wheel_pulses_rear_right"), (uint16_t)data[4] << 8 | data[5]);
+    json.AddUInt(PSTR("wheel_pulses_rear_left"), (uint16_t)data[6] << 8 | data[7]);
 
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseWheelSpeedPkt
 
 VanPacketParseResult_t ParseOdometerPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -3080,25 +2535,10 @@ VanPacketParseResult_t ParseOdometerPkt(const char* idenStr, TVanPacketRxDesc& p
 
     const uint8_t* data = pkt.Data();
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"odometer_2\": \"%s\"\n"
-        "}\n"
-    "}\n";
-
-    char floatBuf[MAX_FLOAT_SIZE];
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-        FloatToStr(floatBuf, ((uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3]) / 10.0, 1)
-    );
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+    json.AddFixed(PSTR("odometer_2"), (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3], 1);
+    return EndDisplayEvent(json);
 } // ParseOdometerPkt
 
 VanPacketParseResult_t ParseCom2000Pkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -3109,74 +2549,39 @@ VanPacketParseResult_t ParseCom2000Pkt(const char* idenStr, TVanPacketRxDesc& pk
 
     // TODO - replace event "display" by "button_press"; JavaScript on served website could react by changing to
     // different screen or displaying popup
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"com2000_light_switch_auto\": \"%S\",\n"
-            "\"com2000_light_switch_fog_light_forward\": \"%S\",\n"
-            "\"com2000_light_switch_fog_light_backward\": \"%S\",\n"
-            "\"com2000_light_switch_signal_beam\": \"%S\",\n"
-            "\"com2000_light_switch_full_beam\": \"%S\",\n"
-            "\"com2000_light_switch_all_off\": \"%S\",\n"
-            "\"com2000_light_switch_side_lights\": \"%S\",\n"
-            "\"com2000_light_switch_low_beam\": \"%S\",\n"
-            "\"com2000_right_stalk_button_trip_computer\": \"%S\",\n"
-            "\"com2000_right_stalk_rear_window_wash\": \"%S\",\n"
-            "\"com2000_right_stalk_rear_window_wiper\": \"%S\",\n"
-            "\"com2000_right_stalk_windscreen_wash\": \"%S\",\n"
-            "\"com2000_right_stalk_windscreen_wipe_once\": \"%S\",\n"
-            "\"com2000_right_stalk_windscreen_wipe_auto\": \"%S\",\n"
-            "\"com2000_right_stalk_windscreen_wipe_normal\": \"%S\",\n"
-            "\"com2000_right_stalk_windscreen_wipe_fast\": \"%S\",\n"
-            "\"com2000_turn_signal_left\": \"%S\",\n"
-            "\"com2000_turn_signal_right\": \"%S\",\n"
-            "\"com2000_head_unit_stalk_button_src\": \"%S\",\n"
-            "\"com2000_head_unit_stalk_button_volume_up\": \"%S\",\n"
-            "\"com2000_head_unit_stalk_button_volume_down\": \"%S\",\n"
-            "\"com2000_head_unit_stalk_button_seek_backward\": \"%S\",\n"
-            "\"com2000_head_unit_stalk_button_seek_forward\": \"%S\",\n"
-            "\"com2000_head_unit_stalk_wheel_pos\": \"%d\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
-
-        data[1] & 0x01 ? onStr : offStr,
-        data[1] & 0x02 ? onStr : offStr,
-        data[1] & 0x04 ? onStr : offStr,
-        data[1] & 0x08 ? onStr : offStr,
-        data[1] & 0x10 ? onStr : offStr,
-        data[1] & 0x20 ? onStr : offStr,
-        data[1] & 0x40 ? onStr : offStr,
-        data[1] & 0x80 ? onStr : offStr,
-
-        data[2] & 0x01 ? onStr : offStr,
-        data[2] & 0x02 ? onStr : offStr,
-        data[2] & 0x04 ? onStr : offStr,
-        data[2] & 0x08 ? onStr : offStr,
-        data[2] & 0x10 ? onStr : offStr,
-        data[2] & 0x20 ? onStr : offStr,
-        data[2] & 0x40 ? onStr : offStr,
-        data[2] & 0x80 ? onStr : offStr,
-
-        data[3] & 0x40 ? onStr : offStr,
-        data[3] & 0x80 ? onStr : offStr,
-
-        data[5] & 0x02 ? onStr : offStr,
-        data[5] & 0x03 ? onStr : offStr,
-        data[5] & 0x08 ? onStr : offStr,
-        data[5] & 0x40 ? onStr : offStr,
-        data[5] & 0x80 ? onStr : offStr,
-
-        (sint8_t)data[6]
-    );
-
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
+
+    json.AddStrP(PSTR("com2000_light_switch_auto"), data[1] & 0x01 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_light_switch_fog_light_forward"), data[1] & 0x02 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_light_switch_fog_light_backward"), data[1] & 0x04 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_light_switch_signal_beam"), data[1] & 0x08 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_light_switch_full_beam"), data[1] & 0x10 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_light_switch_all_off"), data[1] & 0x20 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_light_switch_side_lights"), data[1] & 0x40 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_light_switch_low_beam"), data[1] & 0x80 ? onStr : offStr);
+
+    json.AddStrP(PSTR("com2000_right_stalk_button_trip_computer"), data[2] & 0x01 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_right_stalk_rear_window_wash"), data[2] & 0x02 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_right_stalk_rear_window_wiper"), data[2] & 0x04 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_right_stalk_windscreen_wash"), data[2] & 0x08 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_right_stalk_windscreen_wipe_once"), data[2] & 0x10 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_right_stalk_windscreen_wipe_auto"), data[2] & 0x20 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_right_stalk_windscreen_wipe_normal"), data[2] & 0x40 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_right_stalk_windscreen_wipe_fast"), data[2] & 0x80 ? onStr : offStr);
+
+    json.AddStrP(PSTR("com2000_turn_signal_left"), data[3] & 0x40 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_turn_signal_right"), data[3] & 0x80 ? onStr : offStr);
+
+    json.AddStrP(PSTR("com2000_head_unit_stalk_button_src"), data[5] & 0x02 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_head_unit_stalk_button_volume_up"), data[5] & 0x03 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_head_unit_stalk_button_volume_down"), data[5] & 0x08 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_head_unit_stalk_button_seek_backward"), data[5] & 0x40 ? onStr : offStr);
+    json.AddStrP(PSTR("com2000_head_unit_stalk_button_seek_forward"), data[5] & 0x80 ? onStr : offStr);
+
+    json.AddInt(PSTR("com2000_head_unit_stalk_wheel_pos"), (sint8_t)data[6]);
+
+    return EndDisplayEvent(json);
 } // ParseCom2000Pkt
 
 VanPacketParseResult_t ParseCdChangerCmdPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -3186,17 +2591,10 @@ VanPacketParseResult_t ParseCdChangerCmdPkt(const char* idenStr, TVanPacketRxDes
     const uint8_t* data = pkt.Data();
     uint16_t cdcCommand = (uint16_t)data[0] << 8 | data[1];
 
-    const static char jsonFormatter[] PROGMEM =
-    "{\n"
-        "\"event\": \"display\",\n"
-        "\"data\":\n"
-        "{\n"
-            "\"cd_changer_command\": \"%S\"\n"
-        "}\n"
-    "}\n";
-
-    int at = snprintf_P(buf, n, jsonFormatter,
+    TVanJsonWriter json(buf, n);
+    BeginDisplayEvent(json);
 
+    json.AddStrP(PSTR("cd_changer_command"),
         cdcCommand == 0x1101 ? PSTR("POWER_OFF") :
         cdcCommand == 0x2101 ? PSTR("POWER_OFF") :
         cdcCommand == 0x1181 ? PSTR("PAUSE") :
@@ -3214,10 +2612,7 @@ VanPacketParseResult_t ParseCdChangerCmdPkt(const char* idenStr, TVanPacketRxDes
         ToHexStr(cdcCommand)
     );
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseCdChangerCmdPkt
 
 VanPacketParseResult_t ParseMfdToHeadUnitPkt(const char* idenStr, TVanPacketRxDesc& pkt, char* buf, int n)
@@ -3227,7 +2622,8 @@ VanPacketParseResult_t ParseMfdToHeadUnitPkt(const char* idenStr, TVanPacketRxDe
 
     int dataLen = pkt.DataLen();
     const uint8_t* data = pkt.Data();
-    int at = 0;
+
+    TVanJsonWriter json(buf, n);
 
     // Maybe this is in fact "Head unit to MFD"??
 
@@ -3235,44 +2631,25 @@ VanPacketParseResult_t ParseMfdToHeadUnitPkt(const char* idenStr, TVanPacketRxDe
     {
         if (dataLen != 2) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_update_audio_bits_mute\": \"%S\",\n"
-                "\"head_unit_update_audio_bits_auto_volume\": \"%S\",\n"
-                "\"head_unit_update_audio_bits_loudness\": \"%S\",\n"
-                "\"head_unit_update_audio_bits_audio_menu\": \"%S\",\n"
-                "\"head_unit_update_audio_bits_power\": \"%S\",\n"
-                "\"head_unit_update_audio_bits_contact_key\": \"%S\"\n"
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter,
-            data[1] & 0x01 ? onStr : offStr,
-            data[1] & 0x02 ? onStr : offStr,
-            data[1] & 0x10 ? onStr : offStr,
-
-            // Bug: if CD changer is playing, this one is always "OPEN"...
-            data[1] & 0x20 ? openStr : closedStr,
-
-            data[1] & 0x40 ? onStr : offStr,
-            data[1] & 0x80 ? onStr : offStr
-        );
+        BeginDisplayEvent(json);
+
+        json.AddStrP(PSTR("head_unit_update_audio_bits_mute"), data[1] & 0x01 ? onStr : offStr);
+        json.AddStrP(PSTR("head_unit_update_audio_bits_auto_volume"), data[1] & 0x02 ? onStr : offStr);
+        json.AddStrP(PSTR("head_unit_update_audio_bits_loudness"), data[1] & 0x10 ? onStr : offStr);
+
+        // Bug: if CD changer is playing, this one is always "OPEN"...
+        json.AddStrP(PSTR("head_unit_update_audio_bits_audio_menu"), data[1] & 0x20 ? openStr : closedStr);
+
+        json.AddStrP(PSTR("head_unit_update_audio_bits_power"), data[1] & 0x40 ? onStr : offStr);
+        json.AddStrP(PSTR("head_unit_update_audio_bits_contact_key"), data[1] & 0x80 ? onStr : offStr);
     }
     else if (data[0] == 0x12)
     {
         if (dataLen != 2 && dataLen != 11) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_update_switch_to\": \"%S\"";
+        BeginDisplayEvent(json);
 
-        at = snprintf_P(buf, n, jsonFormatter,
+        json.AddStrP(PSTR("head_unit_update_switch_to"),
             data[1] == 0x01 ? PSTR("TUNER") :
             data[1] == 0x02 ? PSTR("INTERNAL_CD_OR_TAPE") :
             data[1] == 0x03 ? PSTR("CD_CHANGER") :
@@ -3287,20 +2664,10 @@ VanPacketParseResult_t ParseMfdToHeadUnitPkt(const char* idenStr, TVanPacketRxDe
 
         if (dataLen == 11)
         {
-            const static char jsonFormatter2[] PROGMEM = ",\n"
-                "\"head_unit_update_power\": \"%S\",\n"
-                "\"head_unit_update_source\": \"%S\",\n"
-                "\"head_unit_update_volume_1\": \"%u%S\",\n"
-                "\"head_unit_update_balance\": \"%d%S\",\n"
-                "\"head_unit_update_fader\": \"%d%S\",\n"
-                "\"head_unit_update_bass\": \"%d%S\",\n"
-                "\"head_unit_update_treble\": \"%d%S\"";
+            json.AddStrP(PSTR("head_unit_update_power"), data[2] & 0x01 ? onStr : offStr);
 
-            at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, jsonFormatter2,
-
-                data[2] & 0x01 ? onStr : offStr,
-
-                (data[4] & 0x0F) == 0x00 ? noneStr :  // source
+            json.AddStrP(PSTR("head_unit_update_source"),
+                (data[4] & 0x0F) == 0x00 ? noneStr :
                 (data[4] & 0x0F) == 0x01 ? PSTR("TUNER") :
                 (data[4] & 0x0F) == 0x02 ? PSTR("INTERNAL_CD_OR_TAPE") :
                 (data[4] & 0x0F) == 0x03 ? PSTR("CD_CHANGER") :
@@ -3310,43 +2677,47 @@ VanPacketParseResult_t ParseMfdToHeadUnitPkt(const char* idenStr, TVanPacketRxDe
                 // whenever this source is chosen.
                 (data[4] & 0x0F) == 0x05 ? PSTR("NAVIGATION") :
 
-                ToHexStr((uint8_t)(data[4] & 0x0F)),
-
-                data[5] & 0x7F,
-                data[5] & 0x80 ? updatedStr : emptyStr,
-                (sint8_t)(0x3F) - (data[6] & 0x7F),
-                data[6] & 0x80 ? updatedStr : emptyStr,
-                (sint8_t)(0x3F) - (data[7] & 0x7F),
-                data[7] & 0x80 ? updatedStr : emptyStr,
-                (sint8_t)(data[8] & 0x7F) - 0x3F,
-                data[8] & 0x80 ? updatedStr : emptyStr,
-                (sint8_t)(data[9] & 0x7F) - 0x3F,
-                data[9] & 0x80 ? updatedStr : emptyStr
+                ToHexStr((uint8_t)(data[4] & 0x0F))
             );
-        } // if
 
-        at += at >= JSON_BUFFER_SIZE ? 0 : snprintf_P(buf + at, n - at, PSTR("\n}\n}\n"));
+            json.BeginValue(PSTR("head_unit_update_volume_1"))
+                .UInt(data[5] & 0x7F)
+                .StrP(data[5] & 0x80 ? updatedStr : emptyStr)
+                .EndValue();
+            json.BeginValue(PSTR("head_unit_update_balance"))
+                .Int((sint8_t)(0x3F) - (data[6] & 0x7F))
+                .StrP(data[6] & 0x80 ? updatedStr : emptyStr)
+                .EndValue();
+            json.BeginValue(PSTR("head_unit_update_fader"))
+                .Int((sint8_t)(0x3F) - (data[7] & 0x7F))
+                .StrP(data[7] & 0x80 ? updatedStr : emptyStr)
+                .EndValue();
+            json.BeginValue(PSTR("head_unit_update_bass"))
+                .Int((sint8_t)(data[8] & 0x7F) - 0x3F)
+                .StrP(data[8] & 0x80 ? updatedStr : emptyStr)
+                .EndValue();
+            json.BeginValue(PSTR("head_unit_update_treble"))
+                .Int((sint8_t)(data[9] & 0x7F) - 0x3F)
+                .StrP(data[9] & 0x80 ? updatedStr : emptyStr)
+                .EndValue();
+        } // if
     }
     else if (data[0] == 0x13)
     {
         if (dataLen != 2) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_update_volume_2\": \"%u(%S%S)\"\n"
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter,
-            data[1] & 0x1F,
-            data[1] & 0x40 ? PSTR("relative: ") : PSTR("absolute"),
-            data[1] & 0x40 ?
-                data[1] & 0x20 ? PSTR("decrease") : PSTR("increase") :
-                emptyStr
-        );
+        BeginDisplayEvent(json);
+
+        json.BeginValue(PSTR("head_unit_update_volume_2"))
+            .UInt(data[1] & 0x1F)
+            .Char('(')
+            .StrP(data[1] & 0x40 ? PSTR("relative: ") : PSTR("absolute"))
+            .StrP(
+                data[1] & 0x40 ?
+                    data[1] & 0x20 ? PSTR("decrease") : PSTR("increase") :
+                    emptyStr)
+            .Char(')')
+            .EndValue();
     }
     else if (data[0] == 0x14)
     {
@@ -3362,58 +2733,29 @@ VanPacketParseResult_t ParseMfdToHeadUnitPkt(const char* idenStr, TVanPacketRxDe
 
         // TODO - bit 7 of data[1] is always 1 ?
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_update_audio_levels_balance\": \"%d\",\n"
-                "\"head_unit_update_audio_levels_fader\": \"%d\",\n"
-                "\"head_unit_update_audio_levels_bass\": \"%d\",\n"
-                "\"head_unit_update_audio_levels_treble\": \"%d\"\n"
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter,
-            (sint8_t)(0x3F) - (data[1] & 0x7F),
-            (sint8_t)(0x3F) - data[2],
-            (sint8_t)data[3] - 0x3F,
-            (sint8_t)data[4] - 0x3F
-        );
+        BeginDisplayEvent(json);
+
+        json.AddInt(PSTR("head_unit_update_audio_levels_balance"), (sint8_t)(0x3F) - (data[1] & 0x7F));
+        json.AddInt(PSTR("head_unit_update_audio_levels_fader"), (sint8_t)(0x3F) - data[2]);
+        json.AddInt(PSTR("head_unit_update_audio_levels_bass"), (sint8_t)data[3] - 0x3F);
+        json.AddInt(PSTR("head_unit_update_audio_levels_treble"), (sint8_t)data[4] - 0x3F);
     }
     else if (data[0] == 0x27)
     {
         if (dataLen != 2) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_preset_request_band\": \"%S\",\n"
-                "\"head_unit_preset_request_memory\": \"%u\"\n"
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter,
-            TunerBandStr(data[1] >> 4 & 0x07),
-            data[1] & 0x0F
-        );
+        BeginDisplayEvent(json);
+
+        json.AddStrP(PSTR("head_unit_preset_request_band"), TunerBandStr(data[1] >> 4 & 0x07));
+        json.AddUInt(PSTR("head_unit_preset_request_memory"), data[1] & 0x0F);
     }
     else if (data[0] == 0x61)
     {
         if (dataLen != 4) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_cd_request\": \"%S\"\n"
-            "}\n"
-        "}\n";
+        BeginDisplayEvent(json);
 
-        at = snprintf_P(buf, n, jsonFormatter,
+        json.AddStrP(PSTR("head_unit_cd_request"),
             data[1] == 0x02 ? PSTR("PAUSE") :
             data[1] == 0x03 ? PSTR("PLAY") :
             data[3] == 0xFF ? PSTR("NEXT") :
@@ -3425,56 +2767,29 @@ VanPacketParseResult_t ParseMfdToHeadUnitPkt(const char* idenStr, TVanPacketRxDe
     {
         if (dataLen != 1) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_tuner_info_request\": \"REQUEST\"\n"
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter);
+        BeginDisplayEvent(json);
+        json.AddStrP(PSTR("head_unit_tuner_info_request"), PSTR("REQUEST"));
     }
     else if (data[0] == 0xD2)
     {
         if (dataLen != 1) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_tape_info_request\": \"REQUEST\"\n"
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter);
+        BeginDisplayEvent(json);
+        json.AddStrP(PSTR("head_unit_tape_info_request"), PSTR("REQUEST"));
     }
     else if (data[0] == 0xD6)
     {
         if (dataLen != 1) return VAN_PACKET_PARSE_UNEXPECTED_LENGTH;
 
-        const static char jsonFormatter[] PROGMEM =
-        "{\n"
-            "\"event\": \"display\",\n"
-            "\"data\":\n"
-            "{\n"
-                "\"head_unit_cd_track_info_request\": \"REQUEST\"\n"
-            "}\n"
-        "}\n";
-
-        at = snprintf_P(buf, n, jsonFormatter);
+        BeginDisplayEvent(json);
+        json.AddStrP(PSTR("head_unit_cd_track_info_request"), PSTR("REQUEST"));
     }
     else
     {
         return VAN_PACKET_PARSE_TO_BE_DECODED;
     } // if
 
-    // JSON buffer overflow?
-    if (at >= JSON_BUFFER_SIZE) return VAN_PACKET_PARSE_JSON_TOO_LONG;
-
-    return VAN_PACKET_PARSE_OK;
+    return EndDisplayEvent(json);
 } // ParseMfdToHeadUnitPkt
 
 // Print the new packet on Serial, highlighting the bytes that differ
@@ -3574,63 +2889,115 @@ static IdenHandler_t handlers[] =
     { 0x450, "com2000", 10, &ParseCom2000Pkt },
     { 0x8EC, "cd_changer_command", 2, &ParseCdChangerCmdPkt },
     { 0x8D4, "display_to_head_unit", -1, &ParseMfdToHeadUnitPkt },
-#if 0
     { 0xADC, "aircon_diag", -1, &DefaultPacketParser },
     { 0xA5C, "aircon_diag_command", -1, &DefaultPacketParser },
-#endif
 }; // handlers
 
 const IdenHandler_t* const handlers_end = handlers + sizeof(handlers) / sizeof(handlers[0]);
 
-const char* ParseVanPacketToJson(TVanPacketRxDesc& pkt)
+// Parse a packet into the JSON buffer, using the parser function in the handler entry passed via 'context'
+int ParsePacketToJson(TVanPacketRxDesc& pkt, void* context)
 {
-    if (! pkt.CheckCrcAndRepair()) return ""; // CRC error
+    IdenHandler_t* handler = (IdenHandler_t*) context;
 
+    // Only process if packet content differs from previous packet
+    // TODO - specify handling modes for duplicate packets in handlers table: not all duplicate packets should
+    //   be ignored.
+
+    const uint8_t* data = pkt.Data();
     int dataLen = pkt.DataLen();
-    if (dataLen < 0 || dataLen > VAN_MAX_DATA_BYTES) return ""; // Unexpected packet length
 
-    uint16_t iden = pkt.Iden();
-    IdenHandler_t* handler = handlers;
+    bool sendFull = handler->prevData == NULL || handler->fullUpdateRequested;
+
+    #if defined JSON_DELTA_UPDATES && JSON_FULL_SNAPSHOT_INTERVAL_MS > 0
+    // Arithmetic has safe roll-over
+    if (millis() - handler->lastFullUpdate >= JSON_FULL_SNAPSHOT_INTERVAL_MS) sendFull = true;
+    #endif // defined JSON_DELTA_UPDATES && JSON_FULL_SNAPSHOT_INTERVAL_MS > 0
+
+    // Relying on short-circuit boolean evaluation
+    if (! sendFull && memcmp(data, handler->prevData, dataLen) == 0) return VAN_PACKET_DUPLICATE;
 
-    // Search the correct handler. Relying on short-circuit boolean evaluation.
-    while (handler != handlers_end && handler->iden != iden) handler++;
+    changedBytes = 0xFFFFFFFF;
 
-    // Hander found?
-    if (handler != handlers_end)
+    #ifdef JSON_DELTA_UPDATES
+    if (! sendFull)
     {
-        if (handler->dataLen >= 0 && dataLen != handler->dataLen) return ""; // Unexpected packet length
+        changedBytes = 0;
+        for (int i = 0; i < dataLen; i++) if (data[i] != handler->prevData[i]) changedBytes |= DATA_BYTE(i);
+    } // if
+    #endif // JSON_DELTA_UPDATES
 
-        // Only process if packet content differs from previous packet
-        // TODO - specify handling modes for duplicate packets in handlers table: not all duplicate packets should
-        //   be ignored.
+    if (sendFull)
+    {
+        handler->lastFullUpdate = millis();
+        handler->fullUpdateRequested = false;
+    } // if
 
-        const uint8_t* data = pkt.Data();
+    Serial.printf_P(PSTR("---> Received: %s packet (0x%03X)\n"), handler->idenStr, pkt.Iden());
 
-        // Relying on short-circuit boolean evaluation
-        if (handler->prevData != NULL && memcmp(data, handler->prevData, dataLen) == 0) return "";  // Duplicate packet
+    // Print the new packet on Serial, highlighting the bytes that differ
+    PrintPacketDataDiff(pkt, handler);
 
-        Serial.printf_P(PSTR("---> Received: %s packet (0x%03X)\n"), handler->idenStr, iden);
+    return handler->parser(handler->idenStr, pkt, jsonBuffer, JSON_BUFFER_SIZE);
+} // ParsePacketToJson
 
-        // Print the new packet on Serial, highlighting the bytes that differ
-        PrintPacketDataDiff(pkt, handler);
+TVanPacketDispatcher<sizeof(handlers) / sizeof(handlers[0])> dispatcher;
 
-        int result = handler->parser(handler->idenStr, pkt, jsonBuffer, JSON_BUFFER_SIZE);
+// Register all handlers with the dispatcher. Also, let the receiver suppress duplicate packets for all IDENs that
+// have a handler. This saves a lot of queue slots, as most packets on the bus are periodic repetitions.
+void SetupVanPacketHandlers()
+{
+    for (IdenHandler_t* handler = handlers; handler != handlers_end; handler++)
+    {
+        dispatcher.Register(handler->iden, handler->dataLen, &ParsePacketToJson, handler);
+
+        #if defined JSON_DELTA_UPDATES && JSON_FULL_SNAPSHOT_INTERVAL_MS > 0
+        // Let a duplicate packet through now and then, for the full JSON object to be sent
+        VanBusRx.SuppressDuplicates(handler->iden, JSON_FULL_SNAPSHOT_INTERVAL_MS);
+        #else
+        VanBusRx.SuppressDuplicates(handler->iden);
+        #endif // defined JSON_DELTA_UPDATES && JSON_FULL_SNAPSHOT_INTERVAL_MS > 0
+    } // for
+} // SetupVanPacketHandlers
 
-        if (result == VAN_PACKET_PARSE_JSON_TOO_LONG)
-        {
-            Serial.print(FPSTR(warningPrintBufferOverflow));
-            // No use to return the JSON buffer; it is invalid
-        }
-        else if (result == VAN_PACKET_PARSE_OK)
-        {
-            #ifdef PRINT_JSON_BUFFERS_ON_SERIAL
-            Serial.print(F("Parsed to JSON object:\n"));
-            PrintJsonText(jsonBuffer);
-            #endif // PRINT_JSON_BUFFERS_ON_SERIAL
+// Let the next packet of each type be sent as a full JSON object, e.g. when a new browser has connected
+void RequestFullJsonUpdates()
+{
+    for (IdenHandler_t* handler = handlers; handler != handlers_end; handler++)
+    {
+        handler->fullUpdateRequested = true;
 
-            return jsonBuffer;
-        } // if
+        // Without this, the next packet would be suppressed as duplicate if its content has not changed
+        VanBusRx.ForgetLastSeen(handler->iden);
+    } // for
+} // RequestFullJsonUpdates
+
+const char* ParseVanPacketToJson(TVanPacketRxDesc& pkt)
+{
+    if (! pkt.CheckCrcAndRepair()) return ""; // CRC error
+
+    int dataLen = pkt.DataLen();
+    if (dataLen < 0 || dataLen > VAN_MAX_DATA_BYTES) return ""; // Unexpected packet length
+
+    int result = VAN_PACKET_PARSE_UNRECOGNIZED_IDEN;
+
+    // Unrecognized IDEN value or unexpected packet length?
+    if (dispatcher.Dispatch(pkt, &result) != VAN_DISPATCH_OK) return "";
+
+    if (result == VAN_PACKET_PARSE_JSON_TOO_LONG)
+    {
+        Serial.print(FPSTR(warningPrintBufferOverflow));
+        // No use to return the JSON buffer; it is invalid
+    }
+    else if (result == VAN_PACKET_PARSE_OK)
+    {
+        #ifdef PRINT_JSON_BUFFERS_ON_SERIAL
+        Serial.print(F("Parsed to JSON object:\n"));
+        PrintJsonText(jsonBuffer);
+        #endif // PRINT_JSON_BUFFERS_ON_SERIAL
+
+        return jsonBuffer;
     } // if
 
-    return ""; // Unrecognized IDEN value or result != VAN_PACKET_PARSE_OK
+    return ""; // result != VAN_PACKET_PARSE_OK
 } // ParseVanPacketToJson
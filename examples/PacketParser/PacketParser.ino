@@ -3456,14 +3456,6 @@ VanPacketParseResult_t ParseVanPacket(TVanPacketRxDesc* pkt)
     return VAN_PACKET_PARSE_OK;
 } // ParseVanPacket
 
-void setup()
-{
-    delay(1000);
-    SERIAL.begin(115200);
-    SERIAL.println(F("Starting VAN bus packet parser"));
-    VanBusRx.Setup(RX_PIN);
-} // setup
-
 enum VanPacketFilter_t
 {
     VAN_PACKETS_ALL_EXCEPT,
@@ -3476,6 +3468,22 @@ enum VanPacketFilter_t
 // Defined in PacketFilter.ino
 bool isPacketSelected(uint16_t iden, VanPacketFilter_t filter);
 
+void setup()
+{
+    delay(1000);
+    SERIAL.begin(115200);
+    SERIAL.println(F("Starting VAN bus packet parser"));
+
+    // Filter on specific IDENs. The filter is applied by the receiver, so that packets that are not selected will
+    // not occupy a slot in the receive queue.
+    for (uint16_t iden = 0x000; iden <= 0xFFF; iden++)
+    {
+        if (! isPacketSelected(iden, VAN_PACKETS_HEAD_UNIT)) VanBusRx.RejectIden(iden);
+    } // for
+
+    VanBusRx.Setup(RX_PIN);
+} // setup
+
 void loop()
 {
     int n = 0;
@@ -3489,10 +3497,6 @@ void loop()
 
         pkt.CheckCrcAndRepair();
 
-        // Filter on specific IDENs
-        uint16_t iden = pkt.Iden();
-        if (! isPacketSelected(iden, VAN_PACKETS_HEAD_UNIT)) continue;
-
         // Show packet as parsed by ISR
         VanPacketParseResult_t parseResult = ParseVanPacket(&pkt);
 
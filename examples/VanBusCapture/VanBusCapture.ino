@@ -0,0 +1,53 @@
+/*
+ * VanBus: VanBusCapture - capture all packets, received on a VAN bus, in binary format on the serial port.
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ *
+ * -----
+ * Wiring
+ *
+ * See the VanBusDump example sketch.
+ *
+ * -----
+ * Output
+ *
+ * Packets are written in the binary capture format, as described in VanBusCapture.h . On the host, capture the
+ * serial port into a file, and convert it into the same text as printed by the VanBusDump example sketch, e.g.:
+ *
+ *   stty -F /dev/ttyUSB0 921600 raw
+ *   cat /dev/ttyUSB0 > capture.bin
+ *   python3 extras/capture/van_capture_decode.py capture.bin
+ *
+ * To capture over WiFi in stead, pass a connected 'WiFiClient' to the 'TVanCaptureWriter' constructor, and call
+ * 'Begin()' each time a client connects.
+ */
+
+#include <VanBusRx.h>
+#include <VanBusCapture.h>
+
+#if defined ARDUINO_ESP8266_GENERIC || defined ARDUINO_ESP8266_ESP01
+// For ESP-01 board we use GPIO 2 (internal pull-up, keep disconnected or high at boot time)
+#define D2 (2)
+#endif
+const int RX_PIN = D2; // Set to GPIO pin connected to VAN bus transceiver output
+
+TVanCaptureWriter capture(Serial);
+
+void setup()
+{
+    delay(1000);
+    Serial.begin(921600);
+    VanBusRx.Setup(RX_PIN);
+    capture.Begin();
+} // setup
+
+void loop()
+{
+    TVanPacketRecord records[8];
+    int n = VanBusRx.DrainTo(records, sizeof(records) / sizeof(records[0]));
+    if (n > 0) capture.Write(records, n);
+} // loop
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+#
+# VanBus capture decoder
+#
+# Written by Erik Tromp
+#
+# Version 0.2.1 - January, 2021
+#
+# MIT license, all text above must be included in any redistribution.
+#
+# Converts a binary capture stream, as written by 'TVanCaptureWriter' (see VanBusCapture.h), back into the text
+# format of 'TVanPacketRxDesc::DumpRaw(...)'. The stream is read from a file, or from standard input, e.g.:
+#
+#   python3 van_capture_decode.py capture.bin
+#   nc 192.168.1.20 7777 | python3 van_capture_decode.py -t
+#
+# The Rx queue slot is not captured, so it is printed as '-'.
+
+import argparse
+import sys
+
+VAN_CAPTURE_VERSION = 1
+VAN_CAPTURE_SYNC = 0xA5
+VAN_CAPTURE_MAGIC = b'VANC'
+
+VAN_RECORD_RESULT_MASK = 0x03
+VAN_RECORD_ACK = 0x04
+VAN_RECORD_QUEUE_OVERRUN = 0x08
+VAN_CAPTURE_SEQNO = 0x10
+VAN_CAPTURE_SOF = 0x20
+
+VAN_MAX_PACKET_SIZE = 33
+
+RESULT_STR = ['OK', 'ERROR_NBITS', 'ERROR_MANCHESTER', 'ERROR_MAX_PACKET']
+
+# Same as 'crc15NibbleTable' in VanBusRx.cpp
+CRC15_NIBBLE_TABLE = [
+    0x0000, 0x0F9D, 0x1F3A, 0x10A7, 0x3E74, 0x31E9, 0x214E, 0x2ED3,
+    0x7CE8, 0x7375, 0x63D2, 0x6C4F, 0x429C, 0x4D01, 0x5DA6, 0x523B
+]
+
+def crc15(crc, data):
+    for byte in data:
+        crc = (crc << 4 ^ CRC15_NIBBLE_TABLE[(crc >> 11 ^ byte >> 4) & 0x0F]) & 0xFFFF
+        crc = (crc << 4 ^ CRC15_NIBBLE_TABLE[(crc >> 11 ^ byte) & 0x0F]) & 0xFFFF
+    return crc & 0x7FFF
+
+def crc(data):
+    return ((crc15(0x7FFF, data[1:len(data) - 2]) ^ 0x7FFF) << 1) & 0xFFFF
+
+def command_flags_str(flags):
+    return ('R' if flags & 0x02 else 'W') + ('A' if flags & 0x04 else '-') + ('1' if flags & 0x01 else '0')
+
+def dump_raw(seq_no, queue_size, data, flags):
+    size = len(data)
+    width = 3 if queue_size > 100 else 2 if queue_size > 10 else 1
+    line = 'Raw: #%04u (%*s/%u) %2d(%2d) ' % (seq_no % 10000, width, '-', queue_size, max(size - 5, 0), size)
+
+    if size >= 1: line += '%02X ' % data[0]
+    if size >= 3: line += '%03X %s ' % (data[1] << 4 | data[2] >> 4, command_flags_str(data[2] & 0x0F))
+
+    for i in range(3, size):
+        line += '%02X%s' % (data[i], ':' if i == size - 3 else '-' if i < size - 1 else ' ')
+
+    line += 'ACK' if flags & VAN_RECORD_ACK else 'NO_ACK'
+    line += ' ' + RESULT_STR[flags & VAN_RECORD_RESULT_MASK]
+    line += ' %04X' % (crc(data) if size >= 3 else 0)
+    line += ' CRC_OK' if size >= 1 and crc15(0x7FFF, data[1:]) == 0x19B7 else ' CRC_ERROR'
+
+    return line
+
+class Decoder:
+
+    def __init__(self):
+        self.queue_size = 16
+        self.timestamp = 0
+        self.seq_no = 0  # Full (not only 16 LSB) sequence number of the next frame
+        self.n_frames = 0
+        self.n_skipped = 0  # Bytes skipped while looking for a frame boundary
+
+    # Parses one frame at 'pos'. Returns (frame, new position), (None, pos) if more bytes are needed, or raises
+    # ValueError if there is no valid frame at 'pos'.
+    def parse_frame(self, buf, pos):
+        end = len(buf)
+        if pos + 2 > end: return None, pos
+        if buf[pos] != VAN_CAPTURE_SYNC: raise ValueError
+        flags = buf[pos + 1]
+        if flags & 0xC0: raise ValueError
+        p = pos + 2
+
+        delta = 0
+        shift = 0
+        while True:
+            if p >= end: return None, pos
+            byte = buf[p]
+            p += 1
+            delta |= (byte & 0x7F) << shift
+            shift += 7
+            if byte & 0x80 == 0: break
+            if shift >= 35: raise ValueError
+
+        seq_no = None
+        if flags & VAN_CAPTURE_SEQNO:
+            if p + 2 > end: return None, pos
+            seq_no = buf[p] | buf[p + 1] << 8
+            p += 2
+
+        if p >= end: return None, pos
+        size = buf[p]
+        p += 1
+        if size > VAN_MAX_PACKET_SIZE: raise ValueError
+
+        n = size if flags & VAN_CAPTURE_SOF or size == 0 else size - 1
+        if p + n > end: return None, pos
+        data = buf[p:p + n] if flags & VAN_CAPTURE_SOF or size == 0 else b'\x0E' + buf[p:p + n]
+
+        return (flags, delta, seq_no, bytes(data)), p + n
+
+    def handle_frame(self, frame, out, show_time):
+        flags, delta, seq_no, data = frame
+
+        self.timestamp = (self.timestamp + delta) & 0xFFFFFFFF
+        if seq_no is not None:
+            # Extend the 16-bit sequence number, assuming it moves forward
+            high = self.seq_no & ~0xFFFF
+            if seq_no < (self.seq_no & 0xFFFF): high += 0x10000
+            self.seq_no = high | seq_no
+
+        if flags & VAN_RECORD_QUEUE_OVERRUN: out.write('QUEUE OVERRUN!\n')
+        if show_time: out.write('%10u ' % self.timestamp)
+        out.write(dump_raw(self.seq_no, self.queue_size, data, flags) + '\n')
+
+        self.seq_no += 1
+        self.n_frames += 1
+
+    # Decodes as much of 'buf' as possible. Returns the number of bytes consumed.
+    def decode(self, buf, out, show_time):
+        pos = 0
+        while pos < len(buf):
+            if buf[pos:pos + 4] == VAN_CAPTURE_MAGIC:
+                if pos + 6 > len(buf): break
+                if buf[pos + 4] != VAN_CAPTURE_VERSION:
+                    sys.exit('Unsupported capture version %d' % buf[pos + 4])
+                self.queue_size = buf[pos + 5] or 256
+                self.timestamp = 0
+                pos += 6
+                continue
+
+            try:
+                frame, next_pos = self.parse_frame(buf, pos)
+            except ValueError:
+                # Resync on the next sync byte
+                pos += 1
+                self.n_skipped += 1
+                continue
+
+            if frame is None: break
+            self.handle_frame(frame, out, show_time)
+            pos = next_pos
+
+        return pos
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a VanBus binary capture into DumpRaw text')
+    parser.add_argument('file', nargs='?', help='capture file (default: standard input)')
+    parser.add_argument('-t', '--time', action='store_true', help='prefix each line with its millis() timestamp')
+    args = parser.parse_args()
+
+    f = open(args.file, 'rb') if args.file else sys.stdin.buffer
+    decoder = Decoder()
+    buf = b''
+
+    while True:
+        chunk = f.read1(4096) if hasattr(f, 'read1') else f.read(4096)
+        if not chunk: break
+        buf += chunk
+        buf = buf[decoder.decode(buf, sys.stdout, args.time):]
+        sys.stdout.flush()
+
+    sys.stderr.write('%d frames, %d bytes skipped\n' % (decoder.n_frames, decoder.n_skipped + len(buf)))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,151 @@
+/*
+ * VanBus host build: simulated subset of the Arduino-ESP8266 core
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+// Stands in for the ESP8266 core when building the library on a PC, e.g. for the replay harness in 'extras/replay'.
+// Only the parts used by the library are here. The hardware is simulated (see VanHost.cpp):
+// - The CPU cycle counter ('ESP.getCycleCount()'), 'millis()' and 'micros()' follow a simulated clock, which only
+//   moves when the harness calls 'VanHostRunUntil(...)'.
+// - GPIO input pins are set with 'VanHostSetPin(...)', which also invokes the pin change ISR.
+// - The timer 1 ISR is invoked by 'VanHostRunUntil(...)' when it is due.
+// - Functions scheduled with 'schedule_function(...)' are run by 'VanHostRunScheduled()'.
+// - Interrupts are never nested, so 'noInterrupts()', 'xt_rsil(...)' etc. do nothing.
+
+#ifndef VanHost_Arduino_h
+#define VanHost_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+
+#ifndef F_CPU
+#define F_CPU 80000000L
+#endif // F_CPU
+
+typedef bool boolean;
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 3
+
+#define TIM_DIV1 0
+#define TIM_DIV16 1
+#define TIM_DIV256 3
+#define TIM_EDGE 0
+#define TIM_SINGLE 0
+#define TIM_LOOP 1
+
+typedef void (*timercallback)(void);
+
+// Simulated ESP8266 GPIO registers
+extern volatile uint32_t vanHostGpioIn;
+extern volatile uint32_t vanHostGpioOut;
+#define GPIP(pin) ((vanHostGpioIn >> (pin)) & 1)
+#define GPOS vanHostGpioOut
+#define GPOC vanHostGpioOut
+
+struct EspClass
+{
+    uint32_t getCycleCount();
+}; // struct EspClass
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+inline void noInterrupts() { }
+inline void interrupts() { }
+inline uint32_t xt_rsil(uint32_t) { return 0; }
+inline void xt_wsr_ps(uint32_t) { }
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+void timer1_isr_init();
+void timer1_attachInterrupt(timercallback isr);
+void timer1_enable(uint8_t divider, uint8_t intType, uint8_t reload);
+void timer1_write(uint32_t ticks);
+void timer1_disable();
+bool timer1_enabled();
+
+char* dtostrf(double number, signed char width, unsigned char prec, char* buf);
+
+// Output goes to 'stdout'
+class Print
+{
+  public:
+
+    virtual ~Print() { }
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+    size_t printf(const char* format, ...);
+    size_t printf_P(const char* format, ...);
+    size_t print(const char* str) { return write(str, strlen(str)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t println(const char* str) { return print(str) + println(); }
+    size_t println() { return print('\n'); }
+}; // class Print
+
+class Stream : public Print
+{
+  public:
+
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+}; // class Stream
+
+class HardwareSerial : public Stream
+{
+  public:
+
+    void begin(unsigned long) { }
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+}; // class HardwareSerial
+
+extern HardwareSerial Serial;
+
+// Simulation control, for the harness
+
+// Moves the simulated clock forward to CPU cycle 'at', invoking the timer 1 ISR whenever it is due on the way
+void VanHostRunUntil(uint64_t at);
+
+// Current value of the simulated clock, in CPU cycles
+uint64_t VanHostNow();
+
+// Sets the level of an input pin, and invokes its pin change ISR. As on the real hardware, the ISR is also invoked if
+// the level did not change (a glitch shorter than the interrupt latency).
+void VanHostSetPin(uint8_t pin, int level);
+
+// Runs the functions that were passed to 'schedule_function(...)', and the recurrent functions that are due
+void VanHostRunScheduled();
+
+#endif // VanHost_Arduino_h
@@ -0,0 +1,21 @@
+/*
+ * VanBus host build: simulated ESP8266 core scheduler
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+#ifndef VanHost_Schedule_h
+#define VanHost_Schedule_h
+
+#include <stdint.h>
+#include <functional>
+
+// Functions are run by 'VanHostRunScheduled()' (see Arduino.h)
+bool schedule_function(const std::function<void(void)>& fn);
+bool schedule_recurrent_function_us(const std::function<bool(void)>& fn, uint32_t repeat_us);
+
+#endif // VanHost_Schedule_h
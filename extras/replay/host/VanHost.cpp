@@ -0,0 +1,222 @@
+/*
+ * VanBus host build: simulated subset of the Arduino-ESP8266 core
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+#include <vector>
+#include "Arduino.h"
+#include "Schedule.h"
+
+volatile uint32_t vanHostGpioIn = 0xFFFFFFFF;  // Pull-ups: all inputs high
+volatile uint32_t vanHostGpioOut = 0;
+
+EspClass ESP;
+HardwareSerial Serial;
+
+static uint64_t now = 0;  // Simulated clock, in CPU cycles
+
+// Timer 1
+static timercallback timerIsr = NULL;
+static bool timerArmed = false;
+static bool timerLoop = false;
+static uint32_t timerDivider = 1;
+static uint64_t timerPeriod = 0;  // In CPU cycles
+static uint64_t timerDueAt = 0;
+
+// Pin change ISRs
+#define VAN_HOST_MAX_PINS 17
+static void (*pinIsr[VAN_HOST_MAX_PINS])(void);
+
+// Scheduler
+struct TRecurrentFunction
+{
+    std::function<bool(void)> fn;
+    uint64_t interval;  // In CPU cycles
+    uint64_t dueAt;
+}; // struct TRecurrentFunction
+
+static std::vector<std::function<void(void)>> scheduled;
+static std::vector<TRecurrentFunction> recurrent;
+
+uint32_t EspClass::getCycleCount()
+{
+    return (uint32_t)now;  // Rolls over, as on the real hardware
+} // EspClass::getCycleCount
+
+unsigned long millis()
+{
+    return now / (F_CPU / 1000);
+} // millis
+
+unsigned long micros()
+{
+    return now / (F_CPU / 1000000);
+} // micros
+
+void delay(unsigned long ms)
+{
+    VanHostRunUntil(now + (uint64_t)ms * (F_CPU / 1000));
+    VanHostRunScheduled();
+} // delay
+
+void yield()
+{
+    VanHostRunScheduled();
+} // yield
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < VAN_HOST_MAX_PINS && mode == INPUT_PULLUP) vanHostGpioIn |= 1 << pin;
+} // pinMode
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin >= VAN_HOST_MAX_PINS) return;
+    if (value) vanHostGpioOut |= 1 << pin; else vanHostGpioOut &= ~(1 << pin);
+} // digitalWrite
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int)
+{
+    if (pin < VAN_HOST_MAX_PINS) pinIsr[pin] = isr;
+} // attachInterrupt
+
+void detachInterrupt(uint8_t pin)
+{
+    if (pin < VAN_HOST_MAX_PINS) pinIsr[pin] = NULL;
+} // detachInterrupt
+
+void timer1_isr_init()
+{
+} // timer1_isr_init
+
+void timer1_attachInterrupt(timercallback isr)
+{
+    timerIsr = isr;
+} // timer1_attachInterrupt
+
+void timer1_enable(uint8_t divider, uint8_t, uint8_t reload)
+{
+    timerDivider = divider == TIM_DIV256 ? 256 : divider == TIM_DIV16 ? 16 : 1;
+    timerLoop = reload == TIM_LOOP;
+} // timer1_enable
+
+void timer1_write(uint32_t ticks)
+{
+    // Timer 1 runs at 80 MHz, also when the CPU runs at 160 MHz
+    timerPeriod = (uint64_t)ticks * timerDivider * (F_CPU / 80000000);
+    timerDueAt = now + timerPeriod;
+    timerArmed = true;
+} // timer1_write
+
+void timer1_disable()
+{
+    timerArmed = false;
+} // timer1_disable
+
+bool timer1_enabled()
+{
+    return timerArmed;
+} // timer1_enabled
+
+char* dtostrf(double number, signed char width, unsigned char prec, char* buf)
+{
+    sprintf(buf, "%*.*f", width, prec, number);
+    return buf;
+} // dtostrf
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+    while (size-- > 0) n += write(*buffer++);
+    return n;
+} // Print::write
+
+size_t Print::printf(const char* format, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (len < 0) return 0;
+    return write(buf, len < (int)sizeof(buf) ? len : sizeof(buf) - 1);
+} // Print::printf
+
+size_t Print::printf_P(const char* format, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (len < 0) return 0;
+    return write(buf, len < (int)sizeof(buf) ? len : sizeof(buf) - 1);
+} // Print::printf_P
+
+bool schedule_function(const std::function<void(void)>& fn)
+{
+    scheduled.push_back(fn);
+    return true;
+} // schedule_function
+
+bool schedule_recurrent_function_us(const std::function<bool(void)>& fn, uint32_t repeat_us)
+{
+    uint64_t interval = (uint64_t)repeat_us * (F_CPU / 1000000);
+    recurrent.push_back({fn, interval, now + interval});
+    return true;
+} // schedule_recurrent_function_us
+
+void VanHostRunUntil(uint64_t at)
+{
+    // The ISR may re-arm the timer, so check again after each invocation
+    while (timerArmed && timerDueAt <= at)
+    {
+        if (timerDueAt > now) now = timerDueAt;
+
+        if (timerLoop) timerDueAt += timerPeriod; else timerArmed = false;
+        if (timerIsr != NULL) timerIsr();
+    } // while
+
+    if (at > now) now = at;
+} // VanHostRunUntil
+
+uint64_t VanHostNow()
+{
+    return now;
+} // VanHostNow
+
+void VanHostSetPin(uint8_t pin, int level)
+{
+    if (pin >= VAN_HOST_MAX_PINS) return;
+
+    if (level) vanHostGpioIn |= 1 << pin; else vanHostGpioIn &= ~(1 << pin);
+    if (pinIsr[pin] != NULL) pinIsr[pin]();
+} // VanHostSetPin
+
+void VanHostRunScheduled()
+{
+    // A scheduled function may schedule another one; that one is run at the next call, as in the ESP8266 core
+    std::vector<std::function<void(void)>> toRun;
+    toRun.swap(scheduled);
+    for (auto& fn : toRun) fn();
+
+    for (size_t i = 0; i < recurrent.size(); )
+    {
+        TRecurrentFunction& r = recurrent[i];
+        if (r.dueAt > now)
+        {
+            i++;
+            continue;
+        } // if
+
+        r.dueAt = now + r.interval;
+        if (r.fn()) i++; else recurrent.erase(recurrent.begin() + i);
+    } // for
+} // VanHostRunScheduled
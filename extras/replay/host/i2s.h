@@ -0,0 +1,11 @@
+/*
+ * VanBus host build: I2S is not simulated
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+#error "The host build does not support VAN_RX_DEFERRED_DECODING"
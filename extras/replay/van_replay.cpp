@@ -0,0 +1,410 @@
+/*
+ * VanBus replay harness
+ *
+ * Written by Erik Tromp
+ *
+ * Version 0.2.1 - January, 2021
+ *
+ * MIT license, all text above must be included in any redistribution.
+ */
+
+/*
+ * USAGE
+ *
+ *   Build on the host, from the library directory:
+ *     g++ -std=gnu++11 -O2 -Iextras/replay/host -I. -o van_replay \
+ *         extras/replay/van_replay.cpp extras/replay/host/VanHost.cpp VanBusRx.cpp VanBusTx.cpp VanBusTimer.cpp
+ *
+ *   Replay 2000 generated packets, with edges up to 40 CPU cycles (0.5 usec) early or late:
+ *     ./van_replay -j 40
+ *
+ *   Replay a recorded trace 10 times, each time with up to 2.5 usec of extra interrupt latency:
+ *     ./van_replay -r 10 -l 200 trace.txt
+ *
+ *   Other timing thresholds for the bit decoder are tried by rebuilding with e.g.
+ *     -DVAN_BIT_UPPER_BOUNDS=1124,1744,2383,3045,3665
+ */
+
+// Feeds pin level changes into the unchanged receiver code ('RxPinChangeIsr()' and everything it calls), via the
+// simulated ESP8266 core in 'host/', and reports how well the packets were decoded. The pin level changes come from:
+// - Generated packets: random IDENs, command flags, data and ACK, sent at a random bus clock deviation. The decoded
+//   packets are compared with what was sent.
+// - A recorded trace: the output of 'TIsrDebugPacket::Dump(...)' (build the sketch with VAN_RX_ISR_DEBUGGING, and
+//   dump 'pkt.getIsrDebugPacket()' for each received packet). Other lines in the trace are skipped. As the sent
+//   packets are not known, a packet counts as decoded if its CRC is correct.
+//
+// Jitter is injected in two ways: each edge is moved by a random amount between '-j' and '+j' CPU cycles (e.g.
+// slope and threshold variations of the transceiver), and is seen by the ISR a random amount between 0 and '-l' CPU
+// cycles later (interrupt latency, e.g. while WiFi code is running with interrupts disabled).
+//
+// The time spent inside the ISR is measured on the host, and only serves to compare the effect of changes in the
+// decoder; on the ESP8266 it is many times longer.
+//
+// Exit status is 1 if the success rate is below the '-m' percentage, so that the harness can be used in a regression
+// script.
+
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include <VanBusRx.h>
+
+#define RX_PIN 2
+
+// 125 kbit/sec
+#define VAN_REPLAY_BIT_CYCLES (F_CPU / 125000)
+
+// Bus idle time before each packet, in CPU cycles: EOF + IFS, plenty
+#define VAN_REPLAY_IDLE_CYCLES (20 * VAN_REPLAY_BIT_CYCLES)
+
+// A packet dump by 'TIsrDebugPacket::Dump(...)' with this many samples (VAN_ISR_DEBUG_BUFFER_SIZE) was cut off; such
+// packets are skipped
+#define VAN_REPLAY_TRACE_MAX_SAMPLES 128
+
+// Time after the last edge of a packet, for the receiver to finish it (ACK timer)
+#define VAN_REPLAY_TAIL_CYCLES (20 * VAN_REPLAY_BIT_CYCLES)
+
+struct TEdge
+{
+    uint32_t nCycles;  // Since previous edge
+    uint8_t pinLevel;  // Level changed to
+}; // struct TEdge
+
+struct TFrame
+{
+    std::vector<TEdge> edges;
+
+    // Packet as sent; only for generated packets
+    bool isKnown;
+    uint16_t iden;
+    uint8_t commandFlags;
+    uint8_t data[VAN_MAX_DATA_BYTES];
+    int dataLen;
+    bool ack;
+}; // struct TFrame
+
+// Outcome of a replayed frame
+enum ReplayResult_t
+{
+    REPLAY_OK,  // Decoded, CRC correct (and equal to the packet sent, if known)
+    REPLAY_REPAIRED,  // Decoded, CRC correct after repair
+    REPLAY_CORRUPT,  // Decoded, CRC wrong and not repairable
+    REPLAY_WRONG,  // Decoded, CRC correct, but not equal to the packet sent
+    REPLAY_MISSED,  // Not decoded at all
+    N_REPLAY_RESULTS
+}; // enum ReplayResult_t
+
+static const char* const replayResultStr[N_REPLAY_RESULTS] = { "ok", "repaired", "corrupt", "wrong", "missed" };
+
+// Same sequence on every host, for a given seed
+static uint32_t randomState = 1;
+
+static uint32_t Random(uint32_t n)
+{
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return n == 0 ? 0 : randomState % n;
+} // Random
+
+// Generates a packet with random contents, sent at a bus clock deviation of at most 'maxPermille'
+static void GenerateFrame(TFrame& frame, int maxPermille)
+{
+    frame.isKnown = true;
+    frame.iden = Random(0x1000);
+    frame.commandFlags = 0x08 | Random(8);  // EXT bit is always set
+    frame.dataLen = Random(VAN_MAX_DATA_BYTES + 1);
+    for (int i = 0; i < frame.dataLen; i++) frame.data[i] = Random(256);
+    frame.ack = Random(2) != 0;
+
+    uint8_t bytes[VAN_MAX_PACKET_SIZE];
+    int size = frame.dataLen + 5;
+    bytes[0] = 0x0E;  // SOF
+    bytes[1] = frame.iden >> 4;
+    bytes[2] = frame.iden << 4 | frame.commandFlags;
+    memcpy(bytes + 3, frame.data, frame.dataLen);
+    uint16_t crc = _crc(bytes, size);
+    bytes[size - 2] = crc >> 8;
+    bytes[size - 1] = crc & 0xFF;
+
+    // Pin levels, one per time slot. "Enhanced Manchester": after each 4 bits, the inverse of the last bit. The last
+    // Manchester bit of the CRC byte is replaced by EOD.
+    std::vector<uint8_t> levels;
+    for (int i = 0; i < size; i++)
+    {
+        uint8_t b = bytes[i];
+        uint16_t slots = (b & 0xF0) << 2 | (~b & 0x10) << 1 | (b & 0x0F) << 1 | (~b & 0x01);
+        if (i == size - 1) slots &= 0xFFFC;
+        for (int bit = 9; bit >= 0; bit--) levels.push_back(slots >> bit & 1);
+    } // for
+
+    // ACK field and EOF
+    levels.push_back(VAN_BIT_RECESSIVE);
+    levels.push_back(frame.ack ? VAN_BIT_DOMINANT : VAN_BIT_RECESSIVE);
+    for (int i = 0; i < 8; i++) levels.push_back(VAN_BIT_RECESSIVE);
+
+    int permille = (int)Random(2 * maxPermille + 1) - maxPermille;
+    double bitCycles = VAN_REPLAY_BIT_CYCLES * (1000.0 + permille) / 1000.0;
+
+    frame.edges.clear();
+    uint8_t level = VAN_BIT_RECESSIVE;
+    uint32_t prevAt = 0;
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        if (levels[i] == level) continue;
+        level = levels[i];
+
+        uint32_t at = i * bitCycles + 0.5;
+        frame.edges.push_back({ i == 0 ? (uint32_t)VAN_REPLAY_IDLE_CYCLES : at - prevAt, level });
+        prevAt = at;
+    } // for
+} // GenerateFrame
+
+// Reads a trace as printed by 'TIsrDebugPacket::Dump(...)', e.g.:
+//   #1   0   56 >999999 -> >9999  "0","0" -.....
+//   #1   1   62     649 ->     1  "1","1" 1      0000 << 1 = 0000 |  1 = 0001
+// The first column is the Rx queue slot, the second the index of the ISR invocation within the packet.
+static bool ReadTrace(const char* fileName, std::vector<TFrame>& frames)
+{
+    FILE* f = fopen(fileName, "r");
+    if (f == NULL)
+    {
+        perror(fileName);
+        return false;
+    } // if
+
+    char line[512];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (line[0] != '#') continue;
+
+        char* fields[8];
+        int nFields = 0;
+        for (char* token = strtok(line, " \t\r\n"); token != NULL && nFields < 8; token = strtok(NULL, " \t\r\n"))
+        {
+            fields[nFields++] = token;
+        } // for
+        if (nFields < 7 || strcmp(fields[4], "->") != 0) continue;
+
+        // Pin level is the first of the two quoted values, e.g. "0","0"
+        int levelField = fields[6][0] == '"' ? 6 : 7;
+        if (levelField >= nFields || fields[levelField][0] != '"') continue;
+
+        int i = atoi(fields[1]);
+        if (i == 0 || frames.empty())
+        {
+            frames.push_back(TFrame());
+            frames.back().isKnown = false;
+        } // if
+
+        uint32_t nCycles = fields[3][0] == '>' || i == 0 ? VAN_REPLAY_IDLE_CYCLES : strtoul(fields[3], NULL, 10);
+        uint8_t pinLevel = fields[levelField][1] == '0' ? 0 : 1;
+        frames.back().edges.push_back({ nCycles, pinLevel });
+    } // while
+
+    fclose(f);
+
+    size_t nRead = frames.size();
+    for (size_t i = 0; i < frames.size(); )
+    {
+        std::vector<TEdge>& edges = frames[i].edges;
+        if (edges.size() >= VAN_REPLAY_TRACE_MAX_SAMPLES)
+        {
+            frames.erase(frames.begin() + i);
+            continue;
+        } // if
+
+        // Level changes after the packet was complete (e.g. the end of the ACK slot) are not in the trace. Return the
+        // bus to recessive, one bit time later.
+        if (edges.back().pinLevel != VAN_BIT_RECESSIVE) edges.push_back({ VAN_REPLAY_BIT_CYCLES, VAN_BIT_RECESSIVE });
+        i++;
+    } // for
+    if (frames.size() < nRead)
+    {
+        fprintf(stderr, "%s: skipped %zu cut-off packets\n", fileName, nRead - frames.size());
+    } // if
+
+    return true;
+} // ReadTrace
+
+static ReplayResult_t Classify(TVanPacketRxDesc& pkt, const TFrame& frame)
+{
+    bool repaired = false;
+    if (! pkt.CheckCrc())
+    {
+        if (! pkt.CheckCrcAndRepair()) return REPLAY_CORRUPT;
+        repaired = true;
+    } // if
+
+    if (frame.isKnown)
+    {
+        if (pkt.Iden() != frame.iden
+            || pkt.CommandFlags() != frame.commandFlags
+            || pkt.DataLen() != frame.dataLen
+            || memcmp(pkt.Data(), frame.data, frame.dataLen) != 0
+            || (strcmp(pkt.AckStr(), "ACK") == 0) != frame.ack)
+        {
+            return REPLAY_WRONG;
+        } // if
+    } // if
+
+    return repaired ? REPLAY_REPAIRED : REPLAY_OK;
+} // Classify
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options] [trace]\n"
+        "  -n <count>     number of packets to generate, if no trace is given (default: 2000)\n"
+        "  -c <permille>  maximum bus clock deviation of generated packets (default: 20)\n"
+        "  -j <cycles>    maximum edge jitter, early or late, in CPU cycles (default: 0)\n"
+        "  -l <cycles>    maximum extra interrupt latency, in CPU cycles (default: 0)\n"
+        "  -r <count>     number of times to replay (default: 1)\n"
+        "  -s <seed>      random seed (default: 1)\n"
+        "  -k             enable clock recovery\n"
+        "  -m <percent>   exit with status 1 if the success rate is below this\n"
+        "  -v             print each packet that was not decoded OK\n",
+        prog);
+} // Usage
+
+int main(int argc, char* argv[])
+{
+    int nGenerate = 2000;
+    int maxPermille = 20;
+    int maxJitter = 0;
+    int maxLatency = 0;
+    int nRepeat = 1;
+    bool clockRecovery = false;
+    double minPercent = -1.0;
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:c:j:l:r:s:km:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': nGenerate = atoi(optarg); break;
+            case 'c': maxPermille = atoi(optarg); break;
+            case 'j': maxJitter = atoi(optarg); break;
+            case 'l': maxLatency = atoi(optarg); break;
+            case 'r': nRepeat = atoi(optarg); break;
+            case 's': randomState = strtoul(optarg, NULL, 0); if (randomState == 0) randomState = 1; break;
+            case 'k': clockRecovery = true; break;
+            case 'm': minPercent = atof(optarg); break;
+            case 'v': verbose = true; break;
+            case 'h': Usage(argv[0]); return 0;
+            default: Usage(argv[0]); return 2;
+        } // switch
+    } // while
+
+    std::vector<TFrame> frames;
+    if (optind < argc)
+    {
+        if (! ReadTrace(argv[optind], frames)) return 2;
+        if (frames.empty())
+        {
+            fprintf(stderr, "%s: no 'TIsrDebugPacket::Dump' lines found\n", argv[optind]);
+            return 2;
+        } // if
+    }
+    else
+    {
+        frames.resize(nGenerate);
+        for (TFrame& frame : frames) GenerateFrame(frame, maxPermille);
+    } // if
+
+    VanBusRx.Setup(RX_PIN);
+    VanBusRx.SetClockRecovery(clockRecovery);
+
+    uint32_t results[N_REPLAY_RESULTS] = { 0 };
+    uint32_t nFrames = 0;
+    uint32_t nEdges = 0;
+    uint32_t nExtra = 0;  // Decoded more than one packet from a frame
+    std::chrono::nanoseconds isrTime(0);
+
+    uint64_t nominalAt = VanHostNow();
+    uint64_t lastAt = nominalAt;
+
+    for (int pass = 0; pass < nRepeat; pass++)
+    {
+        for (const TFrame& frame : frames)
+        {
+            for (const TEdge& edge : frame.edges)
+            {
+                nominalAt += edge.nCycles;
+
+                int64_t at = nominalAt + (int)Random(2 * maxJitter + 1) - maxJitter + Random(maxLatency + 1);
+                if (at <= (int64_t)lastAt) at = lastAt + 1;
+                lastAt = at;
+
+                VanHostRunUntil(at);
+
+                auto start = std::chrono::steady_clock::now();
+                VanHostSetPin(RX_PIN, edge.pinLevel);
+                isrTime += std::chrono::steady_clock::now() - start;
+
+                nEdges++;
+            } // for
+
+            nominalAt = lastAt + VAN_REPLAY_TAIL_CYCLES;
+            VanHostRunUntil(nominalAt);
+            VanHostRunScheduled();
+            lastAt = nominalAt;
+
+            nFrames++;
+
+            TVanPacketRxDesc pkt;
+            int nDecoded = 0;
+            while (VanBusRx.Receive(pkt))
+            {
+                if (nDecoded++ > 0)
+                {
+                    nExtra++;
+                    continue;
+                } // if
+
+                ReplayResult_t result = Classify(pkt, frame);
+                results[result]++;
+
+                if (verbose && result != REPLAY_OK)
+                {
+                    Serial.printf("frame %lu %s: ", (unsigned long)nFrames, replayResultStr[result]);
+                    pkt.DumpRaw(Serial);
+                } // if
+            } // while
+
+            if (nDecoded == 0)
+            {
+                results[REPLAY_MISSED]++;
+                if (verbose) Serial.printf("frame %lu missed\n", (unsigned long)nFrames);
+            } // if
+        } // for
+    } // for
+
+    double percent = 100.0 / nFrames;
+    double successPercent = (results[REPLAY_OK] + results[REPLAY_REPAIRED]) * percent;
+
+    Serial.printf("frames: %lu, edges: %lu (%.1f per frame)\n",
+        (unsigned long)nFrames, (unsigned long)nEdges, (double)nEdges / nFrames);
+    for (int i = 0; i < N_REPLAY_RESULTS; i++)
+    {
+        Serial.printf("%s%s: %lu (%.2f%%)", i == 0 ? "" : ", ", replayResultStr[i],
+            (unsigned long)results[i], results[i] * percent);
+    } // for
+    Serial.printf("\n");
+    if (nExtra > 0) Serial.printf("extra packets decoded: %lu\n", (unsigned long)nExtra);
+    Serial.printf("success rate: %.2f%%, CRC repair rate: %.2f%%\n",
+        successPercent, results[REPLAY_REPAIRED] * percent);
+    Serial.printf("host time in ISR: %.0f nsec per frame, %.1f nsec per edge\n",
+        (double)isrTime.count() / nFrames, (double)isrTime.count() / nEdges);
+
+    VanBusRx.DumpStats(Serial);
+
+    if (minPercent >= 0.0 && successPercent < minPercent)
+    {
+        Serial.printf("FAIL: success rate below %.2f%%\n", minPercent);
+        return 1;
+    } // if
+
+    return 0;
+} // main